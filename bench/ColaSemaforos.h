@@ -0,0 +1,45 @@
+#ifndef COLASEMAFOROS_H
+#define COLASEMAFOROS_H
+
+#include <queue>
+#include <mutex>
+#include <string>
+#include <semaphore.h>
+
+// La cola de main.cpp antes de ColaMPMC
+class ColaSemaforos {
+public:
+    explicit ColaSemaforos(unsigned capacidad) {
+        sem_init(&espaciosVacios, 0, capacidad);
+        sem_init(&espaciosLlenos, 0, 0);
+    }
+    ~ColaSemaforos() {
+        sem_destroy(&espaciosVacios);
+        sem_destroy(&espaciosLlenos);
+    }
+    void encolar(std::string&& mensaje) {
+        sem_wait(&espaciosVacios);
+        {
+            std::lock_guard<std::mutex> lock(mutexCola);
+            cola.push(std::move(mensaje));
+        }
+        sem_post(&espaciosLlenos);
+    }
+    void desencolar(std::string& destino) {
+        sem_wait(&espaciosLlenos);
+        {
+            std::lock_guard<std::mutex> lock(mutexCola);
+            destino = std::move(cola.front());
+            cola.pop();
+        }
+        sem_post(&espaciosVacios);
+    }
+
+private:
+    sem_t espaciosVacios;
+    sem_t espaciosLlenos;
+    std::mutex mutexCola;
+    std::queue<std::string> cola;
+};
+
+#endif // COLASEMAFOROS_H
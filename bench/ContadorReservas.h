@@ -0,0 +1,37 @@
+#ifndef CONTADORRESERVAS_H
+#define CONTADORRESERVAS_H
+
+// Cuenta las reservas de memoria de un benchmark reemplazando operator new. Las reservas del
+// pool de mensajes también cuentan, aunque salgan de malloc por bloques.
+// Se incluye en un solo archivo por ejecutable: define los operadores globales.
+#include "BufferMensaje.h"
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+static std::atomic<std::uint64_t> reservasNew(0);
+
+void* operator new(std::size_t bytes) {
+    reservasNew.fetch_add(1, std::memory_order_relaxed);
+    void* memoria = std::malloc(bytes ? bytes : 1);
+    if (!memoria) {
+        throw std::bad_alloc();
+    }
+    return memoria;
+}
+
+void operator delete(void* memoria) noexcept {
+    std::free(memoria);
+}
+
+void operator delete(void* memoria, std::size_t) noexcept {
+    std::free(memoria);
+}
+
+// Reservas totales: operator new más los bloques que el pool pidió a malloc
+static std::uint64_t reservasActuales() {
+    return reservasNew.load() + obtenerEstadisticasPoolMensajes().reservasSistema;
+}
+
+#endif // CONTADORRESERVAS_H
@@ -0,0 +1,80 @@
+// Benchmark de la cola productor/consumidor: operaciones por segundo de la cola anterior
+// (dos semáforos, un mutex y std::queue) frente a ColaMPMC en sus variantes bloqueante y
+// giratoria, con el mismo número de productores y consumidores.
+#include "ColaMPMC.h"
+#include "ColaSemaforos.h"
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <thread>
+#include <chrono>
+#include <cstdlib>
+
+static const std::size_t CAPACIDAD = 1024;
+static const int OPERACIONES_TOTALES = 256 * 1024;
+static const int HILOS[] = {1, 2, 4, 8, 16, 32, 64};
+
+enum class Variante { SEMAFOROS, BLOQUEANTE, GIRANDO };
+
+static std::string mensajeDePrueba(int productor, int numero) {
+    return "Mensaje del productor " + std::to_string(productor) + " - " + std::to_string(numero);
+}
+
+// Cada productor encola su parte y cada consumidor desencola la misma cantidad
+static double medir(Variante variante, int hilos) {
+    const int porHilo = OPERACIONES_TOTALES / hilos;
+    ColaSemaforos semaforos(CAPACIDAD);
+    ColaMPMC<std::string> mpmc(CAPACIDAD);
+    std::vector<std::thread> trabajadores;
+
+    auto inicio = std::chrono::steady_clock::now();
+    for (int h = 0; h < hilos; ++h) {
+        trabajadores.emplace_back([&, h]() {
+            for (int i = 0; i < porHilo; ++i) {
+                std::string mensaje = mensajeDePrueba(h, i);
+                if (variante == Variante::SEMAFOROS) {
+                    semaforos.encolar(std::move(mensaje));
+                } else if (variante == Variante::BLOQUEANTE) {
+                    mpmc.encolar(std::move(mensaje));
+                } else {
+                    mpmc.encolarGirando(std::move(mensaje));
+                }
+            }
+        });
+        trabajadores.emplace_back([&]() {
+            std::string mensaje;
+            for (int i = 0; i < porHilo; ++i) {
+                if (variante == Variante::SEMAFOROS) {
+                    semaforos.desencolar(mensaje);
+                } else if (variante == Variante::BLOQUEANTE) {
+                    mpmc.desencolar(mensaje);
+                } else {
+                    mpmc.desencolarGirando(mensaje);
+                }
+            }
+        });
+    }
+    for (auto& trabajador : trabajadores) {
+        trabajador.join();
+    }
+    double segundos = std::chrono::duration<double>(std::chrono::steady_clock::now() - inicio).count();
+    return porHilo * hilos / segundos;
+}
+
+int main() {
+    std::cout << "Operaciones (encolar + desencolar) por segundo, " << OPERACIONES_TOTALES
+              << " mensajes, capacidad " << CAPACIDAD << ", " << std::thread::hardware_concurrency() << " núcleos\n\n";
+    std::cout << std::left << std::setw(26) << "productores/consumidores" << std::right << std::setw(14) << "semáforos"
+              << std::setw(14) << "mpmc bloq." << std::setw(14) << "mpmc giro" << std::setw(10) << "mejora" << "\n";
+
+    for (int hilos : HILOS) {
+        double semaforos = medir(Variante::SEMAFOROS, hilos);
+        double bloqueante = medir(Variante::BLOQUEANTE, hilos);
+        double girando = medir(Variante::GIRANDO, hilos);
+        std::cout << std::left << std::setw(26) << (std::to_string(hilos) + "/" + std::to_string(hilos)) << std::right
+                  << std::fixed << std::setprecision(0) << std::setw(14) << semaforos << std::setw(14) << bloqueante
+                  << std::setw(14) << girando << std::setprecision(2) << std::setw(9) << bloqueante / semaforos << "x\n";
+    }
+    return 0;
+}
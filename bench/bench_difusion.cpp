@@ -0,0 +1,120 @@
+// Benchmark de difusión: reservas de memoria y tiempo por mensaje difundido,
+// copiando el texto para cada destinatario frente a compartir un BufferMensaje.
+#include "BufferMensaje.h"
+#include "ContadorReservas.h"
+#include "Conexion.h"
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <deque>
+#include <string>
+#include <memory>
+#include <chrono>
+#include <atomic>
+#include <cstdlib>
+#include <unistd.h>
+#include <sys/socket.h>
+
+static const int RONDAS = 200;
+static const int MENSAJES_POR_RONDA = 20;
+
+struct Resultado {
+    double nanosegundosPorDifusion;
+    double reservasPorDifusion;
+};
+
+// Modo anterior: se arma un std::string por mensaje y se copia a la cola de cada destinatario
+static Resultado medirCopiaPorDestinatario(int destinatarios, const std::string& nombre, const std::string& texto) {
+    std::vector<std::deque<std::string>> colas(destinatarios);
+    std::chrono::nanoseconds tiempo(0);
+    std::uint64_t reservas = 0;
+
+    for (int ronda = 0; ronda < RONDAS; ++ronda) {
+        std::uint64_t antes = reservasActuales();
+        auto inicio = std::chrono::steady_clock::now();
+        for (int m = 0; m < MENSAJES_POR_RONDA; ++m) {
+            std::string mensaje = nombre + ": " + texto;
+            for (auto& cola : colas) {
+                cola.push_back(mensaje);
+            }
+        }
+        tiempo += std::chrono::steady_clock::now() - inicio;
+        reservas += reservasActuales() - antes;
+
+        // Simular que el escritor vació las colas (fuera de la medición)
+        for (auto& cola : colas) {
+            cola.clear();
+        }
+    }
+
+    double difusiones = static_cast<double>(RONDAS) * MENSAJES_POR_RONDA;
+    Resultado resultado = {tiempo.count() / difusiones, reservas / difusiones};
+    return resultado;
+}
+
+// Modo actual: un BufferMensaje por mensaje y una referencia por destinatario
+static Resultado medirBufferCompartido(int destinatarios, const std::string& nombre, const std::string& texto) {
+    std::vector<std::shared_ptr<Conexion>> conexiones;
+    std::vector<int> pares;
+    for (int i = 0; i < destinatarios; ++i) {
+        int sockets[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) == -1) {
+            std::cerr << "Error al crear el socketpair.\n";
+            std::exit(1);
+        }
+        conexiones.push_back(std::make_shared<Conexion>(sockets[0], nullptr));
+        pares.push_back(sockets[1]);
+    }
+
+    std::vector<char> descarte(1 << 16);
+    std::chrono::nanoseconds tiempo(0);
+    std::uint64_t reservas = 0;
+
+    for (int ronda = 0; ronda < RONDAS; ++ronda) {
+        std::uint64_t antes = reservasActuales();
+        auto inicio = std::chrono::steady_clock::now();
+        for (int m = 0; m < MENSAJES_POR_RONDA; ++m) {
+            ReferenciaMensaje mensaje = BufferMensaje::crear({nombre, ": ", texto});
+            for (const auto& conexion : conexiones) {
+                conexion->encolar(mensaje);
+            }
+        }
+        tiempo += std::chrono::steady_clock::now() - inicio;
+        reservas += reservasActuales() - antes;
+
+        // Vaciar las colas y leer del otro extremo (fuera de la medición)
+        for (std::size_t i = 0; i < conexiones.size(); ++i) {
+            conexiones[i]->vaciar();
+            while (recv(pares[i], descarte.data(), descarte.size(), MSG_DONTWAIT) > 0) {
+            }
+        }
+    }
+
+    for (int par : pares) {
+        close(par);
+    }
+
+    double difusiones = static_cast<double>(RONDAS) * MENSAJES_POR_RONDA;
+    Resultado resultado = {tiempo.count() / difusiones, reservas / difusiones};
+    return resultado;
+}
+
+int main() {
+    std::string nombre = "usuario_de_prueba";
+    std::string texto(120, 'x');
+    int tamanosSala[] = {10, 100, 500, 1000};
+
+    std::cout << std::left << std::setw(14) << "destinatarios" << std::setw(26) << "modo"
+              << std::setw(16) << "ns/difusion" << "reservas/difusion\n";
+    for (int destinatarios : tamanosSala) {
+        Resultado copia = medirCopiaPorDestinatario(destinatarios, nombre, texto);
+        Resultado compartido = medirBufferCompartido(destinatarios, nombre, texto);
+        std::cout << std::left << std::setw(14) << destinatarios << std::setw(26) << "copia por destinatario"
+                  << std::setw(16) << std::fixed << std::setprecision(0) << copia.nanosegundosPorDifusion
+                  << std::setprecision(2) << copia.reservasPorDifusion << "\n";
+        std::cout << std::left << std::setw(14) << destinatarios << std::setw(26) << "buffer compartido"
+                  << std::setw(16) << std::fixed << std::setprecision(0) << compartido.nanosegundosPorDifusion
+                  << std::setprecision(2) << compartido.reservasPorDifusion << "\n";
+    }
+    return 0;
+}
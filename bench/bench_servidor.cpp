@@ -0,0 +1,225 @@
+// Microbenchmarks de los caminos calientes del servidor, sin clientes reales: cada usuario es un
+// socketpair cuyo otro extremo se vacía entre rondas, fuera de la medición. Para cada caso se
+// informa ns por operación, ns por usuario y reservas de memoria por operación, con distintos
+// números de usuarios conectados.
+//
+// Casos:
+//   difusion     enviarMensajeATodos con un mensaje de chat (buffer compartido + encolar)
+//   canal        enviarMensajeACanal a un canal de 10 miembros: no depende de los usuarios conectados
+//   lista        enviarListaUsuarios (respuesta a @usuarios)
+//   telemetria   llenarTelemetria, que reemplazó a concatenarMensajes: recorre a todos los
+//                usuarios para las colas y el tiempo sin mensajes
+//   comando      procesarEntrada de una línea en modo texto: despacho de comandos de
+//                manejarCliente, sin difusión (solo está el remitente). Las líneas de chat no
+//                deben reservar memoria: se recorren sobre el buffer de recepción
+//   bitacora     BitacoraMensajes::agregar de un mensaje de chat (copia al segmento mapeado)
+//   cola         un encolar + desencolar sin contención en la cola de semáforos anterior y en
+//                ColaMPMC (la escalabilidad con hilos la mide bench-cola)
+#include "ServidorChat.h"
+#include "Conexion.h"
+#include "Reactor.h"
+#include "ColaMPMC.h"
+#include "ColaSemaforos.h"
+#include "ContadorReservas.h"
+#include "BitacoraMensajes.h"
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <memory>
+#include <chrono>
+#include <limits>
+#include <cstdlib>
+#include <unistd.h>
+#include <sys/socket.h>
+
+static const int RONDAS = 50;
+static const int USUARIOS[] = {1, 10, 100, 1000, 5000};
+
+// Sin marca alta: las colas crecen dentro de una ronda y se vacían entre rondas
+static const std::size_t SIN_LIMITE_SALIDA = std::numeric_limits<std::size_t>::max() / 2;
+
+struct Resultado {
+    double nanosegundos;
+    double reservas;
+};
+
+// Repetir 'operacion' operacionesPorRonda veces en cada ronda; 'preparar' corre antes de cada
+// ronda sin medir. La primera ronda calienta cachés y pools y no cuenta.
+template <typename Operacion, typename Preparar>
+static Resultado medir(int operacionesPorRonda, Operacion operacion, Preparar preparar) {
+    std::chrono::nanoseconds tiempo(0);
+    std::uint64_t reservas = 0;
+    for (int ronda = 0; ronda <= RONDAS; ++ronda) {
+        preparar();
+        std::uint64_t antes = reservasActuales();
+        auto inicio = std::chrono::steady_clock::now();
+        for (int i = 0; i < operacionesPorRonda; ++i) {
+            operacion();
+        }
+        auto duracion = std::chrono::steady_clock::now() - inicio;
+        if (ronda > 0) {
+            tiempo += duracion;
+            reservas += reservasActuales() - antes;
+        }
+    }
+    double operaciones = static_cast<double>(RONDAS) * operacionesPorRonda;
+    Resultado resultado = {tiempo.count() / operaciones, reservas / operaciones};
+    return resultado;
+}
+
+// Servidor sin socket de escucha con 'usuarios' conexiones registradas. El reactor de escritura
+// nunca se inicia: antes de cada ronda las colas se vacían y reciben un mensaje semilla, así que
+// encolar no tiene que despertarlo durante la medición.
+class BancoServidor {
+public:
+    explicit BancoServidor(int usuarios) : servidor(0, ModoServidor::HILOS, 1), descarte(1 << 16) {
+        servidor.reactores.emplace_back(new Reactor(servidor, 0, true));
+        for (int i = 0; i < usuarios; ++i) {
+            int sockets[2];
+            if (socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) == -1) {
+                std::cerr << "Error al crear el socketpair.\n";
+                std::exit(1);
+            }
+            auto conexion = std::make_shared<Conexion>(sockets[0], servidor.reactores[0].get(), SIN_LIMITE_SALIDA);
+            conexion->nombreUsuario = "usuario" + std::to_string(i);
+            conexion->identificado = true;
+            servidor.registro.agregar(conexion);
+            conexion->canal = servidor.canales.unir(conexion, CANAL_GENERAL);
+            if (i < MIEMBROS_SALA) {
+                sala = servidor.canales.unir(conexion, "sala");
+            }
+            conexiones.push_back(conexion);
+            pares.push_back(sockets[1]);
+        }
+        semilla = BufferMensaje::crear("semilla\n");
+    }
+
+    ~BancoServidor() {
+        for (int par : pares) {
+            close(par);
+        }
+    }
+
+    Resultado difusion() {
+        std::string texto(120, 'x');
+        const std::shared_ptr<Conexion>& remitente = conexiones[0];
+        return medir(20, [&]() {
+            servidor.enviarMensajeATodos(BufferMensaje::crear({remitente->nombreUsuario, ": ", texto}),
+                                         remitente->obtenerDescriptor());
+        }, [&]() { preparar(); });
+    }
+
+    Resultado canal() {
+        std::string texto(120, 'x');
+        const std::shared_ptr<Conexion>& remitente = conexiones[0];
+        return medir(20, [&]() {
+            servidor.enviarMensajeACanal(*sala, BufferMensaje::crear({remitente->nombreUsuario, ": ", texto}),
+                                         remitente->obtenerDescriptor());
+        }, [&]() { preparar(); });
+    }
+
+    Resultado lista() {
+        return medir(5, [&]() { servidor.enviarListaUsuarios(conexiones[0]); }, [&]() { preparar(); });
+    }
+
+    Resultado telemetria() {
+        PaqueteTelemetria paquete;
+        return medir(100, [&]() { servidor.llenarTelemetria(paquete); }, [&]() {});
+    }
+
+    Resultado comando(const std::string& linea) {
+        return medir(1000, [&]() { servidor.procesarEntrada(conexiones[0], linea.data(), linea.size()); },
+                     [&]() { preparar(); });
+    }
+
+private:
+    void preparar() {
+        for (std::size_t i = 0; i < conexiones.size(); ++i) {
+            do {
+                conexiones[i]->vaciar();
+                while (recv(pares[i], descarte.data(), descarte.size(), MSG_DONTWAIT) > 0) {
+                }
+            } while (conexiones[i]->obtenerContadores().bytesPendientes > 0);
+            conexiones[i]->encolar(semilla);
+        }
+    }
+
+    static const int MIEMBROS_SALA = 10;
+
+    ServidorChat servidor;
+    std::shared_ptr<Canal> sala;  // Índice de un canal con los primeros MIEMBROS_SALA usuarios
+    std::vector<std::shared_ptr<Conexion>> conexiones;
+    std::vector<int> pares;
+    std::vector<char> descarte;
+    ReferenciaMensaje semilla;
+};
+
+static void imprimir(const std::string& caso, int usuarios, const Resultado& resultado) {
+    std::cout << std::left << std::setw(22) << caso << std::right << std::setw(9) << usuarios << std::fixed
+              << std::setprecision(1) << std::setw(14) << resultado.nanosegundos << std::setw(14)
+              << resultado.nanosegundos / usuarios << std::setprecision(3) << std::setw(14) << resultado.reservas << "\n";
+}
+
+// Un encolar y un desencolar desde el mismo hilo; el texto va y vuelve sin copiarse
+static void medirColas() {
+    std::string mensaje = "Mensaje del productor 1 - 12345";
+    ColaSemaforos semaforos(1024);
+    Resultado resultado = medir(10000, [&]() {
+        semaforos.encolar(std::move(mensaje));
+        semaforos.desencolar(mensaje);
+    }, []() {});
+    imprimir("cola sem_t+mutex", 1, resultado);
+
+    ColaMPMC<std::string> mpmc(1024);
+    resultado = medir(10000, [&]() {
+        mpmc.encolar(std::move(mensaje));
+        mpmc.desencolar(mensaje);
+    }, []() {});
+    imprimir("cola mpmc", 1, resultado);
+}
+
+// Anexar a una bitácora en un directorio temporal; incluye los cambios de segmento
+static void medirBitacora() {
+    char plantilla[] = "/tmp/bench_bitacoraXXXXXX";
+    if (mkdtemp(plantilla) == nullptr) {
+        std::cerr << "Error al crear el directorio temporal de la bitácora.\n";
+        return;
+    }
+    ConfiguracionBitacora configuracion;
+    configuracion.directorio = plantilla;
+    {
+        BitacoraMensajes bitacora(configuracion);
+        if (!bitacora.abrir()) {
+            return;
+        }
+        std::string texto = "usuario0: " + std::string(120, 'x');
+        imprimir("bitacora", 1, medir(10000, [&]() { bitacora.agregar(texto.data(), texto.size()); },
+                                      [&]() { bitacora.mantener(); }));
+    }
+    std::system((std::string("rm -rf ") + plantilla).c_str());
+}
+
+int main() {
+    std::cout << std::left << std::setw(22) << "caso" << std::right << std::setw(9) << "usuarios" << std::setw(14)
+              << "ns/op" << std::setw(14) << "ns/usuario" << std::setw(14) << "reservas/op" << "\n";
+
+    for (int usuarios : USUARIOS) {
+        BancoServidor banco(usuarios);
+        imprimir("difusion", usuarios, banco.difusion());
+        imprimir("canal", usuarios, banco.canal());
+        imprimir("lista", usuarios, banco.lista());
+        imprimir("telemetria", usuarios, banco.telemetria());
+    }
+
+    BancoServidor banco(1);
+    // La segunda línea de chat ya no cabe en el búfer corto de std::string
+    const char* comandos[] = {"hola a todos", "buenas tardes a todos en el canal", "@usuarios", "@conexion", "@h", "@salir"};
+    for (const char* comando : comandos) {
+        imprimir(std::string("comando ") + comando, 1, banco.comando(comando));
+    }
+
+    medirBitacora();
+    medirColas();
+    return 0;
+}
@@ -0,0 +1,595 @@
+// chatbench: generador de carga y medidor de latencia de extremo a extremo para ServidorChat.
+//
+// Abre miles de clientes simulados contra un servidor, completa el saludo (solicitud de nombre
+// y nombre), y hace que los primeros M clientes envíen mensajes a un ritmo fijo. Cada mensaje
+// lleva su instante de envío (CLOCK_MONOTONIC, en ns) entre tildes, "~123456~", así que cada
+// receptor sabe cuánto tardó la difusión en llegarle sin depender del protocolo: en modo texto
+// el servidor puede juntar varios mensajes en una lectura y las marcas se encuentran igual.
+// Todos los clientes están en la misma sala, así que cada mensaje se difunde a los demás
+// conectados (fan-out = clientes - 1).
+//
+// Fases: conexión, sincronización (un observador pregunta @conexion hasta que el servidor ve a
+// todos), calentamiento, medición y drenado. Solo cuentan los mensajes enviados durante la
+// medición. El resultado sale como una línea JSON por stdout y un resumen legible por stderr.
+//
+// Uso: chatbench <direccionIP> <puerto> [--clientes N] [--emisores M] [--tasa mensajesPorSegundo]
+//                [--duracion s] [--calentamiento s] [--hilos H] [--protocolo texto|tramas]
+//                [--tamano bytes]
+#include "Metricas.h"
+#include "Protocolo.h"
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <chrono>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <cstdlib>
+#include <ctime>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+// Conexiones en curso como mucho por hilo, para no desbordar la cola de listen del servidor
+static const std::size_t CONEXIONES_SIMULTANEAS = 128;
+// Bytes pendientes de salida por cliente antes de empezar a descartar mensajes
+static const std::size_t MAXIMO_SALIDA_PENDIENTE = 1024 * 1024;
+static const std::size_t TAMANO_LECTURA = 64 * 1024;
+static const char PATRON_CONECTADOS[] = "conectados: ";
+
+struct Configuracion {
+    std::string direccionIP;
+    int puerto = 0;
+    std::size_t clientes = 1000;
+    std::size_t emisores = 10;
+    double tasa = 10.0;  // Mensajes por segundo de cada emisor
+    double duracion = 10.0;
+    double calentamiento = 1.0;
+    double drenado = 1.0;
+    double tiempoConexion = 30.0;
+    std::size_t hilos = 1;
+    bool tramas = true;
+    std::size_t tamano = 32;  // Bytes de texto por mensaje, marca incluida
+};
+
+enum Fase { CONECTANDO, SINCRONIZANDO, CALENTANDO, MIDIENDO, DRENANDO, TERMINADO };
+
+enum class EstadoCliente { SIN_CONECTAR, CONECTANDO, ESPERANDO_SOLICITUD, LISTO, CERRADO };
+
+struct ClienteSimulado {
+    std::size_t indice = 0;
+    int descriptor = -1;
+    EstadoCliente estado = EstadoCliente::SIN_CONECTAR;
+    std::int64_t inicioConexionNs = 0;
+    std::size_t solicitudRecibida = 0;  // Bytes de la solicitud de nombre ya leídos
+    std::string salida;                 // Bytes aceptados pero aún no escritos en el socket
+    std::uint64_t enviados = 0;         // Mensajes generados por este emisor
+
+    // Estado del escáner de marcas "~digitos~"
+    bool enMarca = false;
+    std::uint64_t valorMarca = 0;
+    std::size_t digitosMarca = 0;
+
+    // Solo el observador: coincidencia parcial de "conectados: " y el número que sigue
+    std::size_t coincidenciaPatron = 0;
+    bool leyendoUsuarios = false;
+    std::uint64_t usuarios = 0;
+};
+
+struct EstadisticasHilo {
+    InstantaneaHistograma latencias;   // ns desde el envío hasta la recepción
+    InstantaneaHistograma saludos;     // ns desde connect hasta recibir la solicitud de nombre
+    std::uint64_t latenciaMaxima = 0;
+    std::uint64_t saludoMaximo = 0;
+    std::uint64_t enviados = 0;        // Generados durante la medición
+    std::uint64_t descartados = 0;     // No cabían en el buffer de salida
+    std::uint64_t entregas = 0;        // Recibidos de mensajes enviados durante la medición
+    std::uint64_t desconectados = 0;   // Cerrados por el servidor después del saludo
+    std::uint64_t fallos = 0;          // Conexiones o saludos fallidos
+};
+
+// Estado compartido entre el hilo principal y los hilos de clientes
+static std::atomic<int> fase(CONECTANDO);
+static std::atomic<std::size_t> saludosCompletos(0);
+static std::atomic<std::size_t> saludosFallidos(0);
+static std::atomic<std::uint64_t> usuariosServidor(0);
+static std::atomic<std::int64_t> inicioEnvioNs(0);
+static std::atomic<std::int64_t> inicioMedicionNs(0);
+static std::atomic<std::int64_t> finMedicionNs(0);
+
+static std::int64_t ahoraNs() {
+    timespec ahora;
+    clock_gettime(CLOCK_MONOTONIC, &ahora);
+    return ahora.tv_sec * 1000000000LL + ahora.tv_nsec;
+}
+
+static void registrar(InstantaneaHistograma& histograma, std::uint64_t& maximo, std::uint64_t valor) {
+    histograma.cubetas[InstantaneaHistograma::cubetaDe(valor)]++;
+    maximo = std::max(maximo, valor);
+}
+
+class HiloClientes {
+public:
+    HiloClientes(const Configuracion& configuracion, std::size_t numeroHilo)
+        : configuracion(configuracion), numeroHilo(numeroHilo), epoll(epoll_create1(EPOLL_CLOEXEC)),
+          siguienteConexion(0), conexionesEnCurso(0), buffer(TAMANO_LECTURA) {
+        // Reparto circular: los emisores quedan distribuidos entre los hilos
+        for (std::size_t i = numeroHilo; i < configuracion.clientes; i += configuracion.hilos) {
+            ClienteSimulado cliente;
+            cliente.indice = i;
+            clientes.push_back(cliente);
+        }
+        std::memset(&direccion, 0, sizeof(direccion));
+        direccion.sin_family = AF_INET;
+        direccion.sin_port = htons(configuracion.puerto);
+        inet_pton(AF_INET, configuracion.direccionIP.c_str(), &direccion.sin_addr);
+    }
+
+    ~HiloClientes() {
+        for (ClienteSimulado& cliente : clientes) {
+            if (cliente.descriptor != -1) {
+                close(cliente.descriptor);
+            }
+        }
+        close(epoll);
+    }
+
+    void ejecutar() {
+        epoll_event eventos[256];
+        std::int64_t ultimaConsulta = 0;
+        while (fase.load() != TERMINADO) {
+            iniciarConexiones();
+
+            int cantidad = epoll_wait(epoll, eventos, 256, 1);
+            for (int i = 0; i < cantidad; ++i) {
+                ClienteSimulado& cliente = clientes[eventos[i].data.u64];
+                if (eventos[i].events & EPOLLOUT) {
+                    alPoderEscribir(cliente);
+                }
+                if (eventos[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP)) {
+                    leer(cliente);
+                }
+            }
+
+            int faseActual = fase.load();
+            if (faseActual == CALENTANDO || faseActual == MIDIENDO) {
+                enviarProgramados();
+            }
+
+            // El observador pregunta al servidor cuántos usuarios tiene hasta que estén todos
+            std::int64_t ahora = ahoraNs();
+            if (faseActual == SINCRONIZANDO && numeroHilo == 0 && !clientes.empty() &&
+                clientes[0].estado == EstadoCliente::LISTO && ahora - ultimaConsulta > 50000000) {
+                encolarTexto(clientes[0], "@conexion");
+                ultimaConsulta = ahora;
+            }
+        }
+    }
+
+    const EstadisticasHilo& obtenerEstadisticas() const { return estadisticas; }
+
+private:
+    void iniciarConexiones() {
+        while (siguienteConexion < clientes.size() && conexionesEnCurso < CONEXIONES_SIMULTANEAS) {
+            ClienteSimulado& cliente = clientes[siguienteConexion];
+            cliente.descriptor = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            cliente.inicioConexionNs = ahoraNs();
+            if (cliente.descriptor == -1 ||
+                (connect(cliente.descriptor, (sockaddr*)&direccion, sizeof(direccion)) == -1 && errno != EINPROGRESS)) {
+                fallar(cliente);
+            } else {
+                int activar = 1;
+                setsockopt(cliente.descriptor, IPPROTO_TCP, TCP_NODELAY, &activar, sizeof(activar));
+                cliente.estado = EstadoCliente::CONECTANDO;
+                conexionesEnCurso++;
+                epoll_event evento;
+                evento.events = EPOLLIN | EPOLLOUT | EPOLLET;  // Disparo por flanco: se lee y escribe hasta EAGAIN
+                evento.data.u64 = siguienteConexion;
+                epoll_ctl(epoll, EPOLL_CTL_ADD, cliente.descriptor, &evento);
+            }
+            siguienteConexion++;
+        }
+    }
+
+    void alPoderEscribir(ClienteSimulado& cliente) {
+        if (cliente.estado == EstadoCliente::CONECTANDO) {
+            int error = 0;
+            socklen_t longitud = sizeof(error);
+            getsockopt(cliente.descriptor, SOL_SOCKET, SO_ERROR, &error, &longitud);
+            if (error != 0) {
+                fallar(cliente);
+                return;
+            }
+            cliente.estado = EstadoCliente::ESPERANDO_SOLICITUD;
+        }
+        vaciar(cliente);
+    }
+
+    void leer(ClienteSimulado& cliente) {
+        while (cliente.estado != EstadoCliente::CERRADO) {
+            ssize_t leidos = recv(cliente.descriptor, buffer.data(), buffer.size(), 0);
+            if (leidos == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                return;
+            }
+            if (leidos <= 0) {
+                if (cliente.estado == EstadoCliente::LISTO) {
+                    estadisticas.desconectados++;
+                    cerrar(cliente);
+                } else {
+                    fallar(cliente);
+                }
+                return;
+            }
+
+            const char* datos = buffer.data();
+            std::size_t longitud = static_cast<std::size_t>(leidos);
+            if (cliente.solicitudRecibida < LONGITUD_SOLICITUD_NOMBRE) {
+                std::size_t parte = std::min(longitud, LONGITUD_SOLICITUD_NOMBRE - cliente.solicitudRecibida);
+                cliente.solicitudRecibida += parte;
+                datos += parte;
+                longitud -= parte;
+                if (cliente.solicitudRecibida == LONGITUD_SOLICITUD_NOMBRE) {
+                    completarSaludo(cliente);
+                }
+            }
+            escanear(cliente, datos, longitud);
+        }
+    }
+
+    // Con la solicitud recibida se envía el nombre; con tramas va detrás del preámbulo
+    void completarSaludo(ClienteSimulado& cliente) {
+        registrar(estadisticas.saludos, estadisticas.saludoMaximo, ahoraNs() - cliente.inicioConexionNs);
+        std::string nombre = "bench" + std::to_string(cliente.indice);
+        if (configuracion.tramas) {
+            cliente.salida.append(PREAMBULO_TRAMAS, LONGITUD_PREAMBULO);
+            cliente.salida += construirTrama(nombre, TRAMA_NOMBRE);
+        } else {
+            cliente.salida += nombre;
+        }
+        cliente.estado = EstadoCliente::LISTO;
+        conexionesEnCurso--;
+        saludosCompletos.fetch_add(1);
+        vaciar(cliente);
+    }
+
+    // Buscar marcas "~digitos~" y, en el observador, la respuesta a @conexion
+    void escanear(ClienteSimulado& cliente, const char* datos, std::size_t longitud) {
+        bool observador = cliente.indice == 0;
+        for (std::size_t i = 0; i < longitud; ++i) {
+            char caracter = datos[i];
+            if (cliente.enMarca) {
+                if (caracter >= '0' && caracter <= '9') {
+                    cliente.valorMarca = cliente.valorMarca * 10 + (caracter - '0');
+                    cliente.digitosMarca++;
+                    continue;
+                }
+                cliente.enMarca = false;
+                if (caracter == '~' && cliente.digitosMarca > 0) {
+                    recibirMarca(cliente.valorMarca);
+                    continue;
+                }
+            }
+            if (caracter == '~') {
+                cliente.enMarca = true;
+                cliente.valorMarca = 0;
+                cliente.digitosMarca = 0;
+            }
+
+            if (observador) {
+                escanearUsuarios(cliente, caracter);
+            }
+        }
+    }
+
+    // Ningún prefijo propio de "conectados: " se repite dentro del patrón salvo la "c" inicial,
+    // así que ante un fallo basta con volver a probar ese carácter como comienzo
+    void escanearUsuarios(ClienteSimulado& cliente, char caracter) {
+        if (cliente.leyendoUsuarios) {
+            if (caracter >= '0' && caracter <= '9') {
+                cliente.usuarios = cliente.usuarios * 10 + (caracter - '0');
+                return;
+            }
+            cliente.leyendoUsuarios = false;
+            usuariosServidor.store(cliente.usuarios);
+        }
+        const std::size_t longitudPatron = sizeof(PATRON_CONECTADOS) - 1;
+        if (caracter == PATRON_CONECTADOS[cliente.coincidenciaPatron]) {
+            if (++cliente.coincidenciaPatron == longitudPatron) {
+                cliente.coincidenciaPatron = 0;
+                cliente.leyendoUsuarios = true;
+                cliente.usuarios = 0;
+            }
+        } else {
+            cliente.coincidenciaPatron = caracter == PATRON_CONECTADOS[0] ? 1 : 0;
+        }
+    }
+
+    void recibirMarca(std::uint64_t enviadoNs) {
+        std::int64_t inicio = inicioMedicionNs.load(std::memory_order_relaxed);
+        std::int64_t fin = finMedicionNs.load(std::memory_order_relaxed);
+        std::int64_t enviado = static_cast<std::int64_t>(enviadoNs);
+        if (inicio == 0 || enviado < inicio || (fin != 0 && enviado >= fin)) {
+            return;
+        }
+        std::int64_t latencia = ahoraNs() - enviado;
+        registrar(estadisticas.latencias, estadisticas.latenciaMaxima, latencia > 0 ? latencia : 0);
+        estadisticas.entregas++;
+    }
+
+    // Cada emisor va al ritmo configurado con un desfase propio para no enviar todos a la vez
+    void enviarProgramados() {
+        std::int64_t inicio = inicioEnvioNs.load();
+        std::int64_t ahora = ahoraNs();
+        double transcurrido = (ahora - inicio) / 1e9;
+        for (ClienteSimulado& cliente : clientes) {
+            if (cliente.indice >= configuracion.emisores) {
+                break;  // Los índices crecen: el resto del hilo no emite
+            }
+            if (cliente.estado != EstadoCliente::LISTO) {
+                continue;
+            }
+            double desfase = static_cast<double>(cliente.indice) / configuracion.emisores;
+            std::uint64_t objetivo = static_cast<std::uint64_t>(transcurrido * configuracion.tasa + desfase);
+            bool escribir = false;
+            while (cliente.enviados < objetivo) {
+                cliente.enviados++;
+                std::int64_t instante = ahoraNs();
+                bool enMedicion = fase.load(std::memory_order_relaxed) == MIDIENDO &&
+                                  instante >= inicioMedicionNs.load(std::memory_order_relaxed);
+                if (cliente.salida.size() > MAXIMO_SALIDA_PENDIENTE) {
+                    estadisticas.descartados += enMedicion ? 1 : 0;
+                    continue;
+                }
+                std::string texto = "~" + std::to_string(instante) + "~";
+                if (texto.size() < configuracion.tamano) {
+                    texto.append(configuracion.tamano - texto.size(), 'x');
+                }
+                encolarTexto(cliente, texto, false);
+                estadisticas.enviados += enMedicion ? 1 : 0;
+                escribir = true;
+            }
+            if (escribir) {
+                vaciar(cliente);
+            }
+        }
+    }
+
+    void encolarTexto(ClienteSimulado& cliente, const std::string& texto, bool escribir = true) {
+        if (configuracion.tramas) {
+            cliente.salida += construirTrama(texto, TRAMA_TEXTO);
+        } else {
+            cliente.salida += texto;
+        }
+        if (escribir) {
+            vaciar(cliente);
+        }
+    }
+
+    void vaciar(ClienteSimulado& cliente) {
+        if (cliente.estado != EstadoCliente::LISTO || cliente.salida.empty()) {
+            return;
+        }
+        std::size_t escritosTotal = 0;
+        while (escritosTotal < cliente.salida.size()) {
+            ssize_t escritos = send(cliente.descriptor, cliente.salida.data() + escritosTotal,
+                                    cliente.salida.size() - escritosTotal, MSG_NOSIGNAL);
+            if (escritos > 0) {
+                escritosTotal += escritos;
+            } else if (escritos == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                break;  // El próximo EPOLLOUT sigue desde aquí
+            } else {
+                estadisticas.desconectados++;
+                cerrar(cliente);
+                return;
+            }
+        }
+        cliente.salida.erase(0, escritosTotal);
+    }
+
+    void fallar(ClienteSimulado& cliente) {
+        if (cliente.estado == EstadoCliente::CONECTANDO || cliente.estado == EstadoCliente::ESPERANDO_SOLICITUD) {
+            conexionesEnCurso--;
+        }
+        estadisticas.fallos++;
+        saludosFallidos.fetch_add(1);
+        cerrar(cliente);
+    }
+
+    void cerrar(ClienteSimulado& cliente) {
+        if (cliente.descriptor != -1) {
+            close(cliente.descriptor);  // También lo saca del epoll
+            cliente.descriptor = -1;
+        }
+        cliente.estado = EstadoCliente::CERRADO;
+    }
+
+    const Configuracion& configuracion;
+    std::size_t numeroHilo;
+    int epoll;
+    sockaddr_in direccion;
+    std::vector<ClienteSimulado> clientes;
+    std::size_t siguienteConexion;
+    std::size_t conexionesEnCurso;
+    std::vector<char> buffer;
+    EstadisticasHilo estadisticas;
+};
+
+static void dormirSegundos(double segundos) {
+    std::this_thread::sleep_for(std::chrono::duration<double>(segundos));
+}
+
+// Esperar hasta que la condición se cumpla o pase el plazo; devuelve si se cumplió
+template <typename Condicion>
+static bool esperarHasta(Condicion condicion, double plazoSegundos) {
+    auto limite = std::chrono::steady_clock::now() + std::chrono::duration<double>(plazoSegundos);
+    while (!condicion()) {
+        if (std::chrono::steady_clock::now() >= limite) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return true;
+}
+
+// Percentil en microsegundos de un histograma en nanosegundos; la cubeta da el límite superior,
+// que se recorta al máximo observado
+static double percentilUs(const InstantaneaHistograma& histograma, double fraccion, std::uint64_t maximo) {
+    return std::min(histograma.percentil(fraccion), maximo) / 1000.0;
+}
+
+static bool leerConfiguracion(int argc, char* argv[], Configuracion& configuracion) {
+    if (argc < 3) {
+        return false;
+    }
+    configuracion.direccionIP = argv[1];
+    configuracion.puerto = std::atoi(argv[2]);
+    for (int i = 3; i + 1 < argc; i += 2) {
+        std::string opcion = argv[i];
+        std::string valor = argv[i + 1];
+        if (opcion == "--clientes") {
+            configuracion.clientes = std::stoul(valor);
+        } else if (opcion == "--emisores") {
+            configuracion.emisores = std::stoul(valor);
+        } else if (opcion == "--tasa") {
+            configuracion.tasa = std::stod(valor);
+        } else if (opcion == "--duracion") {
+            configuracion.duracion = std::stod(valor);
+        } else if (opcion == "--calentamiento") {
+            configuracion.calentamiento = std::stod(valor);
+        } else if (opcion == "--hilos") {
+            configuracion.hilos = std::max<std::size_t>(1, std::stoul(valor));
+        } else if (opcion == "--protocolo") {
+            if (valor != "texto" && valor != "tramas") {
+                return false;
+            }
+            configuracion.tramas = valor == "tramas";
+        } else if (opcion == "--tamano") {
+            configuracion.tamano = std::stoul(valor);
+        } else {
+            std::cerr << "Opción desconocida: " << opcion << "\n";
+            return false;
+        }
+    }
+    if ((argc - 3) % 2 != 0) {
+        return false;
+    }
+    configuracion.emisores = std::min(configuracion.emisores, configuracion.clientes);
+    configuracion.hilos = std::min(configuracion.hilos, std::max<std::size_t>(1, configuracion.clientes));
+    return configuracion.puerto > 0 && configuracion.clientes > 0;
+}
+
+// Subir el límite de descriptores al máximo permitido: cada cliente simulado es un socket
+static void subirLimiteDescriptores(std::size_t necesarios) {
+    rlimit limite;
+    if (getrlimit(RLIMIT_NOFILE, &limite) == 0 && limite.rlim_cur < limite.rlim_max) {
+        limite.rlim_cur = limite.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limite);
+    }
+    if (getrlimit(RLIMIT_NOFILE, &limite) == 0 && limite.rlim_cur < necesarios + 64) {
+        std::cerr << "Aviso: el límite de descriptores (" << limite.rlim_cur << ") no alcanza para "
+                  << necesarios << " clientes.\n";
+    }
+}
+
+int main(int argc, char* argv[]) {
+    Configuracion configuracion;
+    if (!leerConfiguracion(argc, argv, configuracion)) {
+        std::cerr << "Uso: " << argv[0] << " <direccionIP> <puerto> [--clientes N] [--emisores M]"
+                  << " [--tasa mensajesPorSegundo] [--duracion s] [--calentamiento s] [--hilos H]"
+                  << " [--protocolo texto|tramas] [--tamano bytes]\n";
+        return 1;
+    }
+    subirLimiteDescriptores(configuracion.clientes);
+
+    std::vector<std::unique_ptr<HiloClientes>> grupos;
+    std::vector<std::thread> hilos;
+    for (std::size_t h = 0; h < configuracion.hilos; ++h) {
+        grupos.emplace_back(new HiloClientes(configuracion, h));
+    }
+    for (auto& grupo : grupos) {
+        hilos.emplace_back(&HiloClientes::ejecutar, grupo.get());
+    }
+
+    // Conexión: todos los clientes completan el saludo o fallan
+    std::int64_t inicioConexiones = ahoraNs();
+    esperarHasta([&]() { return saludosCompletos.load() + saludosFallidos.load() >= configuracion.clientes; },
+                 configuracion.tiempoConexion);
+    double segundosConexion = (ahoraNs() - inicioConexiones) / 1e9;
+    std::size_t conectados = saludosCompletos.load();
+
+    // Sincronización: el servidor tiene registrados a todos los que completaron el saludo
+    fase.store(SINCRONIZANDO);
+    bool sincronizado = esperarHasta([&]() { return usuariosServidor.load() >= conectados; }, 10.0);
+
+    inicioEnvioNs.store(ahoraNs());
+    fase.store(CALENTANDO);
+    dormirSegundos(configuracion.calentamiento);
+    inicioMedicionNs.store(ahoraNs());
+    fase.store(MIDIENDO);
+    dormirSegundos(configuracion.duracion);
+    finMedicionNs.store(ahoraNs());
+    fase.store(DRENANDO);
+    dormirSegundos(configuracion.drenado);
+    fase.store(TERMINADO);
+    for (auto& hilo : hilos) {
+        hilo.join();
+    }
+
+    // Sumar las estadísticas de todos los hilos
+    EstadisticasHilo total;
+    for (auto& grupo : grupos) {
+        const EstadisticasHilo& parcial = grupo->obtenerEstadisticas();
+        for (std::size_t i = 0; i < CUBETAS_HISTOGRAMA; ++i) {
+            total.latencias.cubetas[i] += parcial.latencias.cubetas[i];
+            total.saludos.cubetas[i] += parcial.saludos.cubetas[i];
+        }
+        total.latenciaMaxima = std::max(total.latenciaMaxima, parcial.latenciaMaxima);
+        total.saludoMaximo = std::max(total.saludoMaximo, parcial.saludoMaximo);
+        total.enviados += parcial.enviados;
+        total.descartados += parcial.descartados;
+        total.entregas += parcial.entregas;
+        total.desconectados += parcial.desconectados;
+        total.fallos += parcial.fallos;
+    }
+
+    double segundos = (finMedicionNs.load() - inicioMedicionNs.load()) / 1e9;
+    std::uint64_t esperadas = total.enviados * (conectados > 0 ? conectados - 1 : 0);
+    std::ostringstream json;
+    json << std::fixed << std::setprecision(1);
+    json << "{\"servidor\":\"" << configuracion.direccionIP << ":" << configuracion.puerto << "\""
+         << ",\"protocolo\":\"" << (configuracion.tramas ? "tramas" : "texto") << "\""
+         << ",\"clientes\":" << configuracion.clientes << ",\"emisores\":" << configuracion.emisores
+         << ",\"tasaPorEmisor\":" << configuracion.tasa << ",\"tamano\":" << configuracion.tamano
+         << ",\"hilos\":" << configuracion.hilos << ",\"duracionS\":" << segundos
+         << ",\"conectados\":" << conectados << ",\"fallosConexion\":" << total.fallos
+         << ",\"sincronizado\":" << (sincronizado ? "true" : "false") << ",\"segundosConexion\":" << segundosConexion
+         << ",\"saludoUs\":{\"p50\":" << percentilUs(total.saludos, 0.50, total.saludoMaximo) << ",\"p99\":" << percentilUs(total.saludos, 0.99, total.saludoMaximo)
+         << ",\"max\":" << total.saludoMaximo / 1000.0 << "}"
+         << ",\"enviados\":" << total.enviados << ",\"descartados\":" << total.descartados
+         << ",\"entregas\":" << total.entregas << ",\"entregasEsperadas\":" << esperadas
+         << ",\"mensajesPorSegundo\":" << (segundos > 0 ? total.enviados / segundos : 0.0)
+         << ",\"entregasPorSegundo\":" << (segundos > 0 ? total.entregas / segundos : 0.0)
+         << ",\"latenciaUs\":{\"p50\":" << percentilUs(total.latencias, 0.50, total.latenciaMaxima)
+         << ",\"p90\":" << percentilUs(total.latencias, 0.90, total.latenciaMaxima) << ",\"p99\":" << percentilUs(total.latencias, 0.99, total.latenciaMaxima)
+         << ",\"p999\":" << percentilUs(total.latencias, 0.999, total.latenciaMaxima) << ",\"max\":" << total.latenciaMaxima / 1000.0 << "}"
+         << ",\"desconectados\":" << total.desconectados << "}";
+    std::cout << json.str() << std::endl;
+
+    std::cerr << std::fixed << std::setprecision(1) << conectados << "/" << configuracion.clientes
+              << " clientes conectados en " << segundosConexion << " s" << (sincronizado ? "" : " (sin sincronizar)")
+              << "; " << total.enviados << " mensajes y " << total.entregas << " de " << esperadas
+              << " entregas en " << segundos << " s; latencia p50 " << percentilUs(total.latencias, 0.50, total.latenciaMaxima)
+              << " µs, p99 " << percentilUs(total.latencias, 0.99, total.latenciaMaxima) << " µs, máx " << total.latenciaMaxima / 1000.0
+              << " µs; " << total.desconectados << " desconectados\n";
+    return 0;
+}
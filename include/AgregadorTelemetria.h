@@ -0,0 +1,121 @@
+#ifndef AGREGADORTELEMETRIA_H
+#define AGREGADORTELEMETRIA_H
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include "Telemetria.h"
+
+class SegmentoTelemetria;
+
+// Valores de cada muestra sobre los que se calculan agregados
+enum MetricaSerie {
+    METRICA_USUARIOS = 0,
+    METRICA_TASA,             // Mensajes por segundo (ventana de 1 s del servidor)
+    METRICA_COLAS,            // Bytes pendientes en las colas de salida
+    METRICA_MEMORIA,          // KB residentes
+    METRICA_PROCESAMIENTO,    // p99 del procesamiento de mensajes, en ns
+    NUMERO_METRICAS
+};
+
+struct MuestraTelemetria {
+    std::int64_t instanteNs;  // Recepción en el monitor (steady_clock)
+    double valores[NUMERO_METRICAS];
+};
+
+// Agregado de una métrica en una ventana de tiempo
+struct ResumenMetrica {
+    std::size_t muestras;
+    double minimo;
+    double maximo;
+    double promedio;
+    double p50;
+    double p99;
+};
+
+// Contadores globales de la ingesta
+struct EstadisticasIngesta {
+    std::uint64_t paquetes;
+    std::uint64_t lotes;              // Llamadas a recvmmsg que devolvieron datos
+    std::uint64_t descartados;        // Formato o versión desconocidos
+    std::uint64_t perdidos;           // Huecos en la secuencia de algún servidor
+    std::uint64_t perdidosNucleo;     // Descartados por el núcleo con el buffer del socket lleno (SO_RXQ_OVFL)
+    std::uint64_t sinCapacidad;       // Paquetes de servidores que ya no caben en el agregador
+    double retrasoPromedioUs;         // Desde que el núcleo recibió el paquete hasta que se procesó
+    double retrasoMaximoUs;
+    bool memoriaCompartida;           // Lectura del segmento compartido en lugar de UDP
+    std::uint64_t reintentosLectura;  // Relecturas de una ranura que el servidor estaba escribiendo
+};
+
+// Serie de un servidor: un anillo de tamaño fijo con sus últimas muestras y el último paquete completo.
+// Cada serie tiene su propio mutex: la ingesta y la presentación nunca comparten un candado global.
+class SerieServidor {
+public:
+    SerieServidor(std::uint16_t puerto, std::size_t capacidad);
+
+    void agregar(const PaqueteTelemetria& paquete, std::int64_t instanteNs);  // Solo la ingesta
+    // Memoria compartida: el último paquete siempre, pero una muestra por intervalo para que el
+    // anillo cubra el mismo tiempo que con UDP. Sin huecos de secuencia: las escrituras se pisan.
+    void actualizar(const PaqueteTelemetria& paquete, std::int64_t instanteNs, std::int64_t intervaloMuestrasNs);
+    void resumir(std::int64_t desdeNs, ResumenMetrica resumenes[NUMERO_METRICAS]) const;
+    bool ultimoPaquete(PaqueteTelemetria& paquete, std::int64_t& instanteNs) const;
+    std::uint64_t obtenerPerdidos() const;
+    std::uint16_t obtenerPuerto() const { return puerto; }
+
+private:
+    void guardarMuestra(const PaqueteTelemetria& paquete, std::int64_t instanteNs);  // Con mutexSerie tomado
+
+    std::uint16_t puerto;
+    mutable std::mutex mutexSerie;
+    std::vector<MuestraTelemetria> muestras;
+    std::size_t siguiente;
+    std::size_t cantidad;
+    PaqueteTelemetria ultimo;
+    std::int64_t instanteUltimo;
+    std::uint64_t perdidos;  // Huecos de secuencia de la instancia actual
+};
+
+// Ingesta de telemetría: lee los datagramas por lotes con recvmmsg y los reparte en series por puerto.
+// La memoria es fija: MAX_SERVIDORES_AGREGADOS series de 'capacidad' muestras.
+class AgregadorTelemetria {
+public:
+    static const std::size_t MAX_SERVIDORES_AGREGADOS = 1024;
+
+    explicit AgregadorTelemetria(std::size_t capacidadPorServidor);
+    ~AgregadorTelemetria();
+
+    bool abrir(const char* direccionIP, std::uint16_t puerto);
+    void ingerir();  // Bucle de recepción; no retorna salvo error
+    // Alternativa a abrir/ingerir: recorrer las ranuras del segmento compartido; no retorna
+    void leerCompartida(const SegmentoTelemetria& segmento, std::chrono::milliseconds intervaloMuestras);
+
+    // Seguras desde cualquier hilo
+    std::size_t numeroServidores() const { return servidores.load(std::memory_order_acquire); }
+    const SerieServidor& serie(std::size_t indice) const { return *series[indice]; }
+    EstadisticasIngesta obtenerEstadisticas() const;
+
+private:
+    SerieServidor* buscarSerie(std::uint16_t puerto);
+
+    std::size_t capacidadPorServidor;
+    int descriptor;
+    std::unique_ptr<std::unique_ptr<SerieServidor>[]> series;
+    std::atomic<std::size_t> servidores;  // Series publicadas; solo crecen
+    std::vector<int> indicePorPuerto;     // Puerto -> índice + 1; solo lo toca la ingesta
+
+    std::atomic<std::uint64_t> paquetes;
+    std::atomic<std::uint64_t> lotes;
+    std::atomic<std::uint64_t> descartados;
+    std::atomic<std::uint64_t> perdidosNucleo;
+    std::atomic<std::uint64_t> sinCapacidad;
+    std::atomic<std::uint64_t> retrasoTotalNs;
+    std::atomic<std::uint64_t> retrasoMaximoNs;
+    std::atomic<bool> memoriaCompartida;
+    std::atomic<std::uint64_t> reintentosLectura;
+};
+
+#endif // AGREGADORTELEMETRIA_H
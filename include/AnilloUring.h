@@ -0,0 +1,97 @@
+#ifndef ANILLOURING_H
+#define ANILLOURING_H
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <linux/io_uring.h>
+
+// Anillo de io_uring con llamadas directas al sistema (io_uring_setup, io_uring_enter y
+// io_uring_register), sin liburing. Lo usa un solo hilo: el del reactor que lo creó.
+//
+// Las entradas se preparan en la cola de envío sin llamadas al sistema y salen todas juntas en el
+// siguiente enviar() o esperar(); las completadas se recorren directamente en la memoria compartida.
+class AnilloUring {
+public:
+    AnilloUring();
+    ~AnilloUring();
+
+    // El núcleo tiene io_uring habilitado y las operaciones que usa el reactor
+    static bool disponible();
+
+    bool iniciar(unsigned entradas);
+
+    // Entrada libre y en cero; si la cola está llena envía lo preparado para hacer lugar
+    io_uring_sqe* obtenerEntrada();
+    bool enviar();   // Sin esperar completadas
+    bool esperar();  // Envía lo preparado y espera al menos una completada
+
+    // Recorrer las completadas disponibles y liberarlas al terminar; devuelve cuántas hubo
+    template <typename Funcion>
+    unsigned recorrerCompletadas(Funcion funcion) {
+        unsigned cabeza = *cabezaCompletadas;
+        unsigned cola = __atomic_load_n(colaCompletadas, __ATOMIC_ACQUIRE);
+        unsigned cantidad = cola - cabeza;
+        for (; cabeza != cola; ++cabeza) {
+            funcion(completadas[cabeza & mascaraCompletadas]);
+        }
+        __atomic_store_n(cabezaCompletadas, cola, __ATOMIC_RELEASE);
+        return cantidad;
+    }
+
+    int obtenerDescriptor() const { return descriptor; }
+    std::uint64_t obtenerLlamadas() const { return llamadas; }  // io_uring_enter hechas
+
+private:
+    bool entrar(unsigned aEnviar, unsigned minimo, unsigned banderas);
+
+    int descriptor;
+    void* memoriaEnvio;
+    std::size_t tamanoEnvio;
+    void* memoriaCompletadas;
+    std::size_t tamanoCompletadas;
+    io_uring_sqe* entradas;
+    std::size_t tamanoEntradas;
+
+    unsigned* cabezaEnvio;
+    unsigned* colaEnvio;
+    unsigned mascaraEnvio;
+    unsigned* indicesEnvio;
+    unsigned entradasEnvio;
+    unsigned colaLocal;  // Entradas preparadas; se publican en colaEnvio al enviar
+
+    unsigned* cabezaCompletadas;
+    unsigned* colaCompletadas;
+    unsigned mascaraCompletadas;
+    io_uring_cqe* completadas;
+
+    std::uint64_t llamadas;
+};
+
+// Grupo de buffers provistos (IORING_REGISTER_PBUF_RING): el núcleo elige uno libre en cada
+// recepción y lo informa en la completada; el reactor lo devuelve cuando terminó de procesarlo.
+class GrupoBuffers {
+public:
+    GrupoBuffers(AnilloUring& anillo, std::uint16_t grupo, unsigned cantidad, std::size_t tamano);
+    ~GrupoBuffers();
+
+    bool registrar();  // cantidad debe ser potencia de dos
+    std::uint16_t obtenerGrupo() const { return grupo; }
+    std::size_t obtenerTamano() const { return tamano; }
+    const char* buffer(std::uint16_t indice) const { return &datos[indice * tamano]; }
+    void devolver(std::uint16_t indice);
+
+private:
+    AnilloUring& anillo;
+    std::uint16_t grupo;
+    unsigned cantidad;
+    std::size_t tamano;
+    std::vector<char> datos;
+    // El anillo se recorre como un arreglo de io_uring_buf: en C++ el miembro flexible de
+    // io_uring_buf_ring queda desplazado. La cola es el campo 'resv' de la primera entrada.
+    io_uring_buf* anilloBuffers;  // Alineado a página, como pide el núcleo
+    std::uint16_t cola;
+    bool registrado;
+};
+
+#endif // ANILLOURING_H
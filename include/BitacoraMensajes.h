@@ -0,0 +1,128 @@
+#ifndef BITACORAMENSAJES_H
+#define BITACORAMENSAJES_H
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+// Bitácora de mensajes de solo anexado, en segmentos de tamaño fijo mapeados en memoria.
+//
+// Cada registro lleva una cabecera propia (longitud, tipo e instante) seguida de la trama tal
+// como viaja por la red (cabecera de trama + texto), así que la reproducción sale directo del
+// mapeo: a un cliente con tramas se le envía la trama guardada y a uno en modo texto solo el
+// texto, sin construir mensajes nuevos.
+//
+// Anexar no toma candados: la posición se reserva con un fetch_add sobre un desplazamiento
+// virtual (segmento = posición / capacidad) y el número de registro con otro, que indexa un
+// anillo en memoria con la posición, la longitud y el instante de los últimos registros. Cada
+// entrada del índice se publica como un seqlock cuando el registro ya está escrito. Solo se
+// toma un mutex al abrir un segmento nuevo, lo que mantener() hace por adelantado.
+
+// Cabecera de cada registro dentro del segmento
+struct CabeceraRegistro {
+    std::uint32_t longitud;  // Bytes del registro con cabecera y relleno; 0 = todavía sin escribir
+    std::uint32_t tipo;      // TipoRegistro
+    std::int64_t instanteNs; // Reloj de pared, para que la ventana de tiempo sobreviva a un reinicio
+};
+
+enum TipoRegistro : std::uint32_t {
+    REGISTRO_MENSAJE = 1,
+    REGISTRO_RELLENO = 2  // Bytes sin usar de una reserva que cruzó el final de un segmento
+};
+
+struct ConfiguracionBitacora {
+    std::string directorio;
+    std::size_t capacidadSegmento = 4 * 1024 * 1024;
+    std::size_t segmentosRetenidos = 4;  // Segmentos que se conservan mapeados y en disco; los más viejos se borran
+};
+
+// Archivo de un segmento mapeado; se desmapea cuando nadie (ni una cola de salida) lo usa
+class SegmentoBitacora {
+public:
+    static std::shared_ptr<SegmentoBitacora> abrir(const std::string& ruta, std::uint64_t numero, std::size_t capacidad);
+    ~SegmentoBitacora();
+
+    char* obtenerDatos() const { return datos; }
+    std::uint64_t obtenerNumero() const { return numero; }
+
+private:
+    SegmentoBitacora(int descriptor, char* datos, std::size_t capacidad, std::uint64_t numero)
+        : descriptor(descriptor), datos(datos), capacidad(capacidad), numero(numero) {}
+
+    int descriptor;
+    char* datos;
+    std::size_t capacidad;
+    std::uint64_t numero;
+};
+
+// Registro de la bitácora listo para enviar: la trama (cabecera de trama + texto) y su segmento
+struct RegistroHistorial {
+    const char* trama;
+    std::size_t longitudTrama;
+    std::shared_ptr<SegmentoBitacora> segmento;
+};
+
+class BitacoraMensajes {
+public:
+    explicit BitacoraMensajes(const ConfiguracionBitacora& configuracion);
+    ~BitacoraMensajes();
+
+    // Crear el directorio y recuperar los segmentos de un arranque anterior
+    bool abrir();
+
+    // Seguro desde cualquier hilo y sin candados salvo al cambiar de segmento
+    void agregar(const char* texto, std::size_t longitud);
+
+    // Últimos 'maximoMensajes' registros de la ventana (0 = sin límite de tiempo) que suman como
+    // mucho 'maximoBytes', del más viejo al más nuevo
+    void historial(std::size_t maximoMensajes, std::chrono::seconds ventana, std::size_t maximoBytes,
+                   std::vector<RegistroHistorial>& destino) const;
+
+    // Abrir por adelantado el segmento siguiente al actual; lo llama una tarea periódica del reactor 0
+    void mantener();
+
+    std::uint64_t obtenerRegistros() const { return siguienteRegistro.load(std::memory_order_relaxed); }
+
+private:
+    static const std::size_t RANURAS_SEGMENTOS = 16;
+    static const std::size_t CAPACIDAD_INDICE = 1 << 16;
+
+    // Segmento abierto en una ranura (número % RANURAS_SEGMENTOS)
+    struct Ranura {
+        std::atomic<std::int64_t> numero;       // Segmento que contiene, o -1 mientras se cambia
+        std::atomic<char*> datos;
+        std::atomic<std::uint32_t> escritores;  // Escritores dentro de la ranura
+        std::shared_ptr<SegmentoBitacora> segmento;  // Protegido por mutexSegmentos
+    };
+
+    // Entrada del índice publicada como seqlock: version = número de registro + 1
+    struct EntradaIndice {
+        std::atomic<std::uint64_t> version;
+        std::atomic<std::uint64_t> posicion;
+        std::atomic<std::uint32_t> longitud;
+        std::atomic<std::int64_t> instanteNs;
+    };
+
+    std::string rutaSegmento(std::uint64_t numero) const;
+    bool prepararSegmento(std::uint64_t numero);  // Con mutexSegmentos tomado
+    void liberarRanura(Ranura& ranura);            // Con mutexSegmentos tomado
+    char* entrarRanura(std::uint64_t numero);      // nullptr si el segmento ya no existe
+    void salirRanura(std::uint64_t numero);
+    void publicarIndice(std::uint64_t registro, std::uint64_t posicion, std::uint32_t longitud, std::int64_t instanteNs);
+    void recuperarSegmento(std::uint64_t numero);
+
+    ConfiguracionBitacora configuracion;
+    std::unique_ptr<Ranura[]> ranuras;
+    std::unique_ptr<EntradaIndice[]> indice;
+    std::atomic<std::uint64_t> cabeza;             // Siguiente posición virtual libre
+    std::atomic<std::uint64_t> siguienteRegistro;  // Siguiente número de registro
+    mutable std::mutex mutexSegmentos;             // Solo para abrir segmentos y copiar sus referencias
+    std::atomic<bool> abierta;
+};
+
+#endif // BITACORAMENSAJES_H
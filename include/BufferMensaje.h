@@ -0,0 +1,92 @@
+#ifndef BUFFERMENSAJE_H
+#define BUFFERMENSAJE_H
+
+#include <string>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <utility>
+#include "VistaTexto.h"
+
+// Trozo de texto que se copia al construir un mensaje
+struct Fragmento {
+    Fragmento(const char* datos, std::size_t longitud) : datos(datos), longitud(longitud) {}
+    Fragmento(const char* texto);
+    Fragmento(const std::string& texto) : datos(texto.data()), longitud(texto.size()) {}
+    Fragmento(VistaTexto texto) : datos(texto.datos()), longitud(texto.longitud()) {}
+
+    const char* datos;
+    std::size_t longitud;
+};
+
+class ReferenciaMensaje;
+
+// Mensaje inmutable con contador de referencias atómico.
+// Se construye una vez por mensaje y lo comparten las colas de salida de todos los destinatarios;
+// la memoria sale de un pool por tamaños y vuelve a él cuando termina la última escritura.
+class BufferMensaje {
+public:
+    static ReferenciaMensaje crear(std::initializer_list<Fragmento> fragmentos);
+    static ReferenciaMensaje crear(const char* datos, std::size_t longitud);
+    static ReferenciaMensaje crear(const std::string& texto);
+
+    const char* datos() const { return contenido; }
+    std::size_t longitud() const { return tamano; }
+
+private:
+    friend class ReferenciaMensaje;
+
+    BufferMensaje() {}
+    void retener() { referencias.fetch_add(1, std::memory_order_relaxed); }
+    void soltar();
+
+    std::atomic<std::uint32_t> referencias;
+    std::uint32_t tamano;
+    std::uint32_t claseTamano;  // Clase del pool de la que salió el bloque
+    char contenido[1];  // Los datos continúan después de la cabecera
+};
+
+// Puntero con conteo de referencias a un BufferMensaje.
+// Uno estático no debe destruirse al salir (créese con new): soltar la última referencia usa la
+// caché del hilo, que para entonces puede estar destruida.
+class ReferenciaMensaje {
+public:
+    ReferenciaMensaje() : buffer(nullptr) {}
+    ReferenciaMensaje(const ReferenciaMensaje& otra) : buffer(otra.buffer) {
+        if (buffer) {
+            buffer->retener();
+        }
+    }
+    ReferenciaMensaje(ReferenciaMensaje&& otra) : buffer(otra.buffer) { otra.buffer = nullptr; }
+    ~ReferenciaMensaje() {
+        if (buffer) {
+            buffer->soltar();
+        }
+    }
+
+    ReferenciaMensaje& operator=(ReferenciaMensaje otra) {
+        std::swap(buffer, otra.buffer);
+        return *this;
+    }
+
+    const BufferMensaje* operator->() const { return buffer; }
+    const BufferMensaje& operator*() const { return *buffer; }
+    explicit operator bool() const { return buffer != nullptr; }
+
+private:
+    friend class BufferMensaje;
+    explicit ReferenciaMensaje(BufferMensaje* buffer) : buffer(buffer) {}
+
+    BufferMensaje* buffer;
+};
+
+// Estadísticas globales del pool de mensajes
+struct EstadisticasPoolMensajes {
+    std::uint64_t reservas;        // Mensajes creados
+    std::uint64_t reservasSistema; // Bloques pedidos a malloc (fallos del pool)
+};
+
+EstadisticasPoolMensajes obtenerEstadisticasPoolMensajes();
+
+#endif // BUFFERMENSAJE_H
@@ -0,0 +1,114 @@
+#ifndef BUSFEDERACION_H
+#define BUSFEDERACION_H
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <condition_variable>
+#include <unordered_map>
+#include <cstddef>
+#include <cstdint>
+#include <sys/uio.h>
+#include "BufferMensaje.h"
+#include "RegistroCanales.h"
+
+// Bus de federación: varios servidores en la misma máquina forman un solo chat.
+//
+// Cada servidor numera los mensajes de chat que origina (secuencia por instancia, desde 1) y los
+// guarda en un anillo. Por cada par hay un hilo emisor con una conexión TCP al puerto de chat del
+// par, que se presenta con PREAMBULO_FEDERACION y una trama HOLA con su origen y la próxima
+// secuencia que va a publicar. El par responde ESTADO con la última secuencia que aplicó de ese
+// origen, y el emisor sigue desde ahí: tras un corte no se pierde ni se repite nada que siga en
+// el anillo. Un par que no conocía el origen (recién arrancado) empieza por lo nuevo, sin recibir
+// lo que ya había en el anillo.
+//
+// Los mensajes viajan en lotes (LOTE) de hasta MAX_MENSAJES_LOTE, con una espera corta para
+// llenarlos. El receptor aplica cada secuencia una sola vez y en orden por origen: descarta las
+// que ya aplicó y cuenta los huecos (mensajes que salieron del anillo antes de enviarse).
+// Cada enlace es de un solo sentido; los mensajes no se reenvían a terceros, así que los pares
+// deben formar una malla completa.
+
+struct EstadisticasFederacion {
+    std::uint64_t publicados;          // Mensajes locales puestos en el bus
+    std::uint64_t lotesEnviados;
+    std::uint64_t mensajesEnviados;    // Suma sobre todos los pares
+    std::uint64_t aplicados;           // Mensajes de otros servidores entregados aquí
+    std::uint64_t duplicados;          // Descartados por ya aplicados
+    std::uint64_t huecos;              // Secuencias que nunca llegaron
+    std::uint32_t paresConectados;
+    std::uint32_t pares;
+};
+
+class BusFederacion {
+public:
+    BusFederacion(std::uint64_t idInstancia, const std::string& direccionIP, const std::vector<int>& puertosPares);
+    ~BusFederacion();
+
+    void iniciar();  // Lanza un hilo emisor por par
+
+    // Desde cualquier hilo: replicar un mensaje de chat del canal en los pares
+    void publicar(const std::string& canal, const ReferenciaMensaje& mensaje);
+
+    // Lado receptor, desde los hilos que leen los enlaces entrantes
+    // Respuesta a HOLA: la última secuencia aplicada del origen; uno nuevo empieza en 'primera'
+    std::uint64_t registrarOrigen(std::uint64_t origen, std::uint64_t primera);
+    bool aceptar(std::uint64_t origen, std::uint64_t secuencia);  // false si es un duplicado
+
+    EstadisticasFederacion obtenerEstadisticas() const;
+
+    static const std::size_t MAX_MENSAJES_LOTE = 256;
+    static const std::size_t CAPACIDAD_ANILLO = 1 << 14;
+
+private:
+    // El nombre del canal va en línea para que copiar la entrada al lote no reserve memoria
+    struct EntradaBus {
+        std::uint64_t secuencia;
+        std::uint8_t longitudCanal;
+        char canal[MAX_NOMBRE_CANAL];
+        ReferenciaMensaje mensaje;
+    };
+
+    // Enlace saliente hacia un par; solo lo toca su hilo emisor
+    struct Par {
+        int puerto;
+        int descriptor;
+        std::uint64_t siguiente;  // Próxima secuencia por enviar
+        std::vector<char> prefijos;  // Longitudes y canal de cada mensaje del lote
+        std::vector<iovec> partes;
+    };
+
+    void emitir(Par& par);
+    bool conectar(Par& par);
+    bool enviarLote(Par& par, std::vector<EntradaBus>& lote);
+    bool enlaceAbierto(Par& par);
+    void cerrar(Par& par);
+    std::uint64_t primeraRetenida() const;  // Con mutexAnillo tomado
+
+    std::uint64_t idInstancia;
+    std::string direccionIP;
+    std::vector<std::unique_ptr<Par>> pares;
+    std::vector<std::thread> hilos;
+    std::atomic<bool> activo;
+
+    // Anillo de mensajes locales
+    mutable std::mutex mutexAnillo;
+    std::condition_variable hayMensajes;
+    std::vector<EntradaBus> anillo;
+    std::uint64_t ultimaPublicada;
+
+    // Última secuencia aplicada de cada origen
+    mutable std::mutex mutexOrigenes;
+    std::unordered_map<std::uint64_t, std::uint64_t> origenes;
+
+    std::atomic<std::uint64_t> lotesEnviados;
+    std::atomic<std::uint64_t> mensajesEnviados;
+    std::atomic<std::uint64_t> aplicados;
+    std::atomic<std::uint64_t> duplicados;
+    std::atomic<std::uint64_t> huecos;
+    std::atomic<std::uint32_t> paresConectados;
+};
+
+#endif // BUSFEDERACION_H
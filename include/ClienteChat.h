@@ -2,21 +2,39 @@
 #define CLIENTECHAT_H
 
 #include <string>
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <cstdint>
+#include <sys/uio.h>
 
 class ClienteChat {
 public:
-    ClienteChat(const std::string& direccionIP, int puerto);
+    // usarTramas: hablar con el protocolo de tramas en lugar del modo texto (ver Protocolo.h)
+    ClienteChat(const std::string& direccionIP, int puerto, bool usarTramas = false);
     void conectarAlServidor();
     void manejarComando(const std::string& comando);
+    // Envía varios comandos con una sola llamada vectorizada (sendmsg: writev con MSG_NOSIGNAL).
+    // Con tramas el servidor recibe exactamente lo mismo que con manejarComando uno por uno; en
+    // modo texto no hay límites entre mensajes, así que se envían uno por uno para no fundirlos.
+    void manejarComandos(const std::vector<std::string>& comandos);
     void desconectar();
 
 private:
+    bool seguirRedireccion();
     void recibirMensajes();
+    void recibirTramas();
+    bool enviarVectores(iovec* vectores, int cantidad);
+    std::uint8_t tipoSiguienteTrama();
 
     std::string direccionIP;  // Dirección IP del servidor
     int puerto;  // Puerto del servidor
     int descriptorCliente;  // Descriptor del socket del cliente
     bool conectado;  // Estado de la conexión
+    bool usarTramas;  // Protocolo con tramas
+    bool nombreEnviado;  // Con tramas, el primer comando es el nombre
+    std::atomic<bool> nombreRechazado;  // El servidor pidió otro nombre: el siguiente comando lo es
+    std::mutex mutexEnvio;  // Varias hebras envían comandos: cada trama sale entera
 };
 
 #endif // CLIENTECHAT_H
@@ -0,0 +1,325 @@
+#ifndef COLAMPMC_H
+#define COLAMPMC_H
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <new>
+#include <thread>
+#include <utility>
+#include <cstddef>
+#include <cstdint>
+#include <climits>
+#include <type_traits>
+#include <ctime>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+// Cola acotada de varios productores y varios consumidores sin candados (algoritmo de Vyukov).
+// Cada casilla lleva un número de secuencia que dice si está libre para la vuelta actual del
+// productor o llena para la del consumidor; los índices de cabeza y cola solo se disputan con
+// un compare_exchange y cada casilla ocupa su propia línea de caché. Los elementos se mueven
+// hacia dentro y hacia fuera, nunca se copian.
+//
+// Variantes:
+//   intentarEncolar / intentarDesencolar  no esperan: fallan si la cola está llena o vacía
+//   encolarGirando / desencolarGirando    reintentan con pausas de CPU y ceden el procesador
+//   encolar / desencolar                  giran un poco y luego duermen en un futex
+//   desencolarAntesDe / desencolarLote    como desencolar, con un límite de tiempo
+// cerrar() despierta a todos los que esperan: encolar falla y desencolar vacía lo que quede.
+template <typename T>
+class ColaMPMC {
+    static_assert(std::is_nothrow_move_constructible<T>::value, "ColaMPMC necesita elementos que se muevan sin excepciones");
+
+public:
+    // La capacidad se redondea a la siguiente potencia de dos
+    explicit ColaMPMC(std::size_t capacidadMinima)
+        : capacidad(redondearPotenciaDos(capacidadMinima)), mascara(capacidad - 1),
+          memoria(new char[capacidad * sizeof(Casilla) + LINEA_CACHE]) {
+        void* inicio = memoria.get();
+        std::size_t espacio = capacidad * sizeof(Casilla) + LINEA_CACHE;
+        casillas = static_cast<Casilla*>(std::align(LINEA_CACHE, capacidad * sizeof(Casilla), inicio, espacio));
+        for (std::size_t i = 0; i < capacidad; ++i) {
+            new (&casillas[i]) Casilla();
+            casillas[i].secuencia.store(i, std::memory_order_relaxed);
+        }
+        cola.posicion.store(0, std::memory_order_relaxed);
+        cabeza.posicion.store(0, std::memory_order_relaxed);
+        esperas.cerrada.store(false, std::memory_order_relaxed);
+        esperas.avisosDatos.store(0, std::memory_order_relaxed);
+        esperas.avisosEspacio.store(0, std::memory_order_relaxed);
+        esperas.esperandoDatos.store(0, std::memory_order_relaxed);
+        esperas.esperandoEspacio.store(0, std::memory_order_relaxed);
+    }
+
+    ~ColaMPMC() {
+        T descartado;
+        while (intentarDesencolar(descartado)) {
+        }
+        for (std::size_t i = 0; i < capacidad; ++i) {
+            casillas[i].~Casilla();
+        }
+    }
+
+    ColaMPMC(const ColaMPMC&) = delete;
+    ColaMPMC& operator=(const ColaMPMC&) = delete;
+
+    bool intentarEncolar(T&& valor) {
+        std::size_t posicion = cola.posicion.load(std::memory_order_relaxed);
+        while (true) {
+            Casilla& casilla = casillas[posicion & mascara];
+            std::size_t secuencia = casilla.secuencia.load(std::memory_order_acquire);
+            std::intptr_t diferencia = static_cast<std::intptr_t>(secuencia) - static_cast<std::intptr_t>(posicion);
+            if (diferencia == 0) {
+                if (cola.posicion.compare_exchange_weak(posicion, posicion + 1, std::memory_order_relaxed)) {
+                    new (&casilla.valor) T(std::move(valor));
+                    casilla.secuencia.store(posicion + 1, std::memory_order_release);
+                    avisar(esperas.avisosDatos, esperas.esperandoDatos);
+                    return true;
+                }
+            } else if (diferencia < 0) {
+                return false;  // Llena: la casilla todavía guarda un elemento de la vuelta anterior
+            } else {
+                posicion = cola.posicion.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool intentarDesencolar(T& destino) {
+        std::size_t posicion = cabeza.posicion.load(std::memory_order_relaxed);
+        while (true) {
+            Casilla& casilla = casillas[posicion & mascara];
+            std::size_t secuencia = casilla.secuencia.load(std::memory_order_acquire);
+            std::intptr_t diferencia = static_cast<std::intptr_t>(secuencia) - static_cast<std::intptr_t>(posicion + 1);
+            if (diferencia == 0) {
+                if (cabeza.posicion.compare_exchange_weak(posicion, posicion + 1, std::memory_order_relaxed)) {
+                    T* elemento = reinterpret_cast<T*>(&casilla.valor);
+                    destino = std::move(*elemento);
+                    elemento->~T();
+                    casilla.secuencia.store(posicion + capacidad, std::memory_order_release);
+                    avisar(esperas.avisosEspacio, esperas.esperandoEspacio);
+                    return true;
+                }
+            } else if (diferencia < 0) {
+                return false;  // Vacía
+            } else {
+                posicion = cabeza.posicion.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool encolarGirando(T&& valor) {
+        for (unsigned intento = 0; !intentarEncolar(std::move(valor)); ++intento) {
+            if (estaCerrada()) {
+                return false;
+            }
+            pausa(intento);
+        }
+        return true;
+    }
+
+    bool desencolarGirando(T& destino) {
+        for (unsigned intento = 0; !intentarDesencolar(destino); ++intento) {
+            if (estaCerrada() && vacia()) {
+                return false;
+            }
+            pausa(intento);
+        }
+        return true;
+    }
+
+    // Devuelve false solo si la cola se cerró
+    bool encolar(T&& valor) {
+        while (true) {
+            for (unsigned intento = 0; intento < GIROS_ANTES_DE_DORMIR; ++intento) {
+                if (estaCerrada()) {
+                    return false;
+                }
+                if (intentarEncolar(std::move(valor))) {
+                    return true;
+                }
+                pausa(intento);
+            }
+            std::uint32_t aviso = registrarEspera(esperas.avisosEspacio, esperas.esperandoEspacio);
+            bool listo = intentarEncolar(std::move(valor));
+            if (!listo && !estaCerrada()) {
+                dormir(esperas.avisosEspacio, aviso);
+            }
+            esperas.esperandoEspacio.fetch_sub(1, std::memory_order_relaxed);
+            if (listo) {
+                return true;
+            }
+        }
+    }
+
+    // Devuelve false solo si la cola está cerrada y vacía
+    bool desencolar(T& destino) {
+        while (true) {
+            for (unsigned intento = 0; intento < GIROS_ANTES_DE_DORMIR; ++intento) {
+                if (intentarDesencolar(destino)) {
+                    return true;
+                }
+                if (estaCerrada() && vacia()) {
+                    return false;
+                }
+                pausa(intento);
+            }
+            std::uint32_t aviso = registrarEspera(esperas.avisosDatos, esperas.esperandoDatos);
+            bool listo = intentarDesencolar(destino);
+            if (!listo && !estaCerrada()) {
+                dormir(esperas.avisosDatos, aviso);
+            }
+            esperas.esperandoDatos.fetch_sub(1, std::memory_order_relaxed);
+            if (listo) {
+                return true;
+            }
+        }
+    }
+
+    // Como desencolar, pero se rinde al llegar a 'limite'
+    bool desencolarAntesDe(T& destino, std::chrono::steady_clock::time_point limite) {
+        while (true) {
+            for (unsigned intento = 0; intento < GIROS_ANTES_DE_DORMIR; ++intento) {
+                if (intentarDesencolar(destino)) {
+                    return true;
+                }
+                if ((estaCerrada() && vacia()) || std::chrono::steady_clock::now() >= limite) {
+                    return false;
+                }
+                pausa(intento);
+            }
+            std::uint32_t aviso = registrarEspera(esperas.avisosDatos, esperas.esperandoDatos);
+            bool listo = intentarDesencolar(destino);
+            if (!listo && !estaCerrada()) {
+                std::chrono::nanoseconds restante = limite - std::chrono::steady_clock::now();
+                if (restante.count() > 0) {
+                    dormir(esperas.avisosDatos, aviso, &restante);
+                }
+            }
+            esperas.esperandoDatos.fetch_sub(1, std::memory_order_relaxed);
+            if (listo) {
+                return true;
+            }
+        }
+    }
+
+    // Espera el primer elemento sin límite y luego junta hasta 'maximo', esperando como mucho
+    // 'espera' desde que llegó el primero. Devuelve 0 solo si la cola está cerrada y vacía.
+    std::size_t desencolarLote(T* destinos, std::size_t maximo, std::chrono::microseconds espera) {
+        if (maximo == 0 || !desencolar(destinos[0])) {
+            return 0;
+        }
+        std::size_t cantidad = 1;
+        std::chrono::steady_clock::time_point limite = std::chrono::steady_clock::now() + espera;
+        while (cantidad < maximo && intentarDesencolar(destinos[cantidad])) {
+            cantidad++;
+        }
+        while (cantidad < maximo && espera.count() > 0 && desencolarAntesDe(destinos[cantidad], limite)) {
+            cantidad++;
+        }
+        return cantidad;
+    }
+
+    void cerrar() {
+        esperas.cerrada.store(true, std::memory_order_seq_cst);
+        despertarTodos(esperas.avisosDatos);
+        despertarTodos(esperas.avisosEspacio);
+    }
+
+    bool estaCerrada() const { return esperas.cerrada.load(std::memory_order_acquire); }
+
+    // Aproximado mientras haya hilos operando
+    std::size_t tamano() const {
+        std::size_t inicio = cabeza.posicion.load(std::memory_order_acquire);
+        std::size_t fin = cola.posicion.load(std::memory_order_acquire);
+        return fin > inicio ? fin - inicio : 0;
+    }
+    bool vacia() const { return tamano() == 0; }
+    std::size_t obtenerCapacidad() const { return capacidad; }
+
+private:
+    static const std::size_t LINEA_CACHE = 64;
+    static const unsigned GIROS_ANTES_DE_DORMIR = 64;
+
+    // Se construyen con placement new sobre memoria alineada a mano
+    struct alignas(LINEA_CACHE) Casilla {
+        std::atomic<std::size_t> secuencia;
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type valor;
+    };
+
+    // Índice de productores o consumidores, solo en su línea de caché
+    struct Indice {
+        std::atomic<std::size_t> posicion;
+        char relleno[LINEA_CACHE - sizeof(std::atomic<std::size_t>)];
+    };
+
+    // Palabras de futex: se incrementan solo si alguien duerme, para no tocar una línea
+    // compartida en cada operación
+    struct Esperas {
+        std::atomic<bool> cerrada;
+        std::atomic<std::uint32_t> avisosDatos;
+        std::atomic<std::uint32_t> avisosEspacio;
+        std::atomic<std::uint32_t> esperandoDatos;
+        std::atomic<std::uint32_t> esperandoEspacio;
+    };
+
+    static std::size_t redondearPotenciaDos(std::size_t valor) {
+        std::size_t potencia = 2;
+        while (potencia < valor) {
+            potencia <<= 1;
+        }
+        return potencia;
+    }
+
+    static void pausa(unsigned intento) {
+        if (intento < 16) {
+#if defined(__x86_64__) || defined(__i386__)
+            __builtin_ia32_pause();
+#endif
+        } else {
+            std::this_thread::yield();
+        }
+    }
+
+    // El orden seq_cst del registro y del aviso garantiza que o el que espera ve el elemento
+    // al reintentar, o el que lo dejó ve al que espera y lo despierta
+    static std::uint32_t registrarEspera(std::atomic<std::uint32_t>& avisos, std::atomic<std::uint32_t>& esperando) {
+        esperando.fetch_add(1, std::memory_order_seq_cst);
+        return avisos.load(std::memory_order_seq_cst);
+    }
+
+    static void avisar(std::atomic<std::uint32_t>& avisos, std::atomic<std::uint32_t>& esperando) {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (esperando.load(std::memory_order_relaxed) > 0) {
+            avisos.fetch_add(1, std::memory_order_seq_cst);
+            syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&avisos), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+        }
+    }
+
+    static void despertarTodos(std::atomic<std::uint32_t>& avisos) {
+        avisos.fetch_add(1, std::memory_order_seq_cst);
+        syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&avisos), FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+    }
+
+    static void dormir(std::atomic<std::uint32_t>& avisos, std::uint32_t esperado,
+                       const std::chrono::nanoseconds* tiempoMaximo = nullptr) {
+        timespec plazo;
+        if (tiempoMaximo != nullptr) {
+            plazo.tv_sec = tiempoMaximo->count() / 1000000000;
+            plazo.tv_nsec = tiempoMaximo->count() % 1000000000;
+        }
+        syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&avisos), FUTEX_WAIT_PRIVATE, esperado,
+                tiempoMaximo != nullptr ? &plazo : nullptr, nullptr, 0);
+    }
+
+    const std::size_t capacidad;
+    const std::size_t mascara;
+    std::unique_ptr<char[]> memoria;
+    Casilla* casillas;
+    Indice cola;    // Siguiente posición a escribir
+    Indice cabeza;  // Siguiente posición a leer
+    Esperas esperas;
+};
+
+#endif // COLAMPMC_H
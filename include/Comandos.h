@@ -0,0 +1,55 @@
+#ifndef COMANDOS_H
+#define COMANDOS_H
+
+#include <string>
+#include <cstddef>
+#include "VistaTexto.h"
+
+// Tabla de comandos del chat (@usuarios, @salir...). Cada fila dice con qué prefijo empieza el
+// comando, su línea de ayuda y quién lo atiende; la tabla es constexpr, así que no se arma nada
+// al arrancar. Un comando nuevo es una fila más: el camino de cada mensaje no cambia.
+//
+// Solo los mensajes que empiezan con '@' recorren la tabla; una línea de chat común sale de
+// buscarComando sin comparar nada. Los prefijos se prueban en orden y ninguno puede ser prefijo
+// de uno posterior (si no, lo taparía).
+
+static const char MARCA_COMANDO = '@';
+
+template <typename Manejador>
+struct DefinicionComando {
+    VistaTexto prefijo;
+    VistaTexto ayuda;  // Línea de @h sin el salto final; vacía si no se lista
+    Manejador manejador;
+};
+
+// Comando con que empieza el mensaje, o nullptr si es una línea de chat.
+// 'argumentos' queda con lo que sigue al prefijo, sobre el mismo buffer.
+template <typename Manejador, std::size_t N>
+const DefinicionComando<Manejador>* buscarComando(const DefinicionComando<Manejador> (&tabla)[N], VistaTexto mensaje,
+                                                  VistaTexto& argumentos) {
+    if (mensaje.vacia() || mensaje[0] != MARCA_COMANDO) {
+        return nullptr;
+    }
+    for (std::size_t i = 0; i < N; ++i) {
+        if (mensaje.comienzaCon(tabla[i].prefijo)) {
+            argumentos = mensaje.desde(tabla[i].prefijo.longitud());
+            return &tabla[i];
+        }
+    }
+    return nullptr;
+}
+
+// Texto de @h a partir de las líneas de ayuda de la tabla; se arma una sola vez
+template <typename Manejador, std::size_t N>
+std::string construirAyuda(const DefinicionComando<Manejador> (&tabla)[N]) {
+    std::string ayuda = "Comandos disponibles:\n";
+    for (std::size_t i = 0; i < N; ++i) {
+        if (!tabla[i].ayuda.vacia()) {
+            ayuda.append(tabla[i].ayuda.datos(), tabla[i].ayuda.longitud());
+            ayuda += '\n';
+        }
+    }
+    return ayuda;
+}
+
+#endif // COMANDOS_H
@@ -0,0 +1,135 @@
+#ifndef CONEXION_H
+#define CONEXION_H
+
+#include <string>
+#include <deque>
+#include <mutex>
+#include <memory>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include "BufferMensaje.h"
+#include "Protocolo.h"
+#include "RuedaTemporizadores.h"
+
+class Reactor;
+class Canal;
+
+// Límite de bytes pendientes por conexión antes de considerar lento al cliente
+static const std::size_t MARCA_ALTA_SALIDA = 256 * 1024;
+
+// Número máximo de elementos de la cola que se envían en una sola llamada
+static const int MAX_IOVEC_SALIDA = 64;
+
+// Conexión de un cliente con su cola de salida acotada.
+// Los emisores solo agregan una referencia al mensaje compartido; el reactor dueño vacía la cola con sendmsg/iovec.
+// El socket se cierra en el destructor, cuando ya nadie guarda una referencia.
+class Conexion {
+public:
+    // Resultado de encolar datos para el cliente
+    enum class Encolado {
+        ENCOLADO,    // La cola ya tenía datos; el escritor los enviará
+        DESPERTAR,   // La cola estaba vacía o llegó al umbral de agrupado; hay que avisar al escritor
+        DESBORDADO   // Se superó la marca alta; el cliente debe expulsarse
+    };
+
+    // Contadores de la cola de salida
+    struct Contadores {
+        std::size_t bytesPendientes;
+        std::size_t profundidadMaxima;  // Mayor número de bytes pendientes observado
+        std::uint64_t mensajesEncolados;
+        std::uint64_t bytesEnviados;
+        std::uint64_t llamadasEnvio;
+    };
+
+    Conexion(int descriptor, Reactor* reactor, std::size_t marcaAlta = MARCA_ALTA_SALIDA);
+    ~Conexion();
+
+    // Con tramas el mensaje sale como una trama del tipo indicado
+    Encolado encolar(const ReferenciaMensaje& mensaje, std::uint8_t tipoTrama = TRAMA_TEXTO);
+    // Encolar bytes que ya están en su forma final (p. ej. una trama de la bitácora de mensajes);
+    // 'duenio' mantiene viva la memoria hasta que se envían. No se agrega cabecera de trama.
+    Encolado encolarRegion(const char* datos, std::size_t longitud, const std::shared_ptr<const void>& duenio);
+    // Envía lo pendiente sin bloquear; false si el socket falló. Suma en 'llamadas' los sendmsg hechos.
+    bool vaciar(std::uint64_t* llamadas = nullptr);
+    // Envío en dos pasos (io_uring): armar los iovecs de lo pendiente y, cuando el núcleo termina,
+    // descartar lo que salió. Entre ambos pasos solo el reactor dueño vacía la cola.
+    int prepararEnvio(iovec* iov, int maximo);  // 0 si no hay nada pendiente
+    bool completarEnvio(ssize_t enviados);       // false si el envío falló
+    bool expulsar();  // Corta la conexión; el lector verá el cierre y la dará de baja
+    // Copia de los bytes que faltan enviar, con sus cabeceras (reinicio en caliente, con el reactor detenido)
+    std::string copiarPendientes() const;
+
+    int obtenerDescriptor() const { return descriptor; }
+    Reactor* obtenerReactor() const { return reactor; }
+    bool estaExpulsada() const { return expulsada.load(); }
+    Contadores obtenerContadores() const;
+
+    // Agrupado de envíos: al juntar 'bytes' pendientes encolar vuelve a pedir que se despierte al
+    // escritor, para que no espere el resto de la ventana (0 = solo la ventana)
+    void establecerUmbralAgrupado(std::size_t bytes);
+    bool alcanzoUmbralAgrupado() const;
+
+    // Pasar al protocolo con tramas; llamar antes de dar de alta al usuario
+    void activarTramas() { tramas.store(true); }
+    bool usaTramas() const { return tramas.load(); }
+
+    // Estado del protocolo; solo lo toca el hilo que lee del socket. El reactor dueño lee
+    // 'identificado' y 'esPar' para los plazos, también en modo HILOS.
+    std::atomic<bool> identificado;
+    std::atomic<bool> esPar;  // Enlace entrante de otro servidor de la federación; nunca se da de alta como usuario
+    std::uint32_t nombresRechazados;  // Nombres en uso que propuso antes de identificarse
+    std::string nombreUsuario;
+    std::string restoEntrada;  // Trama incompleta de la última lectura (protocolo con tramas)
+    std::shared_ptr<Canal> canal;  // Canal actual; los mensajes de chat van solo a sus miembros
+
+    std::uint64_t ordenLlegada;  // Lo asigna el registro al dar de alta al usuario
+    // Instante del último mensaje, o de la conexión si todavía no mandó ninguno (ns de steady_clock)
+    std::atomic<std::int64_t> ultimoMensaje;
+
+    // Desde cuándo el reactor dueño difiere el envío de la cola (ns de steady_clock); 0 si no lo
+    // difiere. Solo lo toca el hilo del reactor.
+    std::int64_t inicioAgrupado;
+
+    // Plazo de saludo o de inactividad en la rueda del reactor dueño; solo lo toca su hilo
+    Temporizador plazo;
+
+private:
+    // Región de memoria ajena (historial, salida traspasada) con su dueño, en el orden de la cola
+    struct RegionSalida {
+        const char* datos;
+        std::size_t longitud;
+        std::shared_ptr<const void> duenio;
+    };
+
+    Encolado agregarElemento(const ReferenciaMensaje& mensaje, std::uint8_t tipoTrama, RegionSalida* region);
+    std::size_t longitudPrimero() const;             // Con mutexSalida tomado
+    int armarIovecs(iovec* iov, int maximo);         // Con mutexSalida tomado
+    void descartarEnviados(std::size_t enviados);   // Con mutexSalida tomado
+
+    int descriptor;
+    Reactor* reactor;  // Reactor que vacía la cola de salida
+    std::size_t marcaAlta;
+    std::size_t umbralAgrupado;  // Con mutexSalida tomado
+    std::atomic<bool> expulsada;
+    std::atomic<bool> tramas;
+
+    mutable std::mutex mutexSalida;
+    // Cola de salida. Cada elemento es el mensaje compartido en 'pendientes'; uno sin mensaje es
+    // la primera región de 'regiones' que sigue en la cola. Los encolados con tramas tienen además
+    // el tipo de su trama en 'tiposTrama' (0 = sin cabecera; la cabecera se escribe al enviar): como
+    // las tramas no se desactivan, son siempre los últimos de la cola. Así cada difusión agrega
+    // solo una referencia de 8 bytes por destinatario.
+    std::deque<ReferenciaMensaje> pendientes;
+    std::size_t desplazamiento;  // Bytes ya enviados del primer elemento
+    Contadores contadores;
+    std::deque<std::uint8_t> tiposTrama;  // Uno por cada uno de los últimos elementos de 'pendientes'
+    std::deque<RegionSalida> regiones;
+    // Cabeceras de las tramas del último armarIovecs, una por elemento (cada uno ocupa hasta dos
+    // iovecs); siguen valiendo hasta el próximo, así que alcanzan también al envío con io_uring
+    char cabeceras[MAX_IOVEC_SALIDA / 2][TAMANO_CABECERA_TRAMA];
+};
+
+#endif // CONEXION_H
@@ -0,0 +1,67 @@
+#ifndef ENRUTADORCONEXIONES_H
+#define ENRUTADORCONEXIONES_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+class AgregadorTelemetria;
+class SupervisorProcesos;
+
+// Contadores de la puerta de entrada
+struct EstadisticasEnrutador {
+    std::uint64_t redirigidas;
+    std::uint64_t sinTelemetria;  // Redirigidas a ciegas porque ningún servidor activo tenía telemetría fresca
+    std::uint64_t rechazadas;     // No había ningún servidor activo
+    std::map<int, std::uint64_t> porPuerto;
+};
+
+// Puerta de entrada del monitor: los clientes se conectan a un puerto conocido y reciben
+// "@redirigir <ip> <puerto>" hacia el servidor menos cargado, y la conexión se cierra.
+//
+// Solo son candidatos los servidores que el supervisor tiene activos y cuyo último paquete de
+// telemetría no es más viejo que 'frescura'. La carga es el número de usuarios del último
+// paquete más los clientes que ya se redirigieron a ese servidor desde ese paquete, para que
+// entre dos paquetes no vayan todos al mismo. Si ningún servidor activo tiene telemetría fresca
+// se reparte en turno rotativo entre los activos.
+class EnrutadorConexiones {
+public:
+    EnrutadorConexiones(const AgregadorTelemetria& agregador, const SupervisorProcesos& supervisor,
+                        const std::string& direccionIP, std::chrono::milliseconds frescura);
+    ~EnrutadorConexiones();
+
+    bool abrir(int puerto);
+    void atender();  // Bucle de aceptación; no retorna salvo error
+
+    EstadisticasEnrutador obtenerEstadisticas() const;  // Segura desde cualquier hilo
+    std::string obtenerResumen() const;
+
+private:
+    // Telemetría vista de un servidor y los clientes enviados desde entonces
+    struct CargaServidor {
+        std::uint64_t idInstancia;
+        std::uint64_t secuencia;
+        std::uint64_t asignados;
+    };
+
+    int elegirServidor(bool& aCiegas);  // -1 si no hay ningún servidor activo
+
+    const AgregadorTelemetria& agregador;
+    const SupervisorProcesos& supervisor;
+    std::string direccionIP;
+    std::chrono::milliseconds frescura;
+    int descriptor;
+
+    // Solo los toca el hilo que atiende
+    std::map<int, CargaServidor> cargas;
+    std::size_t siguienteRotativo;
+
+    mutable std::mutex mutexEstadisticas;
+    EstadisticasEnrutador estadisticas;
+};
+
+#endif // ENRUTADORCONEXIONES_H
@@ -0,0 +1,114 @@
+#ifndef METRICAS_H
+#define METRICAS_H
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+// Métricas del camino caliente: cada hilo escribe en su propio fragmento con operaciones
+// relajadas y sin bloqueos; los fragmentos solo se suman al recoger la telemetría.
+
+static const std::size_t FRAGMENTOS_METRICAS = 16;
+
+// Fragmento asignado al hilo actual la primera vez que registra algo
+std::size_t fragmentoDelHilo();
+
+class ContadorFragmentado {
+public:
+    ContadorFragmentado();
+    void sumar(std::uint64_t cantidad = 1) {
+        fragmentos[fragmentoDelHilo()].valor.fetch_add(cantidad, std::memory_order_relaxed);
+    }
+    std::uint64_t leer() const;
+
+private:
+    struct alignas(64) Fragmento {
+        std::atomic<std::uint64_t> valor;
+    };
+    Fragmento fragmentos[FRAGMENTOS_METRICAS];
+};
+
+// Histograma logarítmico al estilo HDR: cada potencia de dos se parte en SUBCUBETAS_HISTOGRAMA
+// cubetas iguales, así que el error relativo de un percentil es como mucho 1/8.
+static const std::size_t SUBCUBETAS_HISTOGRAMA = 8;
+static const std::size_t CUBETAS_HISTOGRAMA = 320;  // Cubre valores hasta 2^42 unidades
+
+struct InstantaneaHistograma {
+    std::uint64_t cubetas[CUBETAS_HISTOGRAMA];
+
+    InstantaneaHistograma();
+    std::uint64_t total() const;
+    std::uint64_t percentil(double fraccion) const;  // Mayor valor equivalente de la cubeta del percentil
+    void restar(const InstantaneaHistograma& anterior);  // Deja solo lo registrado desde 'anterior'
+
+    static std::size_t cubetaDe(std::uint64_t valor);
+    static std::uint64_t limiteInferior(std::size_t cubeta);
+    static std::uint64_t limiteSuperior(std::size_t cubeta);  // Exclusivo
+};
+
+class HistogramaLog {
+public:
+    HistogramaLog();
+    void registrar(std::uint64_t valor) {
+        fragmentos[fragmentoDelHilo()].cubetas[InstantaneaHistograma::cubetaDe(valor)].fetch_add(1, std::memory_order_relaxed);
+    }
+    void combinar(InstantaneaHistograma& destino) const;  // Suma de todos los fragmentos
+
+private:
+    // 2560 bytes por fragmento: los hilos solo pueden compartir la línea de caché de la frontera
+    struct Fragmento {
+        std::atomic<std::uint64_t> cubetas[CUBETAS_HISTOGRAMA];
+    };
+    std::unique_ptr<Fragmento[]> fragmentos;
+};
+
+// Registra en el histograma los nanosegundos que pasan hasta que sale de ámbito
+class MedicionTiempo {
+public:
+    MedicionTiempo(HistogramaLog& histograma, std::chrono::steady_clock::time_point inicio)
+        : histograma(histograma), inicio(inicio) {}
+    ~MedicionTiempo() {
+        histograma.registrar(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - inicio).count());
+    }
+
+private:
+    HistogramaLog& histograma;
+    std::chrono::steady_clock::time_point inicio;
+};
+
+// Muestras periódicas de un contador acumulado para calcular tasas en ventanas de hasta 5 minutos.
+// No es segura entre hilos: la usa solo el que muestrea (en el servidor, una tarea del reactor 0).
+class SerieTasa {
+public:
+    explicit SerieTasa(std::size_t capacidad = 301);
+    void muestrear(double instanteSegundos, std::uint64_t valor);
+    double tasa(double ventanaSegundos) const;  // Unidades por segundo en la ventana (o lo que haya)
+
+private:
+    struct Muestra {
+        double instante;
+        std::uint64_t valor;
+    };
+    std::vector<Muestra> muestras;
+    std::size_t siguiente;
+    std::size_t cantidad;
+};
+
+// Instantáneas acumuladas de un histograma para sacar percentiles de la última ventana
+class VentanaHistograma {
+public:
+    explicit VentanaHistograma(std::size_t capacidad);
+    void muestrear(const InstantaneaHistograma& acumulado);
+    // Lo registrado entre la instantánea más vieja guardada y 'acumulado'
+    void ventana(const InstantaneaHistograma& acumulado, InstantaneaHistograma& destino) const;
+
+private:
+    std::vector<InstantaneaHistograma> instantaneas;
+    std::size_t siguiente;
+    std::size_t cantidad;
+};
+
+#endif // METRICAS_H
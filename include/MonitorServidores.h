@@ -1,12 +1,16 @@
 #ifndef MONITORSERVIDORES_H
 #define MONITORSERVIDORES_H
 
-#include <atomic>
+class SupervisorProcesos;
+class AgregadorTelemetria;
+class EnrutadorConexiones;
+class SegmentoTelemetria;
 
-void start_server(int server_id, int port, std::atomic<bool>& server_active);
-void monitor_servers();
 void recibirUsuariosConectados();
-void recibirInformacionServidor();
+void recibirInformacionServidor(AgregadorTelemetria& agregador);
+void leerTelemetriaCompartida(AgregadorTelemetria& agregador, const SegmentoTelemetria& segmento, long intervaloMuestrasMs);
+void mostrarInformacionServidor(const SupervisorProcesos& supervisor, const AgregadorTelemetria& agregador,
+                                const EnrutadorConexiones* enrutador);
 
 
 #endif // MONITORSERVIDORES_H
@@ -0,0 +1,72 @@
+#ifndef PROTOCOLO_H
+#define PROTOCOLO_H
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+// Protocolo con tramas entre cliente y servidor.
+//
+// El modo de texto original (cada recv es un mensaje) sigue siendo el predeterminado. Un cliente
+// que quiera tramas envía PREAMBULO_TRAMAS como primeros bytes de la conexión y desde ahí, en
+// ambos sentidos, todo viaja como tramas:
+//
+//   [longitud: uint32 big-endian][tipo: uint8][carga: longitud bytes]
+//
+// La primera trama del cliente debe ser NOMBRE. Los nombres son únicos: si ya está en uso, el
+// servidor responde NOMBRE_RECHAZADO e ignora las tramas que no sean otro NOMBRE. El servidor
+// manda la solicitud de nombre en texto plano antes de saber qué protocolo usa el cliente: son
+// siempre los primeros LONGITUD_SOLICITUD_NOMBRE bytes, y el cliente con tramas los descarta.
+
+static const char PREAMBULO_TRAMAS[] = "\x01TRM";
+static const char PREAMBULO_FEDERACION[] = "\x01" "FED";  // Enlace de otro servidor (ver BusFederacion.h)
+static const std::size_t LONGITUD_PREAMBULO = 4;
+static const std::size_t LONGITUD_SOLICITUD_NOMBRE = 20;
+
+// La puerta de entrada del monitor responde una sola línea "@redirigir <ip> <puerto>\n" en
+// lugar de la solicitud de nombre y cierra; el cliente se conecta a ese servidor
+static const char PREFIJO_REDIRECCION[] = "@redirigir ";
+static const std::size_t MAX_LINEA_REDIRECCION = 64;
+
+static const std::size_t TAMANO_CABECERA_TRAMA = 5;
+static const std::uint32_t MAX_CARGA_TRAMA = 64 * 1024;
+
+// Tamaño de las lecturas con tramas: muchas tramas por cada recv
+static const std::size_t TAMANO_LECTURA_TRAMAS = 64 * 1024;
+
+enum TipoTrama : std::uint8_t {
+    TRAMA_TEXTO = 1,   // Mensaje de chat o comando (@usuarios, @salir...), igual que en modo texto
+    TRAMA_NOMBRE = 2,  // Nombre del usuario; solo como primera trama del cliente
+    TRAMA_NOMBRE_RECHAZADO = 3,  // Del servidor: el nombre está en uso; la siguiente trama del cliente es otro NOMBRE
+
+    // Enlaces de federación entre servidores
+    TRAMA_FEDERACION_HOLA = 4,    // Del emisor: [origen u64][próxima secuencia que publicará u64]
+    TRAMA_FEDERACION_ESTADO = 5,  // Del receptor: [última secuencia aplicada del origen u64]
+    TRAMA_FEDERACION_LOTE = 6     // Del emisor: [origen u64][primera secuencia u64][cantidad u32] y cada mensaje
+                                  // como [longitud del canal u8][canal][longitud u32][texto]
+};
+
+// Trama leída directamente sobre el buffer de recepción, sin copiar la carga
+struct Trama {
+    std::uint8_t tipo;
+    const char* carga;
+    std::uint32_t longitud;
+};
+
+enum class ResultadoTrama {
+    COMPLETA,    // Hay una trama entera; 'consumidos' indica cuántos bytes ocupa
+    INCOMPLETA,  // Faltan bytes: guardar el resto y esperar la siguiente lectura
+    INVALIDA     // Longitud fuera de rango: cortar la conexión
+};
+
+bool comienzaConPreambulo(const char* datos, std::size_t longitud);
+bool comienzaConPreambuloFederacion(const char* datos, std::size_t longitud);
+void escribirCabeceraTrama(char* destino, std::uint32_t longitud, std::uint8_t tipo);
+ResultadoTrama leerTrama(const char* datos, std::size_t longitud, Trama& trama, std::size_t& consumidos);
+std::string construirTrama(const std::string& carga, std::uint8_t tipo);
+
+// Enteros big-endian dentro de la carga de las tramas de federación
+void escribirEntero(char* destino, std::uint64_t valor, std::size_t bytes);
+std::uint64_t leerEntero(const char* origen, std::size_t bytes);
+
+#endif // PROTOCOLO_H
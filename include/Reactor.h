@@ -0,0 +1,185 @@
+#ifndef REACTOR_H
+#define REACTOR_H
+
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <chrono>
+#include <functional>
+#include <sys/socket.h>
+#include "BufferMensaje.h"
+#include "Protocolo.h"
+#include "Conexion.h"
+#include "AnilloUring.h"
+#include "RuedaTemporizadores.h"
+
+class ServidorChat;
+class Conexion;
+
+// Bucle de eventos epoll (edge-triggered) que atiende muchas conexiones desde un solo hilo.
+// Las demás hebras le hablan solo mediante solicitudes encoladas y un eventfd.
+// En modo REUSEPORT cada reactor tiene además su propio socket de escucha y es dueño
+// de las conexiones que acepta; las difusiones de otros reactores le llegan por su buzón.
+//
+// Con io_uring (modo URING) el mismo reactor deja epoll: acepta con un accept multishot, recibe con
+// un recv multishot por conexión sobre buffers provistos por el reactor y arma un sendmsg por cada
+// cola de salida despertada. Todo lo preparado en una ronda, incluida la difusión a todas sus
+// conexiones, sale en un solo io_uring_enter que además espera las siguientes completadas.
+//
+// Con agrupado de envíos (ServidorChat::establecerAgrupado) la cola que un emisor despierta no se
+// vacía en la ronda: espera la ventana en una lista ordenada por plazo, con un timerfd en el plazo
+// de la primera, y sale antes si junta el umbral de bytes. Lo que le llegue mientras tanto sale en
+// el mismo envío; como la cola es una sola, el orden de cada remitente se mantiene.
+//
+// Cada reactor tiene además una rueda de temporizadores con los plazos de sus conexiones (saludo
+// e inactividad, ver ServidorChat::establecerPlazos) y las tareas periódicas del servidor. El
+// mismo timerfd queda en el plazo más cercano entre la primera diferida y la rueda.
+class Reactor {
+public:
+    // soloEscritura: el reactor solo vacía colas de salida (el modo de hilos lee por su cuenta)
+    Reactor(ServidorChat& servidor, int id, bool soloEscritura = false);
+    void asignarEscucha(int descriptorEscucha);  // Llamar antes de iniciar
+    void usarUring();  // io_uring en lugar de epoll; llamar antes de iniciar
+    bool iniciar(int nucleo = -1);  // Crea la instancia epoll y lanza el hilo de E/S, fijado al núcleo si se indica
+    // Ejecutar 'accion' en el hilo del reactor ahora y después cada 'periodo'; llamar antes de iniciar
+    void agregarTarea(std::chrono::milliseconds periodo, std::function<void()> accion);
+
+    // Seguras desde cualquier hilo
+    void agregarConexion(const std::shared_ptr<Conexion>& conexion);
+    void solicitarEscritura(const std::shared_ptr<Conexion>& conexion);
+    void quitarConexion(const std::shared_ptr<Conexion>& conexion);
+    void publicarDifusion(const ReferenciaMensaje& mensaje, int descriptorRemitente);  // Buzón de difusiones
+    std::size_t obtenerNumeroConexiones() const;
+
+    // Reinicio en caliente: pausar() vuelve cuando el hilo del reactor quedó detenido. Mientras
+    // tanto, obtenerConexiones() aplica las solicitudes que llegaron después y devuelve sus conexiones.
+    void pausar();
+    void reanudar();
+    std::vector<std::shared_ptr<Conexion>> obtenerConexiones();
+    int obtenerEscucha() const { return descriptorEscucha; }
+
+    // Difundir a las conexiones de este reactor; solo desde su propio hilo
+    void difundirLocal(const ReferenciaMensaje& mensaje, int descriptorRemitente);
+
+    // Reactor que corre en el hilo actual, o nullptr si el hilo no es de un reactor
+    static Reactor* delHiloActual();
+
+private:
+    enum class TipoSolicitud { AGREGAR, ESCRIBIR, QUITAR, DIFUNDIR, PAUSAR };
+
+    struct Solicitud {
+        TipoSolicitud tipo;
+        std::shared_ptr<Conexion> conexion;
+        ReferenciaMensaje mensaje;  // Solo DIFUNDIR
+        int descriptorRemitente;
+    };
+
+    // Backend io_uring: operaciones en curso de una conexión. La conexión sigue viva mientras el
+    // núcleo tenga alguna suya, aunque el reactor ya la haya dado de baja.
+    struct OperacionesUring {
+        std::shared_ptr<Conexion> conexion;
+        bool recibiendo;           // Recepción multishot armada
+        bool cambiandoGrupo;       // Cancelada para rearmarla con los buffers de tramas
+        GrupoBuffers* grupo;       // Buffers con que se armó la recepción
+        bool enviando;             // sendmsg en vuelo: la cola no se vuelve a armar hasta su completado
+        msghdr mensaje;
+        iovec iov[MAX_IOVEC_SALIDA];
+    };
+
+    // Cola diferida por el agrupado; 'inicio' distingue la entrada vigente si la conexión ya salió
+    // por umbral y volvió a diferirse
+    struct EnvioDiferido {
+        std::shared_ptr<Conexion> conexion;
+        std::int64_t inicio;  // ns de steady_clock
+    };
+
+    bool iniciarEpoll();
+    void encolarSolicitud(Solicitud solicitud);
+    void atenderSolicitudes();
+    void bucleEventos();
+    void aceptarConexiones();
+    void registrarConexion(const std::shared_ptr<Conexion>& conexion);
+    void vaciarEscriturasLocales();
+    bool leerConexion(const std::shared_ptr<Conexion>& conexion);
+    void escribirConexion(Conexion* conexion);
+    void cerrarConexion(Conexion* conexion);
+    void despertarEscritura(const std::shared_ptr<Conexion>& conexion);
+    void programarTemporizador();
+    void atenderTemporizador();
+    void vaciarDiferidas(std::int64_t ahora);
+    std::int64_t limitePlazo(const Conexion& conexion) const;
+    void armarPlazo(Conexion* conexion);
+    void vencerPlazo(Conexion* conexion);
+
+    bool iniciarUring();
+    void bucleUring();
+    void completarUring(const io_uring_cqe& completada, bool& haySolicitudes);
+    void completarAceptacion(const io_uring_cqe& completada);
+    void completarRecepcion(OperacionesUring& operaciones, const io_uring_cqe& completada);
+    void completarEnvio(OperacionesUring& operaciones, const io_uring_cqe& completada);
+    void armarEvento();
+    void armarTemporizador();
+    void armarAceptacion();
+    void armarRecepcion(OperacionesUring& operaciones);
+    void armarEnvio(OperacionesUring& operaciones);
+    void armarPendientes();
+    void cancelarOperaciones(Conexion* conexion);
+    void detenerUring();
+    void reanudarUring();
+
+    ServidorChat& servidor;
+    int id;
+    bool soloEscritura;
+    int descriptorEpoll;
+    int descriptorEvento;  // eventfd para despertar al reactor
+    int descriptorEscucha;  // Socket de escucha propio (modo REUSEPORT) o -1
+
+    std::mutex mutexSolicitudes;
+    std::vector<Solicitud> solicitudes;
+    std::atomic<bool> despertado;  // Evita escribir en el eventfd más de una vez por ronda
+
+    std::mutex mutexPausa;
+    std::condition_variable cambioPausa;
+    bool pausaPedida;
+    bool pausado;
+
+    // Conexiones que atiende este reactor; solo las toca su hilo
+    std::unordered_map<Conexion*, std::shared_ptr<Conexion>> conexiones;
+    std::vector<std::shared_ptr<Conexion>> escriturasLocales;  // Colas que despertó el propio hilo
+    std::vector<std::shared_ptr<Conexion>> lecturasPendientes;  // Agotaron su turno de lectura con datos por leer
+    std::atomic<std::size_t> numeroConexiones;
+    char buffer[TAMANO_LECTURA_TRAMAS];  // Buffer de lectura compartido por todas las conexiones del reactor
+
+    // Agrupado de envíos; sin ventana las colas se vacían en la misma ronda
+    std::int64_t ventanaAgrupadoNs;
+    std::deque<EnvioDiferido> diferidas;  // La ventana es fija: el orden de llegada es el de los plazos
+
+    // Plazos de las conexiones y tareas periódicas; solo los toca el hilo del reactor
+    RuedaTemporizadores rueda;
+    std::deque<Temporizador> tareas;
+    std::int64_t plazoSaludoNs;        // 0 = sin plazo
+    std::int64_t plazoInactividadNs;
+    int descriptorTemporizador;  // timerfd en el plazo más cercano de las diferidas y la rueda
+    std::int64_t plazoProgramado;  // Plazo con que quedó el timerfd, o -1 si está desarmado
+    bool temporizadorVencido;
+
+    // Backend io_uring; sin anillo el reactor usa epoll. Solo los toca el hilo del reactor.
+    bool conUring;
+    std::unique_ptr<AnilloUring> anillo;
+    std::unique_ptr<GrupoBuffers> buffersTexto;   // Un mensaje por recepción, como recv de 1024 bytes
+    std::unique_ptr<GrupoBuffers> buffersTramas;  // Lecturas grandes para el protocolo con tramas
+    std::unordered_map<Conexion*, OperacionesUring> operacionesUring;
+    std::vector<std::shared_ptr<Conexion>> porArmar;  // Sin lugar en la cola de envío: se arman al final de la ronda
+    bool eventoArmado;
+    bool temporizadorArmado;
+    bool aceptacionArmada;
+    bool drenando;  // Pausado para un traspaso: no se arma nada y se espera a que terminen las operaciones
+};
+
+#endif // REACTOR_H
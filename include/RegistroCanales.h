@@ -0,0 +1,79 @@
+#ifndef REGISTROCANALES_H
+#define REGISTROCANALES_H
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <memory>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+
+class Conexion;
+
+// Canal al que entra todo usuario al identificarse; nunca se borra
+static const char CANAL_GENERAL[] = "general";
+static const std::size_t MAX_NOMBRE_CANAL = 23;
+
+// Canal de conversación con el índice de sus miembros. Difundir recorre una instantánea
+// inmutable de los miembros, así que cuesta O(miembros) y no frena las altas y bajas, que
+// copian la lista (como las particiones de RegistroUsuarios).
+class Canal {
+public:
+    typedef std::vector<std::shared_ptr<Conexion>> Miembros;
+
+    explicit Canal(const std::string& nombre) : nombre(nombre), miembros(new Miembros()), mensajes(0), entregas(0) {}
+
+    const std::string& obtenerNombre() const { return nombre; }
+    std::shared_ptr<const Miembros> obtenerMiembros() const;
+    std::size_t tamano() const;
+
+    void contarMensaje(std::uint64_t destinatarios) {
+        mensajes.fetch_add(1, std::memory_order_relaxed);
+        entregas.fetch_add(destinatarios, std::memory_order_relaxed);
+    }
+    std::uint64_t obtenerMensajes() const { return mensajes.load(std::memory_order_relaxed); }
+    std::uint64_t obtenerEntregas() const { return entregas.load(std::memory_order_relaxed); }
+
+private:
+    friend class RegistroCanales;
+
+    std::string nombre;
+    mutable std::mutex mutexMiembros;  // Solo para cambiar o copiar el puntero a la instantánea
+    std::shared_ptr<const Miembros> miembros;
+    std::atomic<std::uint64_t> mensajes;
+    std::atomic<std::uint64_t> entregas;  // Mensajes encolados a los miembros
+};
+
+// Resumen de un canal para @canales y la telemetría
+struct ResumenCanal {
+    std::string nombre;
+    std::size_t miembros;
+    std::uint64_t mensajes;
+    std::uint64_t entregas;
+};
+
+// Canales del servidor por nombre. Los canales vacíos se borran, salvo el general.
+class RegistroCanales {
+public:
+    RegistroCanales();
+
+    // Dar de alta la conexión en el canal, creándolo si hace falta
+    std::shared_ptr<Canal> unir(const std::shared_ptr<Conexion>& conexion, const std::string& nombre);
+    void dejar(const std::shared_ptr<Conexion>& conexion, const std::shared_ptr<Canal>& canal);
+    std::shared_ptr<Canal> buscar(const std::string& nombre) const;  // nullptr si no existe
+
+    // Canales ordenados por número de miembros, de mayor a menor
+    std::vector<ResumenCanal> listar() const;
+    std::size_t tamano() const;
+
+    // Nombre válido de canal: letras, dígitos, '-' o '_', sin el '#' inicial opcional
+    static bool normalizarNombre(const std::string& texto, std::string& nombre);
+
+private:
+    mutable std::mutex mutexCanales;
+    std::unordered_map<std::string, std::shared_ptr<Canal>> canales;
+};
+
+#endif // REGISTROCANALES_H
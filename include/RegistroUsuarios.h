@@ -0,0 +1,85 @@
+#ifndef REGISTROUSUARIOS_H
+#define REGISTROUSUARIOS_H
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <memory>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+
+class Conexion;
+
+// Registro de usuarios conectados, indexado por descriptor y por nombre (único).
+// Los lectores recorren instantáneas inmutables sin tomar candados (estilo RCU);
+// los escritores (altas y bajas) se serializan, copian solo la partición que cambian
+// y esperan a que terminen los lectores de la versión anterior antes de liberarla.
+class RegistroUsuarios {
+public:
+    RegistroUsuarios();
+    ~RegistroUsuarios();
+
+    bool agregar(const std::shared_ptr<Conexion>& conexion);  // false si el nombre ya está en uso
+    std::shared_ptr<Conexion> quitar(int descriptor);
+    std::shared_ptr<Conexion> buscarPorDescriptor(int descriptor) const;
+    std::shared_ptr<Conexion> buscarPorNombre(const std::string& nombre) const;
+    std::size_t tamano() const { return total.load(std::memory_order_relaxed); }
+
+    // Recorrer todas las conexiones sin candados
+    template <typename Funcion>
+    void paraCada(Funcion funcion) const {
+        Lectura lectura(*this);
+        for (std::size_t i = 0; i < NUMERO_PARTICIONES; ++i) {
+            const ParticionDescriptores* particion = descriptores[i].load(std::memory_order_acquire);
+            for (const auto& conexion : particion->conexiones) {
+                funcion(conexion);
+            }
+        }
+    }
+
+private:
+    static const std::size_t NUMERO_PARTICIONES = 64;
+    static const std::size_t NUMERO_FRANJAS = 32;  // Contadores de lectores repartidos entre hilos
+
+    struct ParticionDescriptores {
+        std::vector<std::shared_ptr<Conexion>> conexiones;
+        std::unordered_map<int, std::size_t> posiciones;  // Descriptor -> índice en conexiones
+    };
+
+    struct ParticionNombres {
+        std::unordered_map<std::string, std::shared_ptr<Conexion>> conexiones;
+    };
+
+    // Contador de lectores activos por paridad de época, en su propia línea de caché
+    struct alignas(64) FranjaLectores {
+        std::atomic<std::uint64_t> activos[2];
+    };
+
+    // Marca al hilo como lector mientras exista
+    class Lectura {
+    public:
+        explicit Lectura(const RegistroUsuarios& registro);
+        ~Lectura();
+
+    private:
+        const RegistroUsuarios& registro;
+        std::size_t franja;
+        std::uint64_t paridad;
+    };
+
+    void esperarLectores();  // Periodo de gracia: solo lo llama un escritor
+
+    std::atomic<const ParticionDescriptores*> descriptores[NUMERO_PARTICIONES];
+    std::atomic<const ParticionNombres*> nombres[NUMERO_PARTICIONES];
+
+    mutable FranjaLectores franjas[NUMERO_FRANJAS];
+    std::atomic<std::uint64_t> epoca;
+
+    std::mutex mutexEscritura;
+    std::atomic<std::size_t> total;
+    std::uint64_t siguienteOrden;  // Orden de llegada de los usuarios
+};
+
+#endif // REGISTROUSUARIOS_H
@@ -0,0 +1,88 @@
+#ifndef RUEDATEMPORIZADORES_H
+#define RUEDATEMPORIZADORES_H
+
+#include <functional>
+#include <cstddef>
+#include <cstdint>
+
+class RuedaTemporizadores;
+
+// Enlace de las listas de la rueda; cada ranura es una lista circular con su propia cabecera
+struct NodoRueda {
+    NodoRueda* anterior;
+    NodoRueda* siguiente;
+};
+
+// Temporizador que se arma en una RuedaTemporizadores. No reserva memoria al armarse ni al
+// cancelarse: el nodo va dentro de su dueño (una conexión, una instancia del supervisor...).
+// Si se destruye armado se cancela solo, así que solo debe destruirse en el hilo de su rueda.
+class Temporizador : private NodoRueda {
+public:
+    Temporizador();
+    Temporizador(const Temporizador& otro);  // Queda sin armar, con la misma acción
+    Temporizador& operator=(const Temporizador&) = delete;
+    ~Temporizador();
+
+    bool armado() const { return rueda != nullptr; }
+    std::int64_t obtenerPlazo() const { return plazo; }  // ns de steady_clock
+
+    std::function<void()> accion;  // Se llama al vencer; puede volver a armarlo
+
+private:
+    friend class RuedaTemporizadores;
+
+    std::int64_t plazo;
+    std::int64_t periodo;  // ns; 0 si no se repite
+    RuedaTemporizadores* rueda;  // Donde está armado, o nullptr
+    std::uint16_t ranura;
+};
+
+// Rueda jerárquica de temporizadores con ticks de 1 ms: una rueda de 256 ranuras para los
+// próximos 256 ms y tres de 64 para plazos cada vez más lejanos (hasta unas 18 horas; lo que
+// quede más lejos da vueltas en la última). Armar y cancelar son O(1): el temporizador se engancha
+// o se desengancha de la lista de su ranura. Al avanzar, las ranuras de las ruedas altas bajan a
+// las de abajo cuando llega su turno, y cada temporizador vence en el tick de su plazo, nunca antes.
+//
+// La usa un solo hilo, que la hace avanzar desde su bucle de eventos y programa un timerfd en
+// proximoVencimiento(). Los tiempos son ns de steady_clock (CLOCK_MONOTONIC).
+class RuedaTemporizadores {
+public:
+    RuedaTemporizadores();
+    ~RuedaTemporizadores();
+
+    RuedaTemporizadores(const RuedaTemporizadores&) = delete;
+    RuedaTemporizadores& operator=(const RuedaTemporizadores&) = delete;
+
+    // Armar (o rearmar) para que venza en 'plazo'; uno ya vencido sale en el próximo tick
+    void armar(Temporizador& temporizador, std::int64_t plazo);
+    // Vence en 'primero' y después cada 'periodo'; si la rueda se atrasa no recupera los perdidos
+    void armarPeriodico(Temporizador& temporizador, std::int64_t primero, std::int64_t periodo);
+    void cancelar(Temporizador& temporizador);
+
+    // Ejecutar los temporizadores vencidos hasta 'ahora'; devuelve cuántos venció
+    std::size_t avanzar(std::int64_t ahora);
+    // Instante en que avanzar() tiene algo que hacer (un vencimiento o una ranura que bajar), o -1
+    std::int64_t proximoVencimiento() const;
+
+    std::size_t obtenerArmados() const { return armados; }
+
+private:
+    void insertar(Temporizador& temporizador);
+    void desenganchar(Temporizador& temporizador);
+    void bajarRanura(unsigned nivel, unsigned indice);
+    std::uint64_t proximoTick() const;
+
+    static const unsigned NIVELES = 4;
+    static const unsigned BITS_NIVEL0 = 8;
+    static const unsigned BITS_NIVEL = 6;
+    static const unsigned RANURAS_NIVEL0 = 1u << BITS_NIVEL0;
+    static const unsigned RANURAS_NIVEL = 1u << BITS_NIVEL;
+    static const unsigned RANURAS = RANURAS_NIVEL0 + (NIVELES - 1) * RANURAS_NIVEL;
+
+    NodoRueda ranuras[RANURAS];
+    std::uint64_t ocupadas[RANURAS / 64];  // Un bit por ranura con algún temporizador
+    std::uint64_t actual;  // Próximo tick por procesar
+    std::size_t armados;
+};
+
+#endif // RUEDATEMPORIZADORES_H
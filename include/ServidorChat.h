@@ -6,7 +6,27 @@
 #include <chrono>
 #include <string>
 #include <map>
+#include <memory>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <pthread.h>
 #include <netinet/in.h>  // Para sockaddr_in
+#include "BufferMensaje.h"
+#include "Protocolo.h"
+#include "RegistroUsuarios.h"
+#include "RegistroCanales.h"
+#include "Telemetria.h"
+#include "Metricas.h"
+#include "BitacoraMensajes.h"
+#include "BusFederacion.h"
+#include "TraspasoServidor.h"
+#include "TelemetriaCompartida.h"
+#include "VistaTexto.h"
+#include "Comandos.h"
+
+class Reactor;
+class Conexion;
 
 // Clase Usuario que debe definirse en otro lugar
 class Usuario {
@@ -22,32 +42,169 @@ private:
     int descriptorSocket;
 };
 
+// Modelo de E/S con el que el servidor atiende a los clientes
+enum class ModoServidor {
+    HILOS,  // Un hilo bloqueante por cliente (modo original)
+    EPOLL,      // Pocos hilos de E/S con epoll edge-triggered y sockets no bloqueantes
+    REUSEPORT,  // Un reactor por núcleo con su propio socket de escucha SO_REUSEPORT
+    URING       // Como REUSEPORT, con reactores sobre io_uring en lugar de epoll
+};
+
+// Reinicio en caliente: al arrancar, el servidor pide al que ya atiende su puerto los sockets de
+// escucha y las conexiones abiertas (ver TraspasoServidor.h); si no hay ninguno arranca como
+// siempre. Luego escucha él mismo los pedidos del siguiente: para traspasar detiene el hilo que
+// acepta, los lectores y los reactores, envía el estado y termina cuando el nuevo lo confirma.
+// Si el traspaso falla, reanuda la atención como si nada.
 class ServidorChat {
 public:
-    ServidorChat(int puerto);
+    ServidorChat(int puerto, ModoServidor modo = ModoServidor::HILOS, int hilosIO = 0);
+    ~ServidorChat();
     void iniciar();
+    void establecerIntervaloTelemetria(std::chrono::milliseconds intervalo);  // Llamar antes de iniciar
+    // Guardar los mensajes en la bitácora y mandar a cada usuario que entra los últimos 'mensajes'
+    // de los últimos 'ventana' segundos (0 = sin límite de tiempo). Llamar antes de iniciar.
+    void establecerHistorial(std::size_t mensajes, std::chrono::seconds ventana);
+    // Formar un solo chat con los servidores de esos puertos (se ignora el propio). Llamar antes de iniciar.
+    void establecerFederacion(const std::vector<int>& puertos);
+    // Agrupar los envíos de cada destinatario: la cola que se despierta espera 'ventana' antes de
+    // salir, o hasta juntar 'bytes' pendientes (0 = solo la ventana). Una ventana de 0 lo desactiva.
+    // Llamar antes de iniciar.
+    void establecerAgrupado(std::chrono::microseconds ventana, std::size_t bytes);
+    // Expulsar a quien no se identifica en 'saludo' desde que se conectó y a quien pasa 'inactividad'
+    // sin mandar mensajes (0 = sin plazo). Llamar antes de iniciar.
+    void establecerPlazos(std::chrono::seconds saludo, std::chrono::seconds inactividad);
+
+    static std::string limpiarNombre(const char* datos, std::size_t longitud);
 
 private:
-    void manejarCliente(int descriptorCliente);
-    void enviarMensajeATodos(const std::string& mensaje, int descriptorRemitente);
-    void enviarListaUsuarios(int descriptorCliente);
-    void enviarDetallesConexion(int descriptorCliente);
-    std::string enviarPromedioMensajes();
-    std::string enviarTasaUso();
-    std::string enviarTiempoEntreMensajes();
-    std::string enviarTiempoActividad();
-    std::string enviarNumeroUsuarios();  // Nueva función
+    friend class Reactor;
+    friend class BancoServidor;  // Microbenchmarks de bench/bench_servidor.cpp
+
+    // Comandos del chat: reciben lo que sigue al prefijo y devuelven false si hay que cerrar
+    typedef bool (ServidorChat::*ManejadorComando)(const std::shared_ptr<Conexion>& conexion, VistaTexto argumentos);
+    static const DefinicionComando<ManejadorComando> COMANDOS[];  // En ServidorChat.cpp
+
+    // En REUSEPORT y URING cada reactor acepta y es dueño de sus conexiones
+    bool reactoresPropios() const { return modo == ModoServidor::REUSEPORT || modo == ModoServidor::URING; }
+    int crearSocketEscucha(bool noBloqueante);
+    void aceptarConHilos();
+    void aceptarConReactores();
+    void iniciarReactoresReuseport();
+    bool esperarConexionEntrante();
+    void solicitarNombre(const std::shared_ptr<Conexion>& conexion);
+    void lanzarLector(const std::shared_ptr<Conexion>& conexion);
+    void manejarCliente(std::shared_ptr<Conexion> conexion);
+    bool registrarUsuario(const std::shared_ptr<Conexion>& conexion);
+    bool rechazarNombre(const std::shared_ptr<Conexion>& conexion);
+    void enviarHistorial(const std::shared_ptr<Conexion>& conexion);
+    bool procesarEntrada(const std::shared_ptr<Conexion>& conexion, const char* datos, std::size_t longitud);
+    bool procesarTramas(const std::shared_ptr<Conexion>& conexion, const char* datos, std::size_t longitud);
+    bool procesarMensaje(const std::shared_ptr<Conexion>& conexion, VistaTexto mensaje);
+    bool procesarTramaFederacion(const std::shared_ptr<Conexion>& conexion, const Trama& trama);
+    void desconectarUsuario(const std::shared_ptr<Conexion>& conexion);
+    void enviarA(const std::shared_ptr<Conexion>& conexion, const ReferenciaMensaje& mensaje,
+                 std::uint8_t tipoTrama = TRAMA_TEXTO);
+    void enviarA(const std::shared_ptr<Conexion>& conexion, const std::string& mensaje,
+                 std::uint8_t tipoTrama = TRAMA_TEXTO);
+    void enviarMensajeATodos(const ReferenciaMensaje& mensaje, int descriptorRemitente);
+    void enviarMensajeACanal(Canal& canal, const ReferenciaMensaje& mensaje, int descriptorRemitente);
+    void cambiarCanal(const std::shared_ptr<Conexion>& conexion, const std::string& nombreCanal);
+    void enviarListaCanales(const std::shared_ptr<Conexion>& conexion);
+    void enviarPrivado(const std::shared_ptr<Conexion>& conexion, const std::string& argumentos);
+    void enviarListaUsuarios(const std::shared_ptr<Conexion>& conexion);
+    void enviarDetallesConexion(const std::shared_ptr<Conexion>& conexion);
+    bool comandoUsuarios(const std::shared_ptr<Conexion>& conexion, VistaTexto argumentos);
+    bool comandoConexion(const std::shared_ptr<Conexion>& conexion, VistaTexto argumentos);
+    bool comandoPrivado(const std::shared_ptr<Conexion>& conexion, VistaTexto argumentos);
+    bool comandoUnirse(const std::shared_ptr<Conexion>& conexion, VistaTexto argumentos);
+    bool comandoDejar(const std::shared_ptr<Conexion>& conexion, VistaTexto argumentos);
+    bool comandoCanales(const std::shared_ptr<Conexion>& conexion, VistaTexto argumentos);
+    bool comandoSalir(const std::shared_ptr<Conexion>& conexion, VistaTexto argumentos);
+    bool comandoAyuda(const std::shared_ptr<Conexion>& conexion, VistaTexto argumentos);
+    std::uint64_t leerMemoriaResidenteKB();
+    void llenarTelemetria(PaqueteTelemetria& paquete);
+    bool abrirSocketTelemetria();
+    void muestrearMetricas();
     void enviarInformacionMonitor();
+    void programarTareas(Reactor& reactor);
+
+    // Reinicio en caliente
+    void activarTraspaso();
+    void restaurarConexiones();
+    void atenderTraspasos();
+    bool traspasar(int descriptorTraspaso);
+    void detenerAtencion();
+    void reanudarAtencion();
+    void recogerEstado(EstadoTraspaso& estado);
+    void detenerAceptador();
+    void detenerLector();
 
-    std::string concatenarMensajes(const std::vector<std::string>& mensajes, const std::string& delimiter="\n");  // Nueva función
-    
     int puerto;
     int descriptorServidor;
+    ModoServidor modo;
+    int hilosIO;  // Número de reactores en modo EPOLL o REUSEPORT
+    std::vector<std::unique_ptr<Reactor>> reactores;  // En modo HILOS solo hay uno, que vacía las colas de salida
     std::chrono::steady_clock::time_point tiempoInicio;
-    int totalMensajes;
-    std::mutex mutexUsuarios;
-    std::vector<Usuario> usuarios;
-    std::map<int, std::chrono::steady_clock::time_point> tiemposUltimosMensajes;  // Declaración del mapa
+    ContadorFragmentado totalMensajes;
+    RegistroUsuarios registro;  // Usuarios conectados, por descriptor y por nombre
+    RegistroCanales canales;    // Miembros de cada canal, para difundir solo a ellos
+    ContadorFragmentado clientesExpulsados;  // Clientes lentos que superaron la marca alta
+    ContadorFragmentado lecturasTramas;  // Lecturas de clientes con tramas
+    ContadorFragmentado tramasRecibidas;  // Tramas procesadas en esas lecturas
+    HistogramaLog intervalosMensajes;  // µs entre mensajes consecutivos de un usuario
+    HistogramaLog procesamientoMensajes;  // ns en procesar cada mensaje recibido
+    ContadorFragmentado entregasSalida;   // Mensajes encolados a los clientes
+    ContadorFragmentado llamadasEnvio;    // sendmsg con que salieron (con io_uring, entradas de envío)
+
+    // Agrupado de envíos; lo aplica cada reactor (ver Reactor::despertarEscritura)
+    std::chrono::microseconds ventanaAgrupado;
+    std::size_t umbralAgrupado;
+    ContadorFragmentado vaciadosVentana;  // Colas que salieron al vencer su ventana
+    ContadorFragmentado vaciadosUmbral;   // Colas que salieron antes por llegar al umbral
+    HistogramaLog esperaAgrupado;         // µs que esperó cada cola diferida
+
+    // Plazos de las conexiones; los vigila cada reactor con su rueda (ver Reactor::vencerPlazo)
+    std::chrono::seconds plazoSaludo;
+    std::chrono::seconds plazoInactividad;
+    ContadorFragmentado vencidasSaludo;       // Conexiones expulsadas por no identificarse a tiempo
+    ContadorFragmentado vencidasInactividad;  // ... y por pasar el plazo sin mandar mensajes
+
+    // Historial para los usuarios que entran; sin bitácora si historialMensajes es 0
+    std::size_t historialMensajes;
+    std::chrono::seconds historialVentana;
+    std::unique_ptr<BitacoraMensajes> bitacora;
+
+    // Federación con otros servidores; sin bus si no hay pares
+    std::vector<int> puertosPares;
+    std::unique_ptr<BusFederacion> bus;
+
+    // Reinicio en caliente
+    EstadoTraspaso traspasoRecibido;  // Sockets recibidos del servidor anterior, hasta adoptarlos
+    int descriptorTraspasoRecibido;   // Enlace con el anterior, para confirmarle; -1 si no hubo traspaso
+    std::atomic<bool> traspasando;
+    int descriptorParada;  // eventfd que despierta al hilo que acepta para que se detenga
+    std::mutex mutexTraspaso;
+    std::condition_variable cambioTraspaso;
+    std::map<Conexion*, pthread_t> lectores;  // Hilos lectores del modo HILOS, para despertarlos con una señal
+    std::size_t lectoresDetenidos;
+    bool aceptadorDetenido;
+
+    // Telemetría hacia el monitor; la envía una tarea periódica del primer reactor
+    std::chrono::milliseconds intervaloTelemetria;
+    std::chrono::milliseconds intervaloEnvio;  // El de memoria compartida, o 0 si no hay a dónde enviar
+    int descriptorTelemetria;  // Socket UDP conectado al monitor, abierto durante toda la vida del servidor
+    SegmentoTelemetria telemetriaCompartida;  // Con un monitor en memoria compartida se publica ahí en lugar de UDP
+    int ranuraTelemetria;                     // -1 si se usa UDP
+    int descriptorStatm;       // /proc/self/statm, releído con pread en cada envío
+    std::uint64_t idInstancia;
+    std::uint64_t secuenciaTelemetria;
+
+    // Ventanas de métricas; solo las toca la tarea de muestreo
+    SerieTasa serieMensajes;
+    VentanaHistograma ventanaIntervalos;
+    VentanaHistograma ventanaProcesamiento;
+    VentanaHistograma ventanaEsperaAgrupado;
+    std::uint64_t muestrasTomadas;
 };
 
 #endif // SERVIDORCHAT_H
@@ -0,0 +1,109 @@
+#ifndef SUPERVISORPROCESOS_H
+#define SUPERVISORPROCESOS_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <chrono>
+#include <functional>
+#include <cstdint>
+#include <sys/types.h>
+#include "RuedaTemporizadores.h"
+
+// Política de reinicio de los servidores caídos
+struct ConfiguracionReinicio {
+    std::chrono::milliseconds retrasoInicial;  // Espera tras la segunda caída seguida
+    std::chrono::milliseconds retrasoMaximo;   // Tope de la espera exponencial
+    double factor;                             // Multiplicador de la espera en cada caída seguida
+    std::chrono::milliseconds tiempoEstable;   // Un servidor que duró esto se reinicia sin esperar
+
+    ConfiguracionReinicio();
+};
+
+// Estadísticas de recuperación de todos los servidores supervisados
+struct EstadisticasSupervisor {
+    std::size_t instancias;
+    std::size_t activas;
+    std::uint64_t reinicios;
+    std::uint64_t reiniciosEnCaliente;  // Servidores reemplazados con traspaso de sus conexiones (SIGHUP)
+    std::uint64_t recuperacionesMedidas;
+    double latenciaUltimaMs;  // Desde que se detecta la caída hasta que el puerto vuelve a aceptar
+    double latenciaMediaMs;
+    double latenciaMaximaMs;
+};
+
+// Supervisor de procesos: lanza los servidores con posix_spawn y se entera de cada salida al
+// instante con un pidfd por hijo, todo desde un único hilo con epoll. Los reinicios, las
+// sondas de disponibilidad y las tareas periódicas van en una rueda de temporizadores, con un
+// timerfd en su próximo vencimiento.
+//
+// Con SIGHUP se reinicia en caliente cada servidor activo: se lanza uno nuevo en el mismo puerto,
+// que recibe del anterior sus sockets y sus usuarios (ver TraspasoServidor.h), y el anterior
+// termina solo. Su salida no cuenta como caída. El proceso debe bloquear SIGHUP en todos sus
+// hilos antes de crearlos; el supervisor la recibe por un signalfd.
+class SupervisorProcesos {
+public:
+    // direccionIP: dirección donde escuchan los servidores, para comprobar que volvieron a aceptar
+    SupervisorProcesos(const std::string& ejecutable, const std::string& direccionIP, const ConfiguracionReinicio& configuracion);
+    ~SupervisorProcesos();
+
+    // Registrar un servidor antes de llamar a ejecutar()
+    void agregarServidor(int puerto, const std::vector<std::string>& argumentos);
+    // Ejecutar 'accion' en el hilo del supervisor cada 'periodo'; llamar antes de ejecutar()
+    void agregarTarea(std::chrono::milliseconds periodo, std::function<void()> accion);
+    void ejecutar();  // Bucle de eventos; no retorna salvo error
+
+    EstadisticasSupervisor obtenerEstadisticas() const;  // Segura desde cualquier hilo
+    std::string obtenerResumen() const;
+    std::vector<int> obtenerPuertosActivos() const;  // Servidores que ya aceptan conexiones
+
+private:
+    enum class Estado { ESPERANDO, ARRANCANDO, ACTIVO };
+    typedef std::chrono::steady_clock Reloj;
+
+    struct Instancia {
+        int id;
+        int puerto;
+        std::vector<std::string> argumentos;
+        pid_t pid;
+        int descriptorPid;  // pidfd del hijo, registrado en epoll
+        pid_t pidAnterior;  // Proceso que traspasa sus conexiones al actual, hasta que termina; o -1
+        int descriptorPidAnterior;
+        Estado estado;
+        Temporizador temporizador;  // Reinicio pendiente (ESPERANDO) o próxima sonda (ARRANCANDO)
+        int caidasSeguidas;
+        Reloj::time_point lanzamiento;
+        Reloj::time_point caida;  // Momento en que se detectó la última salida
+        bool midiendoRecuperacion;
+    };
+
+    bool lanzar(Instancia& instancia);
+    void atenderSalida(Instancia& instancia);
+    void atenderSalidaAnterior(Instancia& instancia);
+    void reiniciarEnCaliente();
+    void programarReinicio(Instancia& instancia);
+    void sondear(Instancia& instancia);
+    void programar(Instancia& instancia, Reloj::time_point cuando);
+    void vencerTemporizador(Instancia& instancia);
+    void atenderTemporizador();
+    void rearmarTemporizador();
+    void cambiarEstado(Instancia& instancia, Estado estado);
+    void registrarRecuperacion(double latenciaMs);
+
+    std::string ejecutable;
+    std::string direccionIP;
+    ConfiguracionReinicio configuracion;
+    int descriptorEpoll;
+    int descriptorTemporizador;
+    int descriptorSenales;  // signalfd de SIGHUP
+    RuedaTemporizadores rueda;  // Antes que sus temporizadores, que se cancelan al destruirse
+    std::vector<Instancia> instancias;
+    std::deque<Temporizador> tareas;
+
+    mutable std::mutex mutexEstadisticas;
+    EstadisticasSupervisor estadisticas;
+    double latenciaTotalMs;
+};
+
+#endif // SUPERVISORPROCESOS_H
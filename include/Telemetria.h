@@ -0,0 +1,130 @@
+#ifndef TELEMETRIA_H
+#define TELEMETRIA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Paquete binario de telemetría que cada servidor envía al monitor por UDP.
+// El formato es fijo y versionado: todos los campos son enteros del tamaño indicado en el
+// orden de bytes del host (servidor y monitor corren en la misma máquina). Para agregar
+// campos se sube VERSION_TELEMETRIA y se añaden al final; el monitor descarta versiones que
+// no conoce. El texto legible lo genera el monitor.
+
+static const std::uint32_t MAGIA_TELEMETRIA = 0x4D4C4554;  // "TELM"
+static const std::uint16_t VERSION_TELEMETRIA = 6;
+static const std::uint16_t PUERTO_TELEMETRIA = 55555;
+
+static const std::size_t CUBETAS_TELEMETRIA = 32;  // Cubeta i: intervalos en [2^i, 2^(i+1)) µs
+static const std::size_t MAX_REACTORES_TELEMETRIA = 16;
+static const std::size_t VENTANAS_TELEMETRIA = 3;     // 1 s, 1 min y 5 min
+static const std::size_t PERCENTILES_TELEMETRIA = 3;  // p50, p99 y p999
+static const std::size_t MAX_CANALES_TELEMETRIA = 8;  // Solo los canales con más miembros
+static const std::size_t LONGITUD_NOMBRE_CANAL_TELEMETRIA = 24;
+
+enum ModoTelemetria : std::uint8_t {
+    MODO_TELEMETRIA_HILOS = 0,
+    MODO_TELEMETRIA_EPOLL = 1,
+    MODO_TELEMETRIA_REUSEPORT = 2,
+    MODO_TELEMETRIA_URING = 3
+};
+
+// Contadores de un canal; el nombre termina en '\0'
+struct CanalTelemetria {
+    char nombre[LONGITUD_NOMBRE_CANAL_TELEMETRIA];
+    std::uint32_t miembros;
+    std::uint32_t reservado;
+    std::uint64_t mensajes;   // Mensajes de chat enviados al canal desde que existe
+    std::uint64_t entregas;   // Copias encoladas a sus miembros
+};
+
+struct PaqueteTelemetria {
+    // Cabecera
+    std::uint32_t magia;
+    std::uint16_t version;
+    std::uint16_t longitud;        // sizeof(PaqueteTelemetria) del emisor
+    std::uint64_t idInstancia;     // Aleatorio por arranque: un reinicio del servidor cambia el id
+    std::uint64_t secuencia;       // Número de paquete; los huecos son paquetes perdidos
+    std::uint32_t pid;
+    std::uint16_t puerto;
+    std::uint8_t modo;             // ModoTelemetria
+    std::uint8_t hilosIO;
+    std::uint64_t tiempoActividadNs;
+
+    // Contadores acumulados desde el arranque
+    std::uint64_t totalMensajes;
+    std::uint64_t clientesExpulsados;
+    std::uint64_t lecturasTramas;
+    std::uint64_t tramasRecibidas;
+
+    // Medidas instantáneas
+    std::uint32_t usuariosConectados;
+    std::uint32_t numeroReactores;
+    std::uint64_t memoriaResidenteKB;
+    std::uint64_t bytesPendientes;       // Suma de las colas de salida
+    std::uint64_t profundidadMaxima;     // Mayor cola de salida observada, en bytes
+    std::uint64_t tiempoSinMensajesUs;   // Promedio del tiempo desde el último mensaje de cada usuario
+    std::uint32_t conexionesReactor[MAX_REACTORES_TELEMETRIA];
+
+    // Histograma acumulado de intervalos entre mensajes consecutivos de un mismo usuario
+    std::uint64_t cubetasIntervalo[CUBETAS_TELEMETRIA];
+
+    // Versión 2: tasas por ventana y percentiles (p50, p99, p999) del último minuto
+    std::uint64_t tasaMensajesMilis[VENTANAS_TELEMETRIA];  // Mensajes por segundo ×1000 en 1 s, 1 min y 5 min
+    std::uint64_t percentilesIntervaloUs[PERCENTILES_TELEMETRIA];
+    std::uint64_t percentilesProcesamientoNs[PERCENTILES_TELEMETRIA];  // Tiempo de procesar un mensaje recibido
+
+    // Versión 3: canales
+    std::uint32_t numeroCanales;         // Todos los canales, aunque solo se envíen los más grandes
+    std::uint32_t canalesEnviados;
+    CanalTelemetria canales[MAX_CANALES_TELEMETRIA];
+
+    // Versión 4: federación (todo en cero si el servidor no tiene pares)
+    std::uint32_t paresFederacion;
+    std::uint32_t paresConectados;
+    std::uint64_t federacionPublicados;  // Mensajes locales puestos en el bus
+    std::uint64_t federacionLotes;       // Lotes enviados a los pares
+    std::uint64_t federacionEnviados;    // Mensajes enviados, sumando todos los pares
+    std::uint64_t federacionAplicados;   // Mensajes de otros servidores entregados aquí
+    std::uint64_t federacionDuplicados;
+    std::uint64_t federacionHuecos;
+
+    // Versión 5: colas de salida y agrupado de envíos por destinatario
+    std::uint64_t entregasSalida;        // Mensajes encolados a los clientes
+    std::uint64_t llamadasEnvio;         // sendmsg con que salieron; entregas / llamadas = mensajes por envío
+    std::uint32_t ventanaAgrupadoUs;     // 0 = sin agrupado
+    std::uint32_t umbralAgrupadoBytes;
+    std::uint64_t vaciadosVentana;       // Colas diferidas que salieron al vencer la ventana
+    std::uint64_t vaciadosUmbral;        // ... o antes, al llegar al umbral de bytes
+    std::uint64_t percentilesEsperaAgrupadoUs[PERCENTILES_TELEMETRIA];  // Latencia añadida, último minuto
+
+    // Versión 6: plazos de las conexiones
+    std::uint32_t plazoSaludoS;          // 0 = sin plazo
+    std::uint32_t plazoInactividadS;
+    std::uint64_t vencidasSaludo;        // Conexiones expulsadas por no elegir nombre a tiempo
+    std::uint64_t vencidasInactividad;   // ... y por pasar el plazo sin mandar mensajes
+};
+
+static_assert(sizeof(PaqueteTelemetria) == 1040, "El formato del paquete de telemetría cambió: subir VERSION_TELEMETRIA");
+
+// Cubeta del histograma para un intervalo en microsegundos
+inline std::size_t cubetaTelemetria(std::uint64_t microsegundos) {
+    std::size_t cubeta = 0;
+    while (microsegundos > 1 && cubeta + 1 < CUBETAS_TELEMETRIA) {
+        microsegundos >>= 1;
+        cubeta++;
+    }
+    return cubeta;
+}
+
+// Comprobar que un datagrama es un paquete de una versión conocida y copiarlo
+inline bool leerPaqueteTelemetria(const char* datos, std::size_t longitud, PaqueteTelemetria& paquete) {
+    if (longitud < sizeof(PaqueteTelemetria)) {
+        return false;
+    }
+    std::memcpy(&paquete, datos, sizeof(paquete));
+    return paquete.magia == MAGIA_TELEMETRIA && paquete.version == VERSION_TELEMETRIA &&
+           paquete.longitud == sizeof(PaqueteTelemetria);
+}
+
+#endif // TELEMETRIA_H
@@ -0,0 +1,66 @@
+#ifndef TELEMETRIACOMPARTIDA_H
+#define TELEMETRIACOMPARTIDA_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "Telemetria.h"
+
+// Telemetría por memoria compartida entre los servidores y el monitor de la misma máquina.
+//
+// El monitor crea el segmento con nombre NOMBRE_SEGMENTO_TELEMETRIA antes de lanzar los
+// servidores. Cada servidor que lo encuentra al arrancar toma una ranura (marcándola con su pid
+// mediante compare_exchange; la de un proceso que ya no existe se puede volver a tomar) y publica
+// ahí su PaqueteTelemetria en lugar de enviarlo por UDP. Si no hay segmento, sigue con UDP.
+//
+// Cada ranura es un seqlock con un solo escritor: la versión queda impar mientras se copia el
+// paquete, palabra por palabra con atómicos relajados, y par al terminar. El lector copia el
+// paquete entre dos lecturas de la versión y reintenta si cambió. Leer no hace llamadas al
+// sistema ni toma candados, y escribir nunca espera al lector.
+
+static const char NOMBRE_SEGMENTO_TELEMETRIA[] = "/chat_telemetria";
+static const std::uint32_t MAGIA_SEGMENTO_TELEMETRIA = 0x4D485354;  // "TSHM"
+static const std::size_t MAX_RANURAS_TELEMETRIA = 256;
+
+static_assert(sizeof(PaqueteTelemetria) % sizeof(std::uint64_t) == 0, "El paquete se copia por palabras de 64 bits");
+static const std::size_t PALABRAS_PAQUETE_TELEMETRIA = sizeof(PaqueteTelemetria) / sizeof(std::uint64_t);
+
+// Una ranura por servidor, en su propia línea de caché
+struct alignas(64) RanuraTelemetria {
+    std::atomic<std::uint32_t> pid;      // Dueño de la ranura; 0 = libre
+    std::atomic<std::uint64_t> version;  // Seqlock: impar mientras se escribe, 0 = nunca escrita
+    std::atomic<std::uint64_t> palabras[PALABRAS_PAQUETE_TELEMETRIA];
+};
+
+struct alignas(64) SegmentoCompartido {
+    std::uint32_t magia;
+    std::uint16_t version;    // VERSION_TELEMETRIA: el formato del paquete
+    std::uint16_t reservado;
+    std::uint32_t ranuras;
+    std::uint32_t tamanoRanura;
+    RanuraTelemetria ranura[MAX_RANURAS_TELEMETRIA];
+};
+
+class SegmentoTelemetria {
+public:
+    SegmentoTelemetria();
+    ~SegmentoTelemetria();
+
+    bool crear();    // Monitor: reemplaza el segmento de un monitor anterior
+    bool abrir();    // Servidor: false si no hay monitor con memoria compartida
+    static void eliminar();  // Monitor sin memoria compartida: los servidores nuevos vuelven a UDP
+
+    // Servidor
+    int reservarRanura();  // -1 si están todas ocupadas por procesos vivos
+    void liberarRanura(int ranura);
+    void publicar(int ranura, const PaqueteTelemetria& paquete);
+
+    // Monitor; 'reintentos' suma las veces que hubo que releer porque el servidor estaba escribiendo
+    bool leer(std::size_t ranura, PaqueteTelemetria& paquete, std::uint64_t& reintentos) const;
+    std::size_t numeroRanuras() const { return MAX_RANURAS_TELEMETRIA; }
+
+private:
+    SegmentoCompartido* segmento;
+};
+
+#endif // TELEMETRIACOMPARTIDA_H
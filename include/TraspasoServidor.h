@@ -0,0 +1,55 @@
+#ifndef TRASPASOSERVIDOR_H
+#define TRASPASOSERVIDOR_H
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+// Reinicio en caliente: un servidor nuevo en el mismo puerto recibe del anterior los sockets de
+// escucha, las conexiones abiertas y el estado de cada usuario, y el anterior termina sin que
+// los clientes vean un corte.
+//
+// Cada servidor escucha en un socket Unix abstracto por puerto (SOCK_SEQPACKET). El nuevo se
+// conecta al arrancar; si nadie responde, arranca como siempre. El intercambio es:
+//
+//   nuevo -> anterior: un byte para pedir el traspaso
+//   anterior -> nuevo: cabecera [magia u32][versión u32][escuchas u32][conexiones u32][bytes del estado u64]
+//                      grupos de descriptores con SCM_RIGHTS: primero los de escucha y luego uno por conexión
+//                      el estado serializado, en trozos
+//   nuevo -> anterior: un byte de confirmación; el anterior ya puede terminar
+//
+// Los descriptores siguen siendo los mismos sockets abiertos: lo que los clientes enviaron mientras
+// tanto espera en el núcleo y lo lee el proceso nuevo.
+
+// Estado de una conexión que pasa al servidor nuevo
+struct ConexionTraspasada {
+    int descriptor;
+    bool tramas;
+    bool identificado;
+    std::int64_t ultimoMensaje;  // ns de steady_clock (CLOCK_MONOTONIC, el mismo para ambos procesos)
+    std::string nombreUsuario;
+    std::string canal;
+    std::string restoEntrada;     // Trama incompleta sin procesar
+    std::string salidaPendiente;  // Bytes de la cola de salida que aún no se enviaron
+};
+
+struct EstadoTraspaso {
+    std::vector<int> escuchas;
+    std::vector<ConexionTraspasada> conexiones;
+};
+
+// Servidor anterior: escuchar pedidos de traspaso; -1 si el nombre sigue tomado por otro proceso
+int abrirEscuchaTraspaso(int puerto);
+// Esperar un pedido; solo se aceptan procesos del mismo usuario. -1 si el que se conectó no vale.
+int aceptarSolicitudTraspaso(int descriptorEscucha);
+// Servidor nuevo: pedir el traspaso al anterior; -1 si no hay ninguno
+int solicitarTraspaso(int puerto);
+
+bool enviarTraspaso(int descriptor, const EstadoTraspaso& estado);
+bool recibirTraspaso(int descriptor, EstadoTraspaso& estado);  // Los descriptores llegan con O_CLOEXEC
+
+bool confirmarTraspaso(int descriptor);
+bool esperarConfirmacionTraspaso(int descriptor, int milisegundos);
+
+#endif // TRASPASOSERVIDOR_H
@@ -0,0 +1,39 @@
+#ifndef VISTATEXTO_H
+#define VISTATEXTO_H
+
+#include <string>
+#include <cstddef>
+#include <cstring>
+
+// Vista de solo lectura sobre texto ajeno, como std::string_view (el proyecto sigue en C++11).
+// No copia ni reserva memoria: sirve para recorrer lo recibido directamente sobre el buffer de
+// recepción. El texto tiene que seguir vivo mientras se use la vista.
+class VistaTexto {
+public:
+    constexpr VistaTexto() : inicio(nullptr), tamano(0) {}
+    constexpr VistaTexto(const char* datos, std::size_t longitud) : inicio(datos), tamano(longitud) {}
+    // Solo para literales: el '\0' final no cuenta
+    template <std::size_t N>
+    constexpr VistaTexto(const char (&literal)[N]) : inicio(literal), tamano(N - 1) {}
+    VistaTexto(const std::string& texto) : inicio(texto.data()), tamano(texto.size()) {}
+
+    constexpr const char* datos() const { return inicio; }
+    constexpr std::size_t longitud() const { return tamano; }
+    constexpr bool vacia() const { return tamano == 0; }
+    constexpr char operator[](std::size_t posicion) const { return inicio[posicion]; }
+
+    bool comienzaCon(VistaTexto prefijo) const {
+        return tamano >= prefijo.tamano && std::memcmp(inicio, prefijo.inicio, prefijo.tamano) == 0;
+    }
+    // Lo que sigue a 'posicion' (vacía si se pasa del final)
+    VistaTexto desde(std::size_t posicion) const {
+        return posicion < tamano ? VistaTexto(inicio + posicion, tamano - posicion) : VistaTexto();
+    }
+    std::string copiar() const { return std::string(inicio, tamano); }
+
+private:
+    const char* inicio;
+    std::size_t tamano;
+};
+
+#endif // VISTATEXTO_H
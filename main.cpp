@@ -1,58 +1,119 @@
 #include <iostream>
 #include <thread>
 #include <vector>
-#include <queue>
-#include <semaphore.h>
+#include <atomic>
+#include <algorithm>
+#include <memory>
 #include <mutex>
 #include <chrono>
-#include <condition_variable>
+#include <cstdint>
 #include "ClienteChat.h"
 #include "ServidorChat.h"
+#include "ColaMPMC.h"
 
-// Semáforos para sincronizar acceso a la cola
-sem_t emptySlots;  // Semáforo para contar los espacios vacíos en la cola
-sem_t filledSlots;  // Semáforo para contar los espacios llenos en la cola
+// Capacidad de la cola compartida entre productores y consumidores
+static const std::size_t CAPACIDAD_COLA = 16;
 
-// Mutex para proteger el acceso a la cola
-std::mutex queueMutex;
+// Capacidad de la cola entre la entrada estándar y el hilo que envía por lotes
+static const std::size_t CAPACIDAD_ENTRADA = 4096;
 
-// Cola compartida
-std::queue<std::string> messageQueue;
+// Mensajes recientes que se guardan para mostrar en el estado
+static const std::size_t MENSAJES_RECIENTES = 8;
 
-// Almacenar mensajes para el monitor
-std::vector<std::string> producedMessages;
-std::vector<std::string> consumedMessages;
+// Estadísticas acotadas del proceso: contadores y los últimos mensajes en un anillo fijo
+struct EstadisticasProceso {
+    std::atomic<std::uint64_t> producidos{0};
+    std::atomic<std::uint64_t> consumidos{0};
+    std::atomic<std::uint64_t> esperaMaximaUs{0};  // Mayor tiempo de un mensaje en la cola
 
-// Variable de condición y mutex para controlar el estado
-std::condition_variable cv;
-std::mutex cv_m;
-bool showStatus = false;
-bool stopThreads = false;
+    std::mutex mutexRecientes;
+    std::string recientes[MENSAJES_RECIENTES];
+    std::size_t siguienteReciente = 0;
+
+    void registrarConsumido(const std::string& mensaje, std::uint64_t esperaUs) {
+        consumidos.fetch_add(1, std::memory_order_relaxed);
+        std::uint64_t maximo = esperaMaximaUs.load(std::memory_order_relaxed);
+        while (esperaUs > maximo && !esperaMaximaUs.compare_exchange_weak(maximo, esperaUs, std::memory_order_relaxed)) {
+        }
+        std::lock_guard<std::mutex> lock(mutexRecientes);
+        recientes[siguienteReciente % MENSAJES_RECIENTES] = mensaje;
+        siguienteReciente++;
+    }
+};
+
+// Elemento de la cola: se mueve del productor al consumidor sin copiar el texto
+struct ElementoCola {
+    std::string mensaje;
+    std::chrono::steady_clock::time_point encolado;
+};
+
+EstadisticasProceso estadisticas;
+
+// Consumo por lotes: con más de un mensaje por lote, los consumidores juntan hasta
+// mensajesPorLote mensajes (esperando como mucho esperaLote) y los envían con una sola llamada
+std::size_t mensajesPorLote = 1;
+std::chrono::microseconds esperaLote(0);
+
+// Variables para controlar el estado
+std::atomic<bool> showStatus(false);
+std::atomic<bool> stopThreads(false);
 
 /**
  * @brief Función para producir mensajes y agregarlos a la cola.
  * 
  * @param id Identificador del productor.
+ * @param cola Cola compartida con los consumidores.
  */
-void producer(int id) {
+void producer(int id, ColaMPMC<ElementoCola>& cola) {
     int messageCount = 0;
-    while (!stopThreads) {
-        std::string message = "Mensaje del productor " + std::to_string(id) + " - " + std::to_string(messageCount++);
+    while (true) {
+        ElementoCola elemento;
+        elemento.mensaje = "Mensaje del productor " + std::to_string(id) + " - " + std::to_string(messageCount++);
+        elemento.encolado = std::chrono::steady_clock::now();
+
+        // Espera hasta que haya espacio en la cola; falla cuando la cola se cierra
+        if (!cola.encolar(std::move(elemento))) {
+            return;
+        }
+        estadisticas.producidos.fetch_add(1, std::memory_order_relaxed);
 
-        // Espera hasta que haya espacio en la cola
-        sem_wait(&emptySlots);
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));  // Simula tiempo de producción
+    }
+}
 
-        // Bloquea el mutex para agregar el mensaje a la cola
-        {
-            std::lock_guard<std::mutex> lock(queueMutex);
-            messageQueue.push(message);
-            producedMessages.push_back(message);  // Almacena el mensaje producido
+/**
+ * @brief Saca un lote de la cola y lo envía al servidor con una sola llamada.
+ * 
+ * @param cola Cola compartida con los productores.
+ * @param elementos Espacio para mensajesPorLote elementos, reutilizado entre lotes.
+ * @param textos Textos del lote, movidos desde los elementos.
+ * @param cliente Referencia al objeto ClienteChat que envía el lote.
+ * @param registrar Si se anotan los mensajes en las estadísticas del proceso.
+ * @return Mensajes enviados; 0 cuando la cola se cerró y quedó vacía.
+ */
+std::size_t consumirLote(ColaMPMC<ElementoCola>& cola, std::vector<ElementoCola>& elementos,
+                         std::vector<std::string>& textos, ClienteChat& cliente, bool registrar) {
+    std::size_t cantidad = cola.desencolarLote(elementos.data(), elementos.size(), esperaLote);
+    auto ahora = std::chrono::steady_clock::now();
+    textos.clear();
+    for (std::size_t i = 0; i < cantidad; ++i) {
+        if (registrar) {
+            std::uint64_t esperaUs = std::chrono::duration_cast<std::chrono::microseconds>(ahora - elementos[i].encolado).count();
+            estadisticas.registrarConsumido(elementos[i].mensaje, esperaUs);
         }
+        textos.push_back(std::move(elementos[i].mensaje));
+    }
+    cliente.manejarComandos(textos);
+    return cantidad;
+}
 
-        // Señala que hay un mensaje disponible en la cola
-        sem_post(&filledSlots);
-
-        std::this_thread::sleep_for(std::chrono::milliseconds(500));  // Simula tiempo de producción
+/**
+ * @brief Hilo que envía por lotes las líneas leídas de la entrada estándar.
+ */
+void enviarPorLotes(ColaMPMC<ElementoCola>& cola, ClienteChat& cliente) {
+    std::vector<ElementoCola> elementos(mensajesPorLote);
+    std::vector<std::string> textos;
+    while (consumirLote(cola, elementos, textos, cliente, false) > 0) {
     }
 }
 
@@ -60,28 +121,29 @@ void producer(int id) {
  * @brief Función para consumir mensajes de la cola.
  * 
  * @param id Identificador del consumidor.
+ * @param cola Cola compartida con los productores.
  * @param cliente Referencia al objeto ClienteChat para manejar el comando.
  */
-void consumer(int id, ClienteChat& cliente) {
-    while (!stopThreads) {
-        // Espera hasta que haya un mensaje en la cola
-        sem_wait(&filledSlots);
-
-        // Bloquea el mutex para sacar el mensaje de la cola
-        {
-            std::lock_guard<std::mutex> lock(queueMutex);
-            if (!messageQueue.empty()) {
-                std::string message = messageQueue.front();
-                messageQueue.pop();
-                consumedMessages.push_back(message);  // Almacena el mensaje consumido
-
-                // Envía el mensaje al servidor
-                cliente.manejarComando(message);
-            }
+void consumer(int id, ColaMPMC<ElementoCola>& cola, ClienteChat& cliente) {
+    (void)id;
+    if (mensajesPorLote > 1) {
+        std::vector<ElementoCola> elementos(mensajesPorLote);
+        std::vector<std::string> textos;
+        while (!stopThreads && consumirLote(cola, elementos, textos, cliente, true) > 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1000));  // Simula tiempo de consumo
         }
+        return;
+    }
+
+    ElementoCola elemento;
+    // Espera hasta que haya un mensaje en la cola; termina al cerrarse la cola
+    while (!stopThreads && cola.desencolar(elemento)) {
+        std::uint64_t esperaUs = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - elemento.encolado).count();
+        estadisticas.registrarConsumido(elemento.mensaje, esperaUs);
 
-        // Señala que hay espacio disponible en la cola
-        sem_post(&emptySlots);
+        // Envía el mensaje al servidor
+        cliente.manejarComando(elemento.mensaje);
 
         std::this_thread::sleep_for(std::chrono::milliseconds(1000));  // Simula tiempo de consumo
     }
@@ -93,6 +155,7 @@ void consumer(int id, ClienteChat& cliente) {
 void mostrarEstado(ClienteChat& cliente) {
     showStatus = true;
     stopThreads = false;
+    ColaMPMC<ElementoCola> cola(CAPACIDAD_COLA);
 
     // Crear y lanzar hilos de productores y consumidores para la demostración
     std::vector<std::thread> producerThreads;
@@ -100,36 +163,34 @@ void mostrarEstado(ClienteChat& cliente) {
 
     // Crea y lanza los hilos de productores
     for (int i = 0; i < 3; ++i) {
-        producerThreads.emplace_back(producer, i);
+        producerThreads.emplace_back(producer, i, std::ref(cola));
     }
 
     // Crea y lanza los hilos de consumidores
     for (int i = 0; i < 2; ++i) {
-        consumerThreads.emplace_back(consumer, i, std::ref(cliente));
+        consumerThreads.emplace_back(consumer, i, std::ref(cola), std::ref(cliente));
     }
 
     std::this_thread::sleep_for(std::chrono::seconds(4));
 
     {
-        std::lock_guard<std::mutex> lock(queueMutex);
+        std::lock_guard<std::mutex> lock(estadisticas.mutexRecientes);
         std::cout << "\n--- Estado de Producción y Consumo ---\n";
-        std::cout << "Producidos: \n";
-        for (const auto& msg : producedMessages) {
-            std::cout << msg << "\n";
-        }
-        std::cout << "Consumidos: \n";
-        for (const auto& msg : consumedMessages) {
-            std::cout << msg << "\n";
+        std::cout << "Producidos: " << estadisticas.producidos.load() << "\n";
+        std::cout << "Consumidos: " << estadisticas.consumidos.load() << "\n";
+        std::cout << "En cola: " << cola.tamano() << " de " << cola.obtenerCapacidad() << "\n";
+        std::cout << "Espera máxima en la cola: " << estadisticas.esperaMaximaUs.load() / 1000.0 << " ms\n";
+        std::cout << "Últimos consumidos: \n";
+        std::size_t cantidad = std::min(estadisticas.siguienteReciente, MENSAJES_RECIENTES);
+        for (std::size_t i = estadisticas.siguienteReciente - cantidad; i < estadisticas.siguienteReciente; ++i) {
+            std::cout << estadisticas.recientes[i % MENSAJES_RECIENTES] << "\n";
         }
         std::cout << "--- Fin del Estado ---\n\n";
     }
 
-    for (int i = 0; i < 10; ++i) {  // Intentar liberar los semáforos varias veces
-        sem_post(&filledSlots);
-        sem_post(&emptySlots);
-    }
-
+    // Despierta a los hilos bloqueados; lo que quede en la cola se descarta al destruirla
     stopThreads = true;
+    cola.cerrar();
 
     // Terminar hilos de productores y consumidores
     for (auto& thread : producerThreads) {
@@ -158,40 +219,130 @@ int main(int argc, char* argv[]) {
 
     if (modo == "servidor") {
         if (argc < 3) {
-            std::cerr << "Uso: " << argv[0] << " servidor <puerto>\n";
+            std::cerr << "Uso: " << argv[0] << " servidor <puerto> [hilos|epoll|reuseport|uring] [hilosIO] [intervaloTelemetriaMs] [historialMensajes] [historialSegundos] [puertosPares] [agrupadoUs] [agrupadoBytes] [plazoSaludoS] [plazoInactividadS]\n";
             return 1;
         }
         int puerto = std::stoi(argv[2]);
-        ServidorChat servidor(puerto);  // Inicializa el servidor con el puerto proporcionado
+
+        // Modelo de E/S opcional: un hilo por cliente (por defecto), reactores epoll o un reactor por núcleo,
+        // sobre epoll (reuseport) o io_uring (uring)
+        ModoServidor modoServidor = ModoServidor::HILOS;
+        int hilosIO = 0;
+        if (argc >= 4) {
+            std::string modoIO = argv[3];
+            if (modoIO == "epoll") {
+                modoServidor = ModoServidor::EPOLL;
+            } else if (modoIO == "reuseport") {
+                modoServidor = ModoServidor::REUSEPORT;
+            } else if (modoIO == "uring") {
+                modoServidor = ModoServidor::URING;
+            } else if (modoIO != "hilos") {
+                std::cerr << "Modo de E/S desconocido: " << modoIO << "\n";
+                return 1;
+            }
+        }
+        if (argc >= 5) {
+            hilosIO = std::stoi(argv[4]);
+        }
+        ServidorChat servidor(puerto, modoServidor, hilosIO);  // Inicializa el servidor con el puerto proporcionado
+        if (argc >= 6) {
+            servidor.establecerIntervaloTelemetria(std::chrono::milliseconds(std::stol(argv[5])));
+        }
+        if (argc >= 7) {
+            // Historial para los que entran; 0 mensajes deja el servidor sin bitácora
+            std::chrono::seconds ventana(argc >= 8 ? std::stol(argv[7]) : 0);
+            servidor.establecerHistorial(static_cast<std::size_t>(std::max(0, std::stoi(argv[6]))), ventana);
+        }
+        if (argc >= 9) {
+            // Puertos de los servidores con los que forma un solo chat, separados por comas.
+            // Como en los demás argumentos, 0 es "sin federación": los puertos <= 0 se ignoran.
+            std::vector<int> pares;
+            std::string lista = argv[8];
+            std::size_t inicio = 0;
+            while (inicio < lista.size()) {
+                std::size_t fin = lista.find(',', inicio);
+                if (fin == std::string::npos) {
+                    fin = lista.size();
+                }
+                if (fin > inicio) {
+                    int par = std::stoi(lista.substr(inicio, fin - inicio));
+                    if (par > 0) {
+                        pares.push_back(par);
+                    }
+                }
+                inicio = fin + 1;
+            }
+            servidor.establecerFederacion(pares);
+        }
+        if (argc >= 10) {
+            // Agrupado de envíos por destinatario: ventana en µs y, opcional, umbral de bytes
+            std::size_t umbral = argc >= 11 ? static_cast<std::size_t>(std::max(0L, std::stol(argv[10]))) : 0;
+            servidor.establecerAgrupado(std::chrono::microseconds(std::stol(argv[9])), umbral);
+        }
+        if (argc >= 12) {
+            // Plazos en segundos para elegir nombre y sin mandar mensajes; 0 los desactiva
+            std::chrono::seconds inactividad(argc >= 13 ? std::stol(argv[12]) : 0);
+            servidor.establecerPlazos(std::chrono::seconds(std::stol(argv[11])), inactividad);
+        }
         servidor.iniciar();  // Inicia el servidor
     } else if (modo == "cliente") {
         if (argc < 4) {
-            std::cerr << "Uso: " << argv[0] << " cliente <direccionIP> <puerto>\n";
+            std::cerr << "Uso: " << argv[0] << " cliente <direccionIP> <puerto> [texto|tramas] [mensajesPorLote] [esperaLoteUs]\n";
             return 1;
         }
         std::string direccionIP = argv[2];
         int puerto = std::stoi(argv[3]);
-        ClienteChat cliente(direccionIP, puerto);  // Inicializa el cliente con la dirección IP y puerto proporcionados
+
+        // Protocolo opcional: texto (por defecto) o tramas con longitud
+        bool usarTramas = false;
+        if (argc >= 5) {
+            std::string protocolo = argv[4];
+            if (protocolo == "tramas") {
+                usarTramas = true;
+            } else if (protocolo != "texto") {
+                std::cerr << "Protocolo desconocido: " << protocolo << "\n";
+                return 1;
+            }
+        }
+        if (argc >= 6) {
+            mensajesPorLote = std::max(1, std::stoi(argv[5]));
+        }
+        if (argc >= 7) {
+            esperaLote = std::chrono::microseconds(std::stol(argv[6]));
+        }
+        if (mensajesPorLote > 1) {
+            // Antes de cualquier E/S: sin sincronizar con stdio, getline deja de limitar el ritmo
+            std::ios::sync_with_stdio(false);
+        }
+        ClienteChat cliente(direccionIP, puerto, usarTramas);  // Inicializa el cliente con la dirección IP y puerto proporcionados
         cliente.conectarAlServidor();  // Conecta al servidor
 
-        // Inicializa los semáforos
-        const int queueSize = 10;
-        sem_init(&emptySlots, 0, queueSize);
-        sem_init(&filledSlots, 0, 0);
+        // Con lotes, la entrada estándar va a una cola y un hilo la envía por lotes
+        std::unique_ptr<ColaMPMC<ElementoCola>> entrada;
+        std::thread hiloEnvio;
+        if (mensajesPorLote > 1) {
+            entrada.reset(new ColaMPMC<ElementoCola>(CAPACIDAD_ENTRADA));
+            hiloEnvio = std::thread(enviarPorLotes, std::ref(*entrada), std::ref(cliente));
+        }
 
         // Bucle para manejar comandos del cliente
         std::string mensaje;
         while (std::getline(std::cin, mensaje)) {
             if (mensaje == "*mostrar proceso*") {
                 mostrarEstado(cliente);
+            } else if (entrada) {
+                ElementoCola elemento;
+                elemento.mensaje = std::move(mensaje);
+                elemento.encolado = std::chrono::steady_clock::now();
+                entrada->encolar(std::move(elemento));
             } else {
                 cliente.manejarComando(mensaje);  // Envía el mensaje al servidor
             }
         }
-
-        // Destruye los semáforos después de su uso
-        sem_destroy(&emptySlots);
-        sem_destroy(&filledSlots);
+        if (entrada) {
+            entrada->cerrar();  // El hilo de envío vacía lo que quede y termina
+            hiloEnvio.join();
+        }
 
         cliente.desconectar();  // Desconecta del servidor
     } else {
@@ -0,0 +1,313 @@
+#include "AgregadorTelemetria.h"
+#include "TelemetriaCompartida.h"
+#include <iostream>
+#include <thread>
+#include <algorithm>
+#include <chrono>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+// Datagramas leídos como máximo en cada llamada a recvmmsg
+static const int DATAGRAMAS_POR_LOTE = 64;
+static const std::size_t TAMANO_DATAGRAMA = 2048;
+
+// Buffer de recepción del socket, para absorber ráfagas de cientos de servidores
+static const int BUFFER_RECEPCION = 4 * 1024 * 1024;
+
+// Cada cuánto se recorren las ranuras del segmento compartido; los servidores publican a este ritmo
+static const std::chrono::milliseconds INTERVALO_LECTURA_COMPARTIDA(100);
+
+static std::int64_t ahoraMonotonicoNs() {
+    return std::chrono::steady_clock::now().time_since_epoch().count();
+}
+
+SerieServidor::SerieServidor(std::uint16_t puerto, std::size_t capacidad)
+    : puerto(puerto), muestras(capacidad), siguiente(0), cantidad(0), instanteUltimo(0), perdidos(0) {
+    std::memset(&ultimo, 0, sizeof(ultimo));
+}
+
+// Contar los huecos de secuencia y guardar la muestra en el anillo, pisando la más vieja
+void SerieServidor::agregar(const PaqueteTelemetria& paquete, std::int64_t instanteNs) {
+    std::lock_guard<std::mutex> lock(mutexSerie);
+    if (cantidad > 0 && paquete.idInstancia == ultimo.idInstancia && paquete.secuencia > ultimo.secuencia + 1) {
+        perdidos += paquete.secuencia - ultimo.secuencia - 1;
+    }
+    guardarMuestra(paquete, instanteNs);
+    ultimo = paquete;
+    instanteUltimo = instanteNs;
+}
+
+void SerieServidor::actualizar(const PaqueteTelemetria& paquete, std::int64_t instanteNs,
+                               std::int64_t intervaloMuestrasNs) {
+    std::lock_guard<std::mutex> lock(mutexSerie);
+    if (cantidad == 0 || instanteNs - muestras[(siguiente + muestras.size() - 1) % muestras.size()].instanteNs >=
+                             intervaloMuestrasNs) {
+        guardarMuestra(paquete, instanteNs);
+    }
+    ultimo = paquete;
+    instanteUltimo = instanteNs;
+}
+
+void SerieServidor::guardarMuestra(const PaqueteTelemetria& paquete, std::int64_t instanteNs) {
+    MuestraTelemetria& muestra = muestras[siguiente];
+    muestra.instanteNs = instanteNs;
+    muestra.valores[METRICA_USUARIOS] = paquete.usuariosConectados;
+    muestra.valores[METRICA_TASA] = paquete.tasaMensajesMilis[0] / 1000.0;
+    muestra.valores[METRICA_COLAS] = static_cast<double>(paquete.bytesPendientes);
+    muestra.valores[METRICA_MEMORIA] = static_cast<double>(paquete.memoriaResidenteKB);
+    muestra.valores[METRICA_PROCESAMIENTO] = static_cast<double>(paquete.percentilesProcesamientoNs[1]);
+    siguiente = (siguiente + 1) % muestras.size();
+    cantidad = std::min(cantidad + 1, muestras.size());
+}
+
+// Mínimo, máximo, promedio y percentiles de cada métrica con las muestras desde 'desdeNs'
+void SerieServidor::resumir(std::int64_t desdeNs, ResumenMetrica resumenes[NUMERO_METRICAS]) const {
+    std::vector<double> valores[NUMERO_METRICAS];
+    {
+        std::lock_guard<std::mutex> lock(mutexSerie);
+        for (std::size_t atras = 1; atras <= cantidad; ++atras) {
+            const MuestraTelemetria& muestra = muestras[(siguiente + muestras.size() - atras) % muestras.size()];
+            if (muestra.instanteNs < desdeNs) {
+                break;
+            }
+            for (int m = 0; m < NUMERO_METRICAS; ++m) {
+                valores[m].push_back(muestra.valores[m]);
+            }
+        }
+    }
+
+    for (int m = 0; m < NUMERO_METRICAS; ++m) {
+        ResumenMetrica& resumen = resumenes[m];
+        std::memset(&resumen, 0, sizeof(resumen));
+        std::vector<double>& datos = valores[m];
+        if (datos.empty()) {
+            continue;
+        }
+        std::sort(datos.begin(), datos.end());
+        double suma = 0;
+        for (double valor : datos) {
+            suma += valor;
+        }
+        resumen.muestras = datos.size();
+        resumen.minimo = datos.front();
+        resumen.maximo = datos.back();
+        resumen.promedio = suma / datos.size();
+        resumen.p50 = datos[static_cast<std::size_t>(0.50 * (datos.size() - 1))];
+        resumen.p99 = datos[static_cast<std::size_t>(0.99 * (datos.size() - 1))];
+    }
+}
+
+bool SerieServidor::ultimoPaquete(PaqueteTelemetria& paquete, std::int64_t& instanteNs) const {
+    std::lock_guard<std::mutex> lock(mutexSerie);
+    if (cantidad == 0) {
+        return false;
+    }
+    paquete = ultimo;
+    instanteNs = instanteUltimo;
+    return true;
+}
+
+std::uint64_t SerieServidor::obtenerPerdidos() const {
+    std::lock_guard<std::mutex> lock(mutexSerie);
+    return perdidos;
+}
+
+AgregadorTelemetria::AgregadorTelemetria(std::size_t capacidadPorServidor)
+    : capacidadPorServidor(capacidadPorServidor), descriptor(-1),
+      series(new std::unique_ptr<SerieServidor>[MAX_SERVIDORES_AGREGADOS]), servidores(0), indicePorPuerto(65536, 0),
+      paquetes(0), lotes(0), descartados(0), perdidosNucleo(0), sinCapacidad(0), retrasoTotalNs(0), retrasoMaximoNs(0),
+      memoriaCompartida(false), reintentosLectura(0) {}
+
+AgregadorTelemetria::~AgregadorTelemetria() {
+    if (descriptor != -1) {
+        close(descriptor);
+    }
+}
+
+// Crear el socket UDP con marcas de tiempo del núcleo y el contador de descartes
+bool AgregadorTelemetria::abrir(const char* direccionIP, std::uint16_t puerto) {
+    descriptor = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (descriptor == -1) {
+        std::cerr << "Error al crear el socket para recibir.\n";
+        return false;
+    }
+
+    int activar = 1;
+    int tamanoBuffer = BUFFER_RECEPCION;
+    setsockopt(descriptor, SOL_SOCKET, SO_TIMESTAMPNS, &activar, sizeof(activar));
+    setsockopt(descriptor, SOL_SOCKET, SO_RXQ_OVFL, &activar, sizeof(activar));
+    setsockopt(descriptor, SOL_SOCKET, SO_RCVBUF, &tamanoBuffer, sizeof(tamanoBuffer));
+
+    sockaddr_in direccion;
+    std::memset(&direccion, 0, sizeof(direccion));
+    direccion.sin_family = AF_INET;
+    direccion.sin_port = htons(puerto);
+    if (inet_pton(AF_INET, direccionIP, &direccion.sin_addr) <= 0) {
+        std::cerr << "Error al convertir la dirección IP: " << direccionIP << std::endl;
+        return false;
+    }
+    if (bind(descriptor, (sockaddr*)&direccion, sizeof(direccion)) == -1) {
+        std::cerr << "Error al hacer bind del socket del monitor.\n";
+        return false;
+    }
+    return true;
+}
+
+// Recibir lotes de datagramas y repartirlos en las series; cada serie se bloquea solo al agregar
+void AgregadorTelemetria::ingerir() {
+    std::vector<char> buffers(DATAGRAMAS_POR_LOTE * TAMANO_DATAGRAMA);
+    const std::size_t tamanoControl = CMSG_SPACE(sizeof(timespec)) + CMSG_SPACE(sizeof(std::uint32_t));
+    std::vector<char> controles(DATAGRAMAS_POR_LOTE * tamanoControl);
+    mmsghdr mensajes[DATAGRAMAS_POR_LOTE];
+    iovec iov[DATAGRAMAS_POR_LOTE];
+
+    while (true) {
+        for (int i = 0; i < DATAGRAMAS_POR_LOTE; ++i) {
+            iov[i].iov_base = &buffers[i * TAMANO_DATAGRAMA];
+            iov[i].iov_len = TAMANO_DATAGRAMA;
+            std::memset(&mensajes[i], 0, sizeof(mensajes[i]));
+            mensajes[i].msg_hdr.msg_iov = &iov[i];
+            mensajes[i].msg_hdr.msg_iovlen = 1;
+            mensajes[i].msg_hdr.msg_control = &controles[i * tamanoControl];
+            mensajes[i].msg_hdr.msg_controllen = tamanoControl;
+        }
+
+        // Espera al primero y recoge sin bloquear los que ya estén en cola
+        int recibidos = recvmmsg(descriptor, mensajes, DATAGRAMAS_POR_LOTE, MSG_WAITFORONE, nullptr);
+        if (recibidos <= 0) {
+            if (recibidos == -1 && errno != EINTR) {
+                std::cerr << "Error en recvmmsg del monitor.\n";
+                return;
+            }
+            continue;
+        }
+        lotes.fetch_add(1, std::memory_order_relaxed);
+
+        timespec ahoraReal;
+        clock_gettime(CLOCK_REALTIME, &ahoraReal);
+        std::int64_t ahoraRealNs = ahoraReal.tv_sec * 1000000000LL + ahoraReal.tv_nsec;
+        std::int64_t instante = ahoraMonotonicoNs();
+
+        for (int i = 0; i < recibidos; ++i) {
+            msghdr& cabecera = mensajes[i].msg_hdr;
+            for (cmsghdr* control = CMSG_FIRSTHDR(&cabecera); control != nullptr; control = CMSG_NXTHDR(&cabecera, control)) {
+                if (control->cmsg_level != SOL_SOCKET) {
+                    continue;
+                }
+                if (control->cmsg_type == SCM_TIMESTAMPNS) {
+                    timespec llegada;
+                    std::memcpy(&llegada, CMSG_DATA(control), sizeof(llegada));
+                    std::int64_t retraso = ahoraRealNs - (llegada.tv_sec * 1000000000LL + llegada.tv_nsec);
+                    if (retraso > 0) {
+                        retrasoTotalNs.fetch_add(retraso, std::memory_order_relaxed);
+                        if (static_cast<std::uint64_t>(retraso) > retrasoMaximoNs.load(std::memory_order_relaxed)) {
+                            retrasoMaximoNs.store(retraso, std::memory_order_relaxed);
+                        }
+                    }
+                } else if (control->cmsg_type == SO_RXQ_OVFL) {
+                    std::uint32_t descartesNucleo;
+                    std::memcpy(&descartesNucleo, CMSG_DATA(control), sizeof(descartesNucleo));
+                    perdidosNucleo.store(descartesNucleo, std::memory_order_relaxed);  // Acumulado del socket
+                }
+            }
+
+            paquetes.fetch_add(1, std::memory_order_relaxed);
+            PaqueteTelemetria paquete;
+            if (!leerPaqueteTelemetria(&buffers[i * TAMANO_DATAGRAMA], mensajes[i].msg_len, paquete)) {
+                descartados.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            SerieServidor* destino = buscarSerie(paquete.puerto);
+            if (destino == nullptr) {
+                sinCapacidad.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            destino->agregar(paquete, instante);
+        }
+    }
+}
+
+// Recorrer las ranuras a intervalos fijos y pasar a las series solo los paquetes nuevos. Un paquete
+// se reconoce por (idInstancia, secuencia) de su ranura; una ranura vacía o que no se pudo leer
+// a tiempo se deja para la siguiente vuelta.
+void AgregadorTelemetria::leerCompartida(const SegmentoTelemetria& segmento, std::chrono::milliseconds intervaloMuestras) {
+    struct Visto {
+        std::uint64_t idInstancia;
+        std::uint64_t secuencia;
+    };
+    std::vector<Visto> vistos(segmento.numeroRanuras(), Visto{0, 0});
+    std::int64_t intervaloNs = std::chrono::duration_cast<std::chrono::nanoseconds>(intervaloMuestras).count();
+    memoriaCompartida.store(true, std::memory_order_relaxed);
+
+    auto siguiente = std::chrono::steady_clock::now();
+    while (true) {
+        std::int64_t instante = ahoraMonotonicoNs();
+        std::uint64_t reintentos = 0;
+        std::uint64_t nuevos = 0;
+        for (std::size_t i = 0; i < segmento.numeroRanuras(); ++i) {
+            PaqueteTelemetria paquete;
+            if (!segmento.leer(i, paquete, reintentos)) {
+                continue;
+            }
+            Visto& visto = vistos[i];
+            if (visto.idInstancia == paquete.idInstancia && visto.secuencia == paquete.secuencia) {
+                continue;
+            }
+            visto.idInstancia = paquete.idInstancia;
+            visto.secuencia = paquete.secuencia;
+            nuevos++;
+            SerieServidor* destino = buscarSerie(paquete.puerto);
+            if (destino == nullptr) {
+                sinCapacidad.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            destino->actualizar(paquete, instante, intervaloNs);
+        }
+        paquetes.fetch_add(nuevos, std::memory_order_relaxed);
+        reintentosLectura.fetch_add(reintentos, std::memory_order_relaxed);
+
+        siguiente += INTERVALO_LECTURA_COMPARTIDA;
+        std::this_thread::sleep_until(siguiente);
+    }
+}
+
+// Serie del puerto, creándola la primera vez; la publicación con 'release' la hace visible a los lectores
+SerieServidor* AgregadorTelemetria::buscarSerie(std::uint16_t puerto) {
+    int indice = indicePorPuerto[puerto];
+    if (indice != 0) {
+        return series[indice - 1].get();
+    }
+    std::size_t nuevo = servidores.load(std::memory_order_relaxed);
+    if (nuevo >= MAX_SERVIDORES_AGREGADOS) {
+        return nullptr;
+    }
+    series[nuevo].reset(new SerieServidor(puerto, capacidadPorServidor));
+    indicePorPuerto[puerto] = static_cast<int>(nuevo) + 1;
+    servidores.store(nuevo + 1, std::memory_order_release);
+    return series[nuevo].get();
+}
+
+EstadisticasIngesta AgregadorTelemetria::obtenerEstadisticas() const {
+    EstadisticasIngesta estadisticas;
+    estadisticas.paquetes = paquetes.load(std::memory_order_relaxed);
+    estadisticas.lotes = lotes.load(std::memory_order_relaxed);
+    estadisticas.descartados = descartados.load(std::memory_order_relaxed);
+    estadisticas.perdidosNucleo = perdidosNucleo.load(std::memory_order_relaxed);
+    estadisticas.sinCapacidad = sinCapacidad.load(std::memory_order_relaxed);
+    estadisticas.perdidos = 0;
+    for (std::size_t i = 0; i < numeroServidores(); ++i) {
+        estadisticas.perdidos += series[i]->obtenerPerdidos();
+    }
+    estadisticas.retrasoPromedioUs = estadisticas.paquetes > 0
+                                         ? retrasoTotalNs.load(std::memory_order_relaxed) / 1000.0 / estadisticas.paquetes
+                                         : 0.0;
+    estadisticas.retrasoMaximoUs = retrasoMaximoNs.load(std::memory_order_relaxed) / 1000.0;
+    estadisticas.memoriaCompartida = memoriaCompartida.load(std::memory_order_relaxed);
+    estadisticas.reintentosLectura = reintentosLectura.load(std::memory_order_relaxed);
+    return estadisticas;
+}
@@ -0,0 +1,232 @@
+#include "AnilloUring.h"
+#include <iostream>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+static int io_uring_setup(unsigned entradas, io_uring_params* parametros) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entradas, parametros));
+}
+
+static int io_uring_enter(int descriptor, unsigned aEnviar, unsigned minimo, unsigned banderas) {
+    return static_cast<int>(syscall(__NR_io_uring_enter, descriptor, aEnviar, minimo, banderas, nullptr, 0));
+}
+
+static int io_uring_register(int descriptor, unsigned codigo, void* argumento, unsigned cantidad) {
+    return static_cast<int>(syscall(__NR_io_uring_register, descriptor, codigo, argumento, cantidad));
+}
+
+// Completadas por cada entrada de envío: una recepción multishot produce muchas
+static const unsigned COMPLETADAS_POR_ENTRADA = 4;
+
+// Operaciones sin las que el reactor no puede funcionar
+static const std::uint8_t OPERACIONES_NECESARIAS[] = {IORING_OP_ACCEPT, IORING_OP_RECV, IORING_OP_SENDMSG,
+                                                      IORING_OP_POLL_ADD, IORING_OP_ASYNC_CANCEL};
+
+AnilloUring::AnilloUring()
+    : descriptor(-1), memoriaEnvio(MAP_FAILED), tamanoEnvio(0), memoriaCompletadas(MAP_FAILED), tamanoCompletadas(0),
+      entradas(nullptr), tamanoEntradas(0), cabezaEnvio(nullptr), colaEnvio(nullptr), mascaraEnvio(0),
+      indicesEnvio(nullptr), entradasEnvio(0), colaLocal(0), cabezaCompletadas(nullptr), colaCompletadas(nullptr),
+      mascaraCompletadas(0), completadas(nullptr), llamadas(0) {}
+
+AnilloUring::~AnilloUring() {
+    if (entradas != nullptr) {
+        munmap(entradas, tamanoEntradas);
+    }
+    if (memoriaCompletadas != MAP_FAILED && memoriaCompletadas != memoriaEnvio) {
+        munmap(memoriaCompletadas, tamanoCompletadas);
+    }
+    if (memoriaEnvio != MAP_FAILED) {
+        munmap(memoriaEnvio, tamanoEnvio);
+    }
+    if (descriptor != -1) {
+        close(descriptor);
+    }
+}
+
+// Crear un anillo de prueba, revisar las operaciones y registrar un grupo de buffers
+bool AnilloUring::disponible() {
+    AnilloUring anillo;
+    if (!anillo.iniciar(4)) {
+        return false;
+    }
+
+    std::vector<char> memoria(sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op), 0);
+    io_uring_probe* sonda = reinterpret_cast<io_uring_probe*>(memoria.data());
+    if (io_uring_register(anillo.descriptor, IORING_REGISTER_PROBE, sonda, 256) == -1) {
+        return false;
+    }
+    for (std::uint8_t operacion : OPERACIONES_NECESARIAS) {
+        if (operacion >= sonda->ops_len || !(sonda->ops[operacion].flags & IO_URING_OP_SUPPORTED)) {
+            return false;
+        }
+    }
+
+    GrupoBuffers prueba(anillo, 0, 1, 64);
+    return prueba.registrar();
+}
+
+// io_uring_setup y los tres mapeos: cola de envío, cola de completadas y entradas
+bool AnilloUring::iniciar(unsigned numeroEntradas) {
+    io_uring_params parametros;
+    std::memset(&parametros, 0, sizeof(parametros));
+    parametros.flags = IORING_SETUP_CQSIZE | IORING_SETUP_COOP_TASKRUN;
+    parametros.cq_entries = numeroEntradas * COMPLETADAS_POR_ENTRADA;
+    descriptor = io_uring_setup(numeroEntradas, &parametros);
+    if (descriptor == -1 && errno == EINVAL) {
+        // Núcleos anteriores a COOP_TASKRUN
+        std::memset(&parametros, 0, sizeof(parametros));
+        parametros.flags = IORING_SETUP_CQSIZE;
+        parametros.cq_entries = numeroEntradas * COMPLETADAS_POR_ENTRADA;
+        descriptor = io_uring_setup(numeroEntradas, &parametros);
+    }
+    if (descriptor == -1) {
+        return false;
+    }
+
+    tamanoEnvio = parametros.sq_off.array + parametros.sq_entries * sizeof(unsigned);
+    tamanoCompletadas = parametros.cq_off.cqes + parametros.cq_entries * sizeof(io_uring_cqe);
+    if (parametros.features & IORING_FEAT_SINGLE_MMAP) {
+        tamanoEnvio = std::max(tamanoEnvio, tamanoCompletadas);
+    }
+    memoriaEnvio = mmap(nullptr, tamanoEnvio, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, descriptor,
+                        IORING_OFF_SQ_RING);
+    if (memoriaEnvio == MAP_FAILED) {
+        return false;
+    }
+    if (parametros.features & IORING_FEAT_SINGLE_MMAP) {
+        memoriaCompletadas = memoriaEnvio;
+    } else {
+        memoriaCompletadas = mmap(nullptr, tamanoCompletadas, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                  descriptor, IORING_OFF_CQ_RING);
+        if (memoriaCompletadas == MAP_FAILED) {
+            return false;
+        }
+    }
+    tamanoEntradas = parametros.sq_entries * sizeof(io_uring_sqe);
+    void* memoriaEntradas = mmap(nullptr, tamanoEntradas, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, descriptor,
+                                 IORING_OFF_SQES);
+    if (memoriaEntradas == MAP_FAILED) {
+        return false;
+    }
+    entradas = static_cast<io_uring_sqe*>(memoriaEntradas);
+
+    char* envio = static_cast<char*>(memoriaEnvio);
+    cabezaEnvio = reinterpret_cast<unsigned*>(envio + parametros.sq_off.head);
+    colaEnvio = reinterpret_cast<unsigned*>(envio + parametros.sq_off.tail);
+    mascaraEnvio = *reinterpret_cast<unsigned*>(envio + parametros.sq_off.ring_mask);
+    indicesEnvio = reinterpret_cast<unsigned*>(envio + parametros.sq_off.array);
+    entradasEnvio = parametros.sq_entries;
+    colaLocal = *colaEnvio;
+
+    char* completadasBase = static_cast<char*>(memoriaCompletadas);
+    cabezaCompletadas = reinterpret_cast<unsigned*>(completadasBase + parametros.cq_off.head);
+    colaCompletadas = reinterpret_cast<unsigned*>(completadasBase + parametros.cq_off.tail);
+    mascaraCompletadas = *reinterpret_cast<unsigned*>(completadasBase + parametros.cq_off.ring_mask);
+    completadas = reinterpret_cast<io_uring_cqe*>(completadasBase + parametros.cq_off.cqes);
+
+    // Cada posición de la cola apunta siempre a su propia entrada: no hay que reescribir el índice
+    for (unsigned i = 0; i < entradasEnvio; ++i) {
+        indicesEnvio[i] = i;
+    }
+    return true;
+}
+
+io_uring_sqe* AnilloUring::obtenerEntrada() {
+    if (colaLocal - __atomic_load_n(cabezaEnvio, __ATOMIC_ACQUIRE) >= entradasEnvio) {
+        enviar();
+        if (colaLocal - __atomic_load_n(cabezaEnvio, __ATOMIC_ACQUIRE) >= entradasEnvio) {
+            return nullptr;
+        }
+    }
+    io_uring_sqe* entrada = &entradas[colaLocal & mascaraEnvio];
+    colaLocal++;
+    std::memset(entrada, 0, sizeof(*entrada));
+    return entrada;
+}
+
+bool AnilloUring::enviar() {
+    unsigned pendientes = colaLocal - __atomic_load_n(cabezaEnvio, __ATOMIC_ACQUIRE);
+    if (pendientes == 0) {
+        return true;
+    }
+    return entrar(pendientes, 0, 0);
+}
+
+bool AnilloUring::esperar() {
+    unsigned pendientes = colaLocal - __atomic_load_n(cabezaEnvio, __ATOMIC_ACQUIRE);
+    return entrar(pendientes, 1, IORING_ENTER_GETEVENTS);
+}
+
+// Publicar la cola local y entrar al núcleo; lo que no alcance a consumir queda para la próxima
+bool AnilloUring::entrar(unsigned aEnviar, unsigned minimo, unsigned banderas) {
+    __atomic_store_n(colaEnvio, colaLocal, __ATOMIC_RELEASE);
+    while (true) {
+        llamadas++;
+        if (io_uring_enter(descriptor, aEnviar, minimo, banderas) != -1) {
+            return true;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        // Sin lugar para más completadas: el llamador las recorre y vuelve a intentar
+        if (errno == EAGAIN || errno == EBUSY) {
+            return true;
+        }
+        std::cerr << "Error en io_uring_enter: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+}
+
+GrupoBuffers::GrupoBuffers(AnilloUring& anillo, std::uint16_t grupo, unsigned cantidad, std::size_t tamano)
+    : anillo(anillo), grupo(grupo), cantidad(cantidad), tamano(tamano), datos(cantidad * tamano),
+      anilloBuffers(nullptr), cola(0), registrado(false) {}
+
+GrupoBuffers::~GrupoBuffers() {
+    if (registrado) {
+        io_uring_buf_reg registro;
+        std::memset(&registro, 0, sizeof(registro));
+        registro.bgid = grupo;
+        io_uring_register(anillo.obtenerDescriptor(), IORING_UNREGISTER_PBUF_RING, &registro, 1);
+    }
+    if (anilloBuffers != nullptr) {
+        munmap(anilloBuffers, cantidad * sizeof(io_uring_buf));
+    }
+}
+
+// Registrar el anillo de buffers y entregar todos al núcleo
+bool GrupoBuffers::registrar() {
+    void* memoria = mmap(nullptr, cantidad * sizeof(io_uring_buf), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+                         -1, 0);
+    if (memoria == MAP_FAILED) {
+        return false;
+    }
+    anilloBuffers = static_cast<io_uring_buf*>(memoria);
+
+    io_uring_buf_reg registro;
+    std::memset(&registro, 0, sizeof(registro));
+    registro.ring_addr = reinterpret_cast<std::uint64_t>(anilloBuffers);
+    registro.ring_entries = cantidad;
+    registro.bgid = grupo;
+    if (io_uring_register(anillo.obtenerDescriptor(), IORING_REGISTER_PBUF_RING, &registro, 1) == -1) {
+        return false;
+    }
+    registrado = true;
+    for (unsigned i = 0; i < cantidad; ++i) {
+        devolver(static_cast<std::uint16_t>(i));
+    }
+    return true;
+}
+
+// Poner el buffer al final del anillo; la cola se publica con 'release' para que el núcleo vea la entrada
+void GrupoBuffers::devolver(std::uint16_t indice) {
+    io_uring_buf& entrada = anilloBuffers[cola & (cantidad - 1)];
+    entrada.addr = reinterpret_cast<std::uint64_t>(&datos[indice * tamano]);
+    entrada.len = static_cast<std::uint32_t>(tamano);
+    entrada.bid = indice;
+    cola++;
+    __atomic_store_n(&anilloBuffers[0].resv, cola, __ATOMIC_RELEASE);
+}
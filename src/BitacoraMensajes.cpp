@@ -0,0 +1,375 @@
+#include "BitacoraMensajes.h"
+#include "Protocolo.h"
+#include <algorithm>
+#include <iostream>
+#include <thread>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <limits>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Los registros ocupan múltiplos de su cabecera: así siempre cabe un relleno en los bytes que sobran
+static const std::size_t ALINEACION_REGISTRO = sizeof(CabeceraRegistro);
+
+static std::size_t alinearRegistro(std::size_t bytes) {
+    return (bytes + ALINEACION_REGISTRO - 1) & ~(ALINEACION_REGISTRO - 1);
+}
+
+static void escribirRelleno(char* destino, std::size_t longitud, std::int64_t instanteNs) {
+    CabeceraRegistro* relleno = reinterpret_cast<CabeceraRegistro*>(destino);
+    relleno->tipo = REGISTRO_RELLENO;
+    relleno->instanteNs = instanteNs;
+    __atomic_store_n(&relleno->longitud, static_cast<std::uint32_t>(longitud), __ATOMIC_RELEASE);
+}
+
+static std::int64_t instanteActualNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// Abrir (o crear con su tamaño completo) el archivo de un segmento y mapearlo.
+// Se reservan los bloques y se cargan las páginas aquí para no pagar fallos de página al anexar.
+std::shared_ptr<SegmentoBitacora> SegmentoBitacora::abrir(const std::string& ruta, std::uint64_t numero,
+                                                          std::size_t capacidad) {
+    int descriptor = ::open(ruta.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (descriptor == -1) {
+        std::cerr << "Error al abrir el segmento de la bitácora " << ruta << ".\n";
+        return nullptr;
+    }
+    struct stat estado;
+    if (fstat(descriptor, &estado) == -1) {
+        close(descriptor);
+        return nullptr;
+    }
+    if (estado.st_size == 0 && posix_fallocate(descriptor, 0, capacidad) != 0 &&
+        ftruncate(descriptor, capacidad) == -1) {
+        std::cerr << "Error al reservar el segmento de la bitácora " << ruta << ".\n";
+        close(descriptor);
+        return nullptr;
+    }
+    if (estado.st_size != 0 && static_cast<std::size_t>(estado.st_size) != capacidad) {
+        // Segmento de otra configuración: no se puede mezclar con los actuales
+        close(descriptor);
+        return nullptr;
+    }
+
+    void* mapeo = mmap(nullptr, capacidad, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, descriptor, 0);
+    if (mapeo == MAP_FAILED) {
+        std::cerr << "Error al mapear el segmento de la bitácora " << ruta << ".\n";
+        close(descriptor);
+        return nullptr;
+    }
+    return std::shared_ptr<SegmentoBitacora>(
+        new SegmentoBitacora(descriptor, static_cast<char*>(mapeo), capacidad, numero));
+}
+
+SegmentoBitacora::~SegmentoBitacora() {
+    munmap(datos, capacidad);
+    close(descriptor);
+}
+
+BitacoraMensajes::BitacoraMensajes(const ConfiguracionBitacora& configuracion)
+    : configuracion(configuracion), ranuras(new Ranura[RANURAS_SEGMENTOS]), indice(new EntradaIndice[CAPACIDAD_INDICE]),
+      cabeza(0), siguienteRegistro(0), abierta(false) {
+    // Hace falta lugar para los retenidos, el actual y el que se prepara por adelantado
+    this->configuracion.segmentosRetenidos =
+        std::max<std::size_t>(1, std::min(this->configuracion.segmentosRetenidos, RANURAS_SEGMENTOS - 2));
+    this->configuracion.capacidadSegmento = alinearRegistro(this->configuracion.capacidadSegmento);
+    for (std::size_t i = 0; i < RANURAS_SEGMENTOS; ++i) {
+        ranuras[i].numero.store(-1);
+        ranuras[i].datos.store(nullptr);
+        ranuras[i].escritores.store(0);
+    }
+    for (std::size_t i = 0; i < CAPACIDAD_INDICE; ++i) {
+        indice[i].version.store(0);
+        indice[i].posicion.store(0);
+        indice[i].longitud.store(0);
+        indice[i].instanteNs.store(0);
+    }
+}
+
+BitacoraMensajes::~BitacoraMensajes() {
+}
+
+std::string BitacoraMensajes::rutaSegmento(std::uint64_t numero) const {
+    char nombre[40];
+    std::snprintf(nombre, sizeof(nombre), "segmento_%020llu.log", static_cast<unsigned long long>(numero));
+    return configuracion.directorio + "/" + nombre;
+}
+
+// Recuperar los segmentos que quedaron de un arranque anterior y preparar el primero libre.
+// Después de un reinicio se empieza siempre en un segmento nuevo.
+bool BitacoraMensajes::abrir() {
+    if (mkdir(configuracion.directorio.c_str(), 0755) == -1 && errno != EEXIST) {
+        std::cerr << "Error al crear el directorio de la bitácora " << configuracion.directorio << ".\n";
+        return false;
+    }
+
+    std::vector<std::uint64_t> existentes;
+    if (DIR* directorio = opendir(configuracion.directorio.c_str())) {
+        while (dirent* entrada = readdir(directorio)) {
+            unsigned long long numero = 0;
+            char sufijo[8] = {0};
+            if (std::sscanf(entrada->d_name, "segmento_%20llu.%7s", &numero, sufijo) == 2 &&
+                std::strcmp(sufijo, "log") == 0) {
+                existentes.push_back(numero);
+            }
+        }
+        closedir(directorio);
+    }
+    std::sort(existentes.begin(), existentes.end());
+
+    std::size_t descartar = existentes.size() > configuracion.segmentosRetenidos
+                                ? existentes.size() - configuracion.segmentosRetenidos : 0;
+    for (std::size_t i = 0; i < existentes.size(); ++i) {
+        if (i < descartar) {
+            unlink(rutaSegmento(existentes[i]).c_str());
+        } else {
+            recuperarSegmento(existentes[i]);
+        }
+    }
+    if (!existentes.empty()) {
+        cabeza.store((existentes.back() + 1) * configuracion.capacidadSegmento);
+    }
+
+    std::lock_guard<std::mutex> lock(mutexSegmentos);
+    if (!prepararSegmento(cabeza.load() / configuracion.capacidadSegmento)) {
+        return false;
+    }
+    abierta.store(true);
+    return true;
+}
+
+// Mapear un segmento existente y volver a indexar sus registros completos. Salta los rellenos y
+// se detiene en el primer registro sin escribir (un anexado que no terminó).
+void BitacoraMensajes::recuperarSegmento(std::uint64_t numero) {
+    std::shared_ptr<SegmentoBitacora> segmento =
+        SegmentoBitacora::abrir(rutaSegmento(numero), numero, configuracion.capacidadSegmento);
+    if (!segmento) {
+        return;
+    }
+
+    const std::size_t capacidad = configuracion.capacidadSegmento;
+    std::size_t desplazamiento = 0;
+    while (desplazamiento + sizeof(CabeceraRegistro) + TAMANO_CABECERA_TRAMA <= capacidad) {
+        CabeceraRegistro cabecera;
+        std::memcpy(&cabecera, segmento->obtenerDatos() + desplazamiento, sizeof(cabecera));
+        if (cabecera.longitud == 0 || cabecera.longitud > capacidad - desplazamiento) {
+            break;
+        }
+        if (cabecera.tipo == REGISTRO_RELLENO) {
+            desplazamiento += cabecera.longitud;
+            continue;
+        }
+        Trama trama;
+        std::size_t consumidos = 0;
+        const char* datosTrama = segmento->obtenerDatos() + desplazamiento + sizeof(CabeceraRegistro);
+        if (leerTrama(datosTrama, cabecera.longitud - sizeof(CabeceraRegistro), trama, consumidos) !=
+            ResultadoTrama::COMPLETA) {
+            break;
+        }
+        publicarIndice(siguienteRegistro.fetch_add(1), numero * capacidad + desplazamiento,
+                       static_cast<std::uint32_t>(consumidos), cabecera.instanteNs);
+        desplazamiento += cabecera.longitud;
+    }
+
+    Ranura& ranura = ranuras[numero % RANURAS_SEGMENTOS];
+    ranura.segmento = segmento;
+    ranura.datos.store(segmento->obtenerDatos());
+    ranura.numero.store(static_cast<std::int64_t>(numero));
+}
+
+// Dejar la ranura vacía; espera a que salgan los escritores que ya estaban dentro.
+// Las colas de salida que todavía envían registros del segmento conservan su mapeo.
+void BitacoraMensajes::liberarRanura(Ranura& ranura) {
+    ranura.numero.store(-1);
+    while (ranura.escritores.load() != 0) {
+        std::this_thread::yield();
+    }
+    ranura.datos.store(nullptr);
+    ranura.segmento.reset();
+}
+
+// Mapear el segmento 'numero' en su ranura y soltar el que queda fuera de la retención
+bool BitacoraMensajes::prepararSegmento(std::uint64_t numero) {
+    Ranura& ranura = ranuras[numero % RANURAS_SEGMENTOS];
+    std::int64_t actual = ranura.numero.load();
+    if (actual == static_cast<std::int64_t>(numero)) {
+        return true;
+    }
+    if (actual > static_cast<std::int64_t>(numero)) {
+        return false;  // Una posición tan vieja ya no tiene segmento
+    }
+
+    std::shared_ptr<SegmentoBitacora> segmento =
+        SegmentoBitacora::abrir(rutaSegmento(numero), numero, configuracion.capacidadSegmento);
+    if (!segmento) {
+        return false;
+    }
+    liberarRanura(ranura);
+    ranura.segmento = segmento;
+    ranura.datos.store(segmento->obtenerDatos());
+    ranura.numero.store(static_cast<std::int64_t>(numero));
+
+    if (numero >= configuracion.segmentosRetenidos) {
+        std::uint64_t vencido = numero - configuracion.segmentosRetenidos;
+        Ranura& vieja = ranuras[vencido % RANURAS_SEGMENTOS];
+        if (vieja.numero.load() == static_cast<std::int64_t>(vencido)) {
+            liberarRanura(vieja);
+        }
+        unlink(rutaSegmento(vencido).c_str());
+    }
+    return true;
+}
+
+// Publicar la entrada del índice como un seqlock: version en 0 mientras cambian los campos
+void BitacoraMensajes::publicarIndice(std::uint64_t registro, std::uint64_t posicion, std::uint32_t longitud,
+                                      std::int64_t instanteNs) {
+    EntradaIndice& entrada = indice[registro % CAPACIDAD_INDICE];
+    entrada.version.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    entrada.posicion.store(posicion, std::memory_order_relaxed);
+    entrada.longitud.store(longitud, std::memory_order_relaxed);
+    entrada.instanteNs.store(instanteNs, std::memory_order_relaxed);
+    entrada.version.store(registro + 1, std::memory_order_release);
+}
+
+// Entrar a la ranura del segmento antes de comprobar cuál tiene: quien la cambie esperará a que salgamos
+char* BitacoraMensajes::entrarRanura(std::uint64_t numero) {
+    Ranura& ranura = ranuras[numero % RANURAS_SEGMENTOS];
+    while (true) {
+        ranura.escritores.fetch_add(1);
+        if (ranura.numero.load() == static_cast<std::int64_t>(numero)) {
+            return ranura.datos.load(std::memory_order_acquire);
+        }
+        ranura.escritores.fetch_sub(1);
+        std::lock_guard<std::mutex> lock(mutexSegmentos);
+        if (!prepararSegmento(numero)) {
+            return nullptr;
+        }
+    }
+}
+
+void BitacoraMensajes::salirRanura(std::uint64_t numero) {
+    ranuras[numero % RANURAS_SEGMENTOS].escritores.fetch_sub(1, std::memory_order_release);
+}
+
+// Anexar un mensaje: reservar posición y número, copiar la trama en el mapeo y publicarla
+void BitacoraMensajes::agregar(const char* texto, std::size_t longitud) {
+    const std::size_t capacidad = configuracion.capacidadSegmento;
+    const std::size_t necesarios = alinearRegistro(sizeof(CabeceraRegistro) + TAMANO_CABECERA_TRAMA + longitud);
+    if (!abierta.load(std::memory_order_relaxed) || necesarios > capacidad / 4) {
+        return;
+    }
+
+    const std::int64_t instanteNs = instanteActualNs();
+    const std::uint64_t registro = siguienteRegistro.fetch_add(1, std::memory_order_relaxed);
+    std::uint64_t posicion = cabeza.fetch_add(necesarios, std::memory_order_relaxed);
+    while (true) {
+        const std::uint64_t numero = posicion / capacidad;
+        const std::size_t desplazamiento = posicion % capacidad;
+        char* datos = entrarRanura(numero);
+        if (datos == nullptr) {
+            return;
+        }
+
+        if (desplazamiento + necesarios > capacidad) {
+            // El registro no cabe: rellenar lo reservado a ambos lados del límite y reservar de
+            // nuevo, ya en el segmento siguiente. Solo una reserva puede cruzar cada límite.
+            escribirRelleno(datos + desplazamiento, capacidad - desplazamiento, instanteNs);
+            salirRanura(numero);
+            char* siguiente = entrarRanura(numero + 1);
+            if (siguiente != nullptr) {
+                escribirRelleno(siguiente, desplazamiento + necesarios - capacidad, instanteNs);
+                salirRanura(numero + 1);
+            }
+            posicion = cabeza.fetch_add(necesarios, std::memory_order_relaxed);
+            continue;
+        }
+
+        CabeceraRegistro* cabecera = reinterpret_cast<CabeceraRegistro*>(datos + desplazamiento);
+        char* trama = datos + desplazamiento + sizeof(CabeceraRegistro);
+        cabecera->tipo = REGISTRO_MENSAJE;
+        cabecera->instanteNs = instanteNs;
+        escribirCabeceraTrama(trama, static_cast<std::uint32_t>(longitud), TRAMA_TEXTO);
+        std::memcpy(trama + TAMANO_CABECERA_TRAMA, texto, longitud);
+        __atomic_store_n(&cabecera->longitud, static_cast<std::uint32_t>(necesarios), __ATOMIC_RELEASE);
+        salirRanura(numero);
+
+        publicarIndice(registro, posicion, static_cast<std::uint32_t>(TAMANO_CABECERA_TRAMA + longitud), instanteNs);
+        return;
+    }
+}
+
+// Recorrer el índice desde el registro más nuevo hacia atrás. Las entradas a medio publicar o
+// pisadas por un anexado concurrente se saltan; el recorrido termina al salir de la ventana,
+// del límite de bytes o de los segmentos que siguen mapeados.
+void BitacoraMensajes::historial(std::size_t maximoMensajes, std::chrono::seconds ventana, std::size_t maximoBytes,
+                                 std::vector<RegistroHistorial>& destino) const {
+    destino.clear();
+    const std::uint64_t fin = siguienteRegistro.load(std::memory_order_acquire);
+    if (!abierta.load() || maximoMensajes == 0 || fin == 0) {
+        return;
+    }
+
+    std::shared_ptr<SegmentoBitacora> segmentos[RANURAS_SEGMENTOS];
+    {
+        std::lock_guard<std::mutex> lock(mutexSegmentos);
+        for (std::size_t i = 0; i < RANURAS_SEGMENTOS; ++i) {
+            segmentos[i] = ranuras[i].segmento;
+        }
+    }
+
+    const std::int64_t desde = ventana.count() > 0
+        ? instanteActualNs() - std::chrono::duration_cast<std::chrono::nanoseconds>(ventana).count()
+        : std::numeric_limits<std::int64_t>::min();
+    const std::size_t capacidad = configuracion.capacidadSegmento;
+    std::size_t bytes = 0;
+    for (std::uint64_t registro = fin; registro > 0 && fin - registro < CAPACIDAD_INDICE; --registro) {
+        const EntradaIndice& entrada = indice[(registro - 1) % CAPACIDAD_INDICE];
+        std::uint64_t version = entrada.version.load(std::memory_order_acquire);
+        if (version != registro) {
+            continue;
+        }
+        std::uint64_t posicion = entrada.posicion.load(std::memory_order_relaxed);
+        std::uint32_t longitud = entrada.longitud.load(std::memory_order_relaxed);
+        std::int64_t instanteNs = entrada.instanteNs.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (entrada.version.load(std::memory_order_relaxed) != version) {
+            continue;
+        }
+
+        if (instanteNs < desde || bytes + longitud > maximoBytes) {
+            break;
+        }
+        std::uint64_t numero = posicion / capacidad;
+        const std::shared_ptr<SegmentoBitacora>& segmento = segmentos[numero % RANURAS_SEGMENTOS];
+        if (!segmento || segmento->obtenerNumero() != numero) {
+            break;
+        }
+        RegistroHistorial encontrado = {segmento->obtenerDatos() + posicion % capacidad + sizeof(CabeceraRegistro),
+                                        longitud, segmento};
+        destino.push_back(encontrado);
+        bytes += longitud;
+        if (destino.size() == maximoMensajes) {
+            break;
+        }
+    }
+    std::reverse(destino.begin(), destino.end());
+}
+
+// Mapear por adelantado el segmento siguiente para que ningún anexado cree archivos
+void BitacoraMensajes::mantener() {
+    if (!abierta.load()) {
+        return;
+    }
+    std::uint64_t actual = cabeza.load(std::memory_order_relaxed) / configuracion.capacidadSegmento;
+    std::lock_guard<std::mutex> lock(mutexSegmentos);
+    prepararSegmento(actual);
+    prepararSegmento(actual + 1);
+}
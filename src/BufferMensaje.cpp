@@ -0,0 +1,151 @@
+#include "BufferMensaje.h"
+#include <mutex>
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+// Tamaños de bloque del pool (cabecera incluida); los mensajes más grandes van directo a malloc
+static const std::size_t TAMANOS_CLASE[] = {128, 512, 2048, 8192, 32768};
+static const std::uint32_t NUMERO_CLASES = sizeof(TAMANOS_CLASE) / sizeof(TAMANOS_CLASE[0]);
+static const std::uint32_t SIN_CLASE = NUMERO_CLASES;
+
+// Bloques libres que guarda cada hilo antes de devolverlos a la lista global
+static const std::size_t MAX_LIBRES_POR_HILO = 256;
+
+static std::atomic<std::uint64_t> totalReservas(0);
+static std::atomic<std::uint64_t> totalReservasSistema(0);
+
+// Lista global de bloques libres por clase, compartida entre hilos
+struct ListaGlobal {
+    std::mutex mutex;
+    std::vector<void*> libres[NUMERO_CLASES];
+};
+
+static ListaGlobal& listaGlobal() {
+    static ListaGlobal* lista = new ListaGlobal();  // No se destruye: los hilos pueden devolver bloques al salir
+    return *lista;
+}
+
+// Caché de bloques libres de cada hilo; evita el candado en el caso común
+struct CacheHilo {
+    std::vector<void*> libres[NUMERO_CLASES];
+
+    ~CacheHilo() {
+        ListaGlobal& global = listaGlobal();
+        std::lock_guard<std::mutex> lock(global.mutex);
+        for (std::uint32_t clase = 0; clase < NUMERO_CLASES; ++clase) {
+            global.libres[clase].insert(global.libres[clase].end(), libres[clase].begin(), libres[clase].end());
+        }
+    }
+};
+
+static thread_local CacheHilo cacheHilo;
+
+static std::uint32_t claseParaTamano(std::size_t bytes) {
+    for (std::uint32_t clase = 0; clase < NUMERO_CLASES; ++clase) {
+        if (bytes <= TAMANOS_CLASE[clase]) {
+            return clase;
+        }
+    }
+    return SIN_CLASE;
+}
+
+// Tomar un bloque del pool: caché del hilo, luego lista global (por lotes), luego malloc
+static void* reservarBloque(std::uint32_t clase, std::size_t bytes) {
+    if (clase != SIN_CLASE) {
+        std::vector<void*>& local = cacheHilo.libres[clase];
+        if (local.empty()) {
+            ListaGlobal& global = listaGlobal();
+            std::lock_guard<std::mutex> lock(global.mutex);
+            std::vector<void*>& compartidos = global.libres[clase];
+            std::size_t cantidad = std::min(compartidos.size(), MAX_LIBRES_POR_HILO / 2);
+            local.insert(local.end(), compartidos.end() - cantidad, compartidos.end());
+            compartidos.resize(compartidos.size() - cantidad);
+        }
+        if (!local.empty()) {
+            void* bloque = local.back();
+            local.pop_back();
+            return bloque;
+        }
+        bytes = TAMANOS_CLASE[clase];
+    }
+
+    totalReservasSistema.fetch_add(1, std::memory_order_relaxed);
+    void* bloque = std::malloc(bytes);
+    if (!bloque) {
+        throw std::bad_alloc();
+    }
+    return bloque;
+}
+
+// Devolver un bloque al pool del hilo que suelta la última referencia
+static void liberarBloque(void* bloque, std::uint32_t clase) {
+    if (clase == SIN_CLASE) {
+        std::free(bloque);
+        return;
+    }
+
+    std::vector<void*>& local = cacheHilo.libres[clase];
+    if (local.size() >= MAX_LIBRES_POR_HILO) {
+        // Pasar la mitad a la lista global para que otros hilos la reutilicen
+        ListaGlobal& global = listaGlobal();
+        std::lock_guard<std::mutex> lock(global.mutex);
+        std::size_t cantidad = local.size() / 2;
+        global.libres[clase].insert(global.libres[clase].end(), local.end() - cantidad, local.end());
+        local.resize(local.size() - cantidad);
+    }
+    local.push_back(bloque);
+}
+
+Fragmento::Fragmento(const char* texto) : datos(texto), longitud(std::strlen(texto)) {}
+
+// Construir el mensaje copiando los fragmentos una sola vez
+ReferenciaMensaje BufferMensaje::crear(std::initializer_list<Fragmento> fragmentos) {
+    std::size_t longitudTotal = 0;
+    for (const Fragmento& fragmento : fragmentos) {
+        longitudTotal += fragmento.longitud;
+    }
+
+    std::size_t bytes = offsetof(BufferMensaje, contenido) + longitudTotal;
+    std::uint32_t clase = claseParaTamano(bytes);
+    BufferMensaje* buffer = new (reservarBloque(clase, bytes)) BufferMensaje();
+    buffer->referencias.store(1, std::memory_order_relaxed);
+    buffer->tamano = static_cast<std::uint32_t>(longitudTotal);
+    buffer->claseTamano = clase;
+
+    char* destino = buffer->contenido;
+    for (const Fragmento& fragmento : fragmentos) {
+        std::memcpy(destino, fragmento.datos, fragmento.longitud);
+        destino += fragmento.longitud;
+    }
+
+    totalReservas.fetch_add(1, std::memory_order_relaxed);
+    return ReferenciaMensaje(buffer);
+}
+
+ReferenciaMensaje BufferMensaje::crear(const char* datos, std::size_t longitud) {
+    return crear({Fragmento(datos, longitud)});
+}
+
+ReferenciaMensaje BufferMensaje::crear(const std::string& texto) {
+    return crear({Fragmento(texto)});
+}
+
+// Soltar una referencia; la última devuelve el bloque al pool
+void BufferMensaje::soltar() {
+    if (referencias.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        std::uint32_t clase = claseTamano;
+        this->~BufferMensaje();
+        liberarBloque(this, clase);
+    }
+}
+
+EstadisticasPoolMensajes obtenerEstadisticasPoolMensajes() {
+    EstadisticasPoolMensajes estadisticas;
+    estadisticas.reservas = totalReservas.load();
+    estadisticas.reservasSistema = totalReservasSistema.load();
+    return estadisticas;
+}
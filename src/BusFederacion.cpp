@@ -0,0 +1,311 @@
+#include "BusFederacion.h"
+#include "Protocolo.h"
+#include <iostream>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <climits>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+// Cabecera de la carga de un LOTE: origen, primera secuencia y cantidad
+static const std::size_t TAMANO_CABECERA_LOTE = 8 + 8 + 4;
+// Bytes de cada mensaje fuera del texto: longitud del canal y longitud del texto
+static const std::size_t TAMANO_PREFIJO_MENSAJE = 1 + 4;
+
+// Espera para juntar un lote y, con el anillo vacío, para revisar si el bus sigue activo
+static const std::chrono::milliseconds ESPERA_LOTE(1);
+static const std::chrono::milliseconds ESPERA_VACIO(100);
+
+// Reintentos de conexión a un par caído
+static const std::chrono::milliseconds RETRASO_INICIAL(100);
+static const std::chrono::milliseconds RETRASO_MAXIMO(2000);
+
+// Un par que no responde o no lee se da por caído
+static const int SEGUNDOS_ESPERA_SOCKET = 5;
+
+BusFederacion::BusFederacion(std::uint64_t idInstancia, const std::string& direccionIP, const std::vector<int>& puertosPares)
+    : idInstancia(idInstancia), direccionIP(direccionIP), activo(false), anillo(CAPACIDAD_ANILLO), ultimaPublicada(0),
+      lotesEnviados(0), mensajesEnviados(0), aplicados(0), duplicados(0), huecos(0), paresConectados(0) {
+    for (int puerto : puertosPares) {
+        std::unique_ptr<Par> par(new Par());
+        par->puerto = puerto;
+        par->descriptor = -1;
+        par->siguiente = 1;
+        par->prefijos.reserve(MAX_MENSAJES_LOTE * (TAMANO_PREFIJO_MENSAJE + MAX_NOMBRE_CANAL));
+        par->partes.reserve(1 + 2 * MAX_MENSAJES_LOTE);
+        pares.push_back(std::move(par));
+    }
+}
+
+BusFederacion::~BusFederacion() {
+    activo.store(false);
+    hayMensajes.notify_all();
+    for (auto& hilo : hilos) {
+        if (hilo.joinable()) {
+            hilo.join();
+        }
+    }
+}
+
+void BusFederacion::iniciar() {
+    activo.store(true);
+    for (auto& par : pares) {
+        hilos.emplace_back(&BusFederacion::emitir, this, std::ref(*par));
+    }
+    std::cout << "Federación con " << pares.size() << " servidores pares.\n";
+}
+
+// Guardar el mensaje en el anillo; si un par se atrasa más que la capacidad, pierde los más viejos
+void BusFederacion::publicar(const std::string& canal, const ReferenciaMensaje& mensaje) {
+    {
+        std::lock_guard<std::mutex> lock(mutexAnillo);
+        EntradaBus& entrada = anillo[++ultimaPublicada % CAPACIDAD_ANILLO];
+        entrada.secuencia = ultimaPublicada;
+        entrada.longitudCanal = static_cast<std::uint8_t>(std::min(canal.size(), MAX_NOMBRE_CANAL));
+        std::memcpy(entrada.canal, canal.data(), entrada.longitudCanal);
+        entrada.mensaje = mensaje;
+    }
+    hayMensajes.notify_all();
+}
+
+std::uint64_t BusFederacion::primeraRetenida() const {
+    return ultimaPublicada >= CAPACIDAD_ANILLO ? ultimaPublicada - CAPACIDAD_ANILLO + 1 : 1;
+}
+
+std::uint64_t BusFederacion::registrarOrigen(std::uint64_t origen, std::uint64_t primera) {
+    std::lock_guard<std::mutex> lock(mutexOrigenes);
+    auto it = origenes.find(origen);
+    if (it == origenes.end()) {
+        it = origenes.emplace(origen, primera > 0 ? primera - 1 : 0).first;
+    }
+    return it->second;
+}
+
+// Aplicar cada secuencia una sola vez y en orden; un salto adelante cuenta los mensajes perdidos
+bool BusFederacion::aceptar(std::uint64_t origen, std::uint64_t secuencia) {
+    std::lock_guard<std::mutex> lock(mutexOrigenes);
+    std::uint64_t& ultima = origenes[origen];
+    if (secuencia <= ultima) {
+        duplicados.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    if (secuencia > ultima + 1) {
+        huecos.fetch_add(secuencia - ultima - 1, std::memory_order_relaxed);
+    }
+    ultima = secuencia;
+    aplicados.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+EstadisticasFederacion BusFederacion::obtenerEstadisticas() const {
+    EstadisticasFederacion estadisticas;
+    {
+        std::lock_guard<std::mutex> lock(mutexAnillo);
+        estadisticas.publicados = ultimaPublicada;
+    }
+    estadisticas.lotesEnviados = lotesEnviados.load(std::memory_order_relaxed);
+    estadisticas.mensajesEnviados = mensajesEnviados.load(std::memory_order_relaxed);
+    estadisticas.aplicados = aplicados.load(std::memory_order_relaxed);
+    estadisticas.duplicados = duplicados.load(std::memory_order_relaxed);
+    estadisticas.huecos = huecos.load(std::memory_order_relaxed);
+    estadisticas.paresConectados = paresConectados.load(std::memory_order_relaxed);
+    estadisticas.pares = static_cast<std::uint32_t>(pares.size());
+    return estadisticas;
+}
+
+// Hilo emisor de un par: conectar, sincronizar y enviar lotes hasta que el bus se detenga
+void BusFederacion::emitir(Par& par) {
+    std::vector<EntradaBus> lote;
+    lote.reserve(MAX_MENSAJES_LOTE);
+    std::chrono::milliseconds retraso = RETRASO_INICIAL;
+
+    while (activo.load()) {
+        if (par.descriptor == -1) {
+            if (!conectar(par)) {
+                std::this_thread::sleep_for(retraso);
+                retraso = std::min(retraso * 2, RETRASO_MAXIMO);
+                continue;
+            }
+            retraso = RETRASO_INICIAL;
+        }
+
+        {
+            std::unique_lock<std::mutex> lock(mutexAnillo);
+            if (!hayMensajes.wait_for(lock, ESPERA_VACIO, [&]() { return !activo.load() || ultimaPublicada >= par.siguiente; }) ||
+                !activo.load()) {
+                lock.unlock();
+                if (!enlaceAbierto(par)) {
+                    cerrar(par);  // Reconectar antes de que llegue el próximo mensaje
+                }
+                continue;
+            }
+            // Un lote a medio llenar espera un poco a que lleguen más mensajes
+            if (ultimaPublicada - par.siguiente + 1 < MAX_MENSAJES_LOTE) {
+                hayMensajes.wait_for(lock, ESPERA_LOTE, [&]() {
+                    return !activo.load() || ultimaPublicada - par.siguiente + 1 >= MAX_MENSAJES_LOTE;
+                });
+            }
+
+            par.siguiente = std::max(par.siguiente, primeraRetenida());
+            std::size_t bytes = TAMANO_CABECERA_LOTE;
+            while (par.siguiente <= ultimaPublicada && lote.size() < MAX_MENSAJES_LOTE) {
+                const EntradaBus& entrada = anillo[par.siguiente % CAPACIDAD_ANILLO];
+                std::size_t tamano = TAMANO_PREFIJO_MENSAJE + entrada.longitudCanal + entrada.mensaje->longitud();
+                if (bytes + tamano > MAX_CARGA_TRAMA) {
+                    if (lote.empty()) {
+                        par.siguiente++;  // No cabe ni solo en una trama: el receptor lo verá como hueco
+                        continue;
+                    }
+                    break;
+                }
+                lote.push_back(entrada);
+                bytes += tamano;
+                par.siguiente++;
+            }
+        }
+
+        // Un par que se reinició cerró el enlace: enviarle el lote lo perdería en el socket viejo
+        if (!lote.empty() && (!enlaceAbierto(par) || !enviarLote(par, lote))) {
+            cerrar(par);
+        }
+        lote.clear();
+    }
+    cerrar(par);
+}
+
+// Conectar con el par, presentarse y leer desde qué secuencia seguir
+bool BusFederacion::conectar(Par& par) {
+    int descriptor = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (descriptor == -1) {
+        return false;
+    }
+
+    sockaddr_in direccion;
+    std::memset(&direccion, 0, sizeof(direccion));
+    direccion.sin_family = AF_INET;
+    direccion.sin_port = htons(par.puerto);
+    timeval espera = {SEGUNDOS_ESPERA_SOCKET, 0};
+    int sinRetraso = 1;
+    if (inet_pton(AF_INET, direccionIP.c_str(), &direccion.sin_addr) <= 0 ||
+        connect(descriptor, (sockaddr*)&direccion, sizeof(direccion)) == -1 ||
+        setsockopt(descriptor, IPPROTO_TCP, TCP_NODELAY, &sinRetraso, sizeof(sinRetraso)) == -1 ||
+        setsockopt(descriptor, SOL_SOCKET, SO_RCVTIMEO, &espera, sizeof(espera)) == -1 ||
+        setsockopt(descriptor, SOL_SOCKET, SO_SNDTIMEO, &espera, sizeof(espera)) == -1) {
+        close(descriptor);
+        return false;
+    }
+
+    std::uint64_t primera;
+    {
+        std::lock_guard<std::mutex> lock(mutexAnillo);
+        primera = ultimaPublicada + 1;
+    }
+    char saludo[LONGITUD_PREAMBULO + TAMANO_CABECERA_TRAMA + 16];
+    std::memcpy(saludo, PREAMBULO_FEDERACION, LONGITUD_PREAMBULO);
+    escribirCabeceraTrama(saludo + LONGITUD_PREAMBULO, 16, TRAMA_FEDERACION_HOLA);
+    escribirEntero(saludo + LONGITUD_PREAMBULO + TAMANO_CABECERA_TRAMA, idInstancia, 8);
+    escribirEntero(saludo + LONGITUD_PREAMBULO + TAMANO_CABECERA_TRAMA + 8, primera, 8);
+
+    // El par manda primero la solicitud de nombre, como a cualquier cliente, y después ESTADO
+    char respuesta[LONGITUD_SOLICITUD_NOMBRE + TAMANO_CABECERA_TRAMA + 8];
+    Trama trama;
+    std::size_t consumidos = 0;
+    if (send(descriptor, saludo, sizeof(saludo), MSG_NOSIGNAL) != static_cast<ssize_t>(sizeof(saludo)) ||
+        recv(descriptor, respuesta, sizeof(respuesta), MSG_WAITALL) != static_cast<ssize_t>(sizeof(respuesta)) ||
+        leerTrama(respuesta + LONGITUD_SOLICITUD_NOMBRE, TAMANO_CABECERA_TRAMA + 8, trama, consumidos) != ResultadoTrama::COMPLETA ||
+        trama.tipo != TRAMA_FEDERACION_ESTADO || trama.longitud != 8) {
+        close(descriptor);
+        return false;
+    }
+
+    std::uint64_t ultima = leerEntero(trama.carga, 8);
+    {
+        std::lock_guard<std::mutex> lock(mutexAnillo);
+        par.siguiente = std::max(std::min(ultima + 1, ultimaPublicada + 1), primeraRetenida());
+    }
+    par.descriptor = descriptor;
+    paresConectados.fetch_add(1, std::memory_order_relaxed);
+    std::cout << "Federación: conectado al servidor del puerto " << par.puerto << " desde la secuencia " << par.siguiente
+              << ".\n";
+    return true;
+}
+
+// Enviar el lote como una sola trama LOTE; la carga sale de los mensajes compartidos sin copiarla
+bool BusFederacion::enviarLote(Par& par, std::vector<EntradaBus>& lote) {
+    char cabecera[TAMANO_CABECERA_TRAMA + TAMANO_CABECERA_LOTE];
+    std::size_t longitud = TAMANO_CABECERA_LOTE;
+    par.prefijos.clear();
+    for (const EntradaBus& entrada : lote) {
+        longitud += TAMANO_PREFIJO_MENSAJE + entrada.longitudCanal + entrada.mensaje->longitud();
+        par.prefijos.push_back(static_cast<char>(entrada.longitudCanal));
+        par.prefijos.insert(par.prefijos.end(), entrada.canal, entrada.canal + entrada.longitudCanal);
+        char longitudTexto[4];
+        escribirEntero(longitudTexto, entrada.mensaje->longitud(), 4);
+        par.prefijos.insert(par.prefijos.end(), longitudTexto, longitudTexto + 4);
+    }
+    escribirCabeceraTrama(cabecera, static_cast<std::uint32_t>(longitud), TRAMA_FEDERACION_LOTE);
+    escribirEntero(cabecera + TAMANO_CABECERA_TRAMA, idInstancia, 8);
+    escribirEntero(cabecera + TAMANO_CABECERA_TRAMA + 8, lote.front().secuencia, 8);
+    escribirEntero(cabecera + TAMANO_CABECERA_TRAMA + 16, lote.size(), 4);
+
+    // Los prefijos ya no cambian de lugar: se pueden apuntar desde los iovec
+    par.partes.clear();
+    par.partes.push_back(iovec{cabecera, sizeof(cabecera)});
+    char* prefijo = par.prefijos.data();
+    for (const EntradaBus& entrada : lote) {
+        std::size_t longitudPrefijo = TAMANO_PREFIJO_MENSAJE + entrada.longitudCanal;
+        par.partes.push_back(iovec{prefijo, longitudPrefijo});
+        par.partes.push_back(iovec{const_cast<char*>(entrada.mensaje->datos()), entrada.mensaje->longitud()});
+        prefijo += longitudPrefijo;
+    }
+
+    std::size_t indice = 0;
+    while (indice < par.partes.size()) {
+        msghdr mensaje;
+        std::memset(&mensaje, 0, sizeof(mensaje));
+        mensaje.msg_iov = &par.partes[indice];
+        mensaje.msg_iovlen = std::min<std::size_t>(par.partes.size() - indice, IOV_MAX);
+        ssize_t enviados = sendmsg(par.descriptor, &mensaje, MSG_NOSIGNAL);
+        if (enviados == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        // Saltar lo ya enviado, que puede terminar a mitad de un iovec
+        std::size_t restante = static_cast<std::size_t>(enviados);
+        while (indice < par.partes.size() && restante >= par.partes[indice].iov_len) {
+            restante -= par.partes[indice].iov_len;
+            indice++;
+        }
+        if (restante > 0) {
+            par.partes[indice].iov_base = static_cast<char*>(par.partes[indice].iov_base) + restante;
+            par.partes[indice].iov_len -= restante;
+        }
+    }
+
+    lotesEnviados.fetch_add(1, std::memory_order_relaxed);
+    mensajesEnviados.fetch_add(lote.size(), std::memory_order_relaxed);
+    return true;
+}
+
+// El receptor no escribe después de ESTADO: lo único que se puede leer es el cierre
+bool BusFederacion::enlaceAbierto(Par& par) {
+    char byte;
+    ssize_t leidos = recv(par.descriptor, &byte, 1, MSG_PEEK | MSG_DONTWAIT);
+    return leidos > 0 || (leidos == -1 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR));
+}
+
+void BusFederacion::cerrar(Par& par) {
+    if (par.descriptor == -1) {
+        return;
+    }
+    close(par.descriptor);
+    par.descriptor = -1;
+    paresConectados.fetch_sub(1, std::memory_order_relaxed);
+    std::cout << "Federación: se perdió el enlace con el servidor del puerto " << par.puerto << ".\n";
+}
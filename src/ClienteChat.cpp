@@ -1,46 +1,182 @@
 #include "ClienteChat.h"
+#include "Protocolo.h"
 #include <iostream>
 #include <unistd.h>
 #include <arpa/inet.h>
 #include <thread>
 #include <cstring>
+#include <vector>
+#include <algorithm>
+#include <climits>
+#include <cerrno>
+#include <cstdio>
 
 // Constructor que inicializa la dirección IP y el puerto del servidor
-ClienteChat::ClienteChat(const std::string& direccionIP, int puerto)
-    : direccionIP(direccionIP), puerto(puerto), descriptorCliente(-1), conectado(false) {}
+ClienteChat::ClienteChat(const std::string& direccionIP, int puerto, bool usarTramas)
+    : direccionIP(direccionIP), puerto(puerto), descriptorCliente(-1), conectado(false), usarTramas(usarTramas),
+      nombreEnviado(false), nombreRechazado(false) {}
 
-// Método para conectar al servidor
+// Método para conectar al servidor; sigue las redirecciones de la puerta de entrada del monitor
 void ClienteChat::conectarAlServidor() {
-    // Crear el socket del cliente
-    descriptorCliente = socket(AF_INET, SOCK_STREAM, 0);
-    if (descriptorCliente == -1) {
-        std::cerr << "Error al crear el socket del cliente.\n";
-        return;
-    }
+    static const int MAX_REDIRECCIONES = 3;
+    for (int redirecciones = 0;; ++redirecciones) {
+        // Crear el socket del cliente
+        descriptorCliente = socket(AF_INET, SOCK_STREAM, 0);
+        if (descriptorCliente == -1) {
+            std::cerr << "Error al crear el socket del cliente.\n";
+            return;
+        }
 
-    sockaddr_in direccionServidor;
-    direccionServidor.sin_family = AF_INET;
-    direccionServidor.sin_port = htons(puerto);
-    inet_pton(AF_INET, direccionIP.c_str(), &direccionServidor.sin_addr);
+        sockaddr_in direccionServidor;
+        direccionServidor.sin_family = AF_INET;
+        direccionServidor.sin_port = htons(puerto);
+        inet_pton(AF_INET, direccionIP.c_str(), &direccionServidor.sin_addr);
 
-    // Conectar al servidor
-    if (connect(descriptorCliente, (sockaddr*)&direccionServidor, sizeof(direccionServidor)) == -1) {
-        std::cerr << "Error al conectar al servidor.\n";
-        return;
+        // Conectar al servidor
+        if (connect(descriptorCliente, (sockaddr*)&direccionServidor, sizeof(direccionServidor)) == -1) {
+            std::cerr << "Error al conectar al servidor.\n";
+            close(descriptorCliente);
+            descriptorCliente = -1;
+            return;
+        }
+        if (redirecciones == MAX_REDIRECCIONES || !seguirRedireccion()) {
+            break;
+        }
+        close(descriptorCliente);
+        std::cout << "Redirigido al servidor " << direccionIP << ":" << puerto << "\n";
     }
 
     conectado = true;
 
     // Iniciar un hilo para recibir mensajes del servidor
-    std::thread hiloRecibir(&ClienteChat::recibirMensajes, this);
+    std::thread hiloRecibir(usarTramas ? &ClienteChat::recibirTramas : &ClienteChat::recibirMensajes, this);
     hiloRecibir.detach();
 }
 
+// Mirar lo primero que manda el otro extremo sin consumirlo: si es una redirección, leerla y
+// cambiar de destino. Un servidor siempre empieza por la solicitud de nombre, que no empieza igual.
+bool ClienteChat::seguirRedireccion() {
+    char linea[MAX_LINEA_REDIRECCION + 1];
+    const std::size_t longitudPrefijo = sizeof(PREFIJO_REDIRECCION) - 1;
+    ssize_t leidos = recv(descriptorCliente, linea, longitudPrefijo, MSG_PEEK | MSG_WAITALL);
+    if (leidos != static_cast<ssize_t>(longitudPrefijo) || std::memcmp(linea, PREFIJO_REDIRECCION, longitudPrefijo) != 0) {
+        return false;
+    }
+
+    // La puerta de entrada cierra después de la línea: leer hasta el salto de línea o el cierre
+    std::size_t longitud = 0;
+    while (longitud < MAX_LINEA_REDIRECCION && std::memchr(linea, '\n', longitud) == nullptr) {
+        leidos = recv(descriptorCliente, linea + longitud, MAX_LINEA_REDIRECCION - longitud, 0);
+        if (leidos <= 0) {
+            break;
+        }
+        longitud += leidos;
+    }
+    linea[longitud] = '\0';
+
+    char direccion[MAX_LINEA_REDIRECCION];
+    int puertoDestino = 0;
+    std::string formato = std::string(PREFIJO_REDIRECCION) + "%63s %d";
+    if (std::sscanf(linea, formato.c_str(), direccion, &puertoDestino) != 2 || puertoDestino <= 0) {
+        std::cerr << "Redirección inválida: " << linea << "\n";
+        return false;
+    }
+    direccionIP = direccion;
+    puerto = puertoDestino;
+    return true;
+}
+
 // Método para manejar los comandos del usuario y enviarlos al servidor
 void ClienteChat::manejarComando(const std::string& comando) {
-    if (conectado) {
+    if (!conectado) {
+        return;
+    }
+    if (!usarTramas) {
         send(descriptorCliente, comando.c_str(), comando.size(), 0);
+        return;
+    }
+
+    // El primer comando es el nombre y va junto al preámbulo que activa las tramas
+    std::lock_guard<std::mutex> lock(mutexEnvio);
+    std::string datos;
+    if (!nombreEnviado) {
+        datos.assign(PREAMBULO_TRAMAS, LONGITUD_PREAMBULO);
+    }
+    datos += construirTrama(comando, tipoSiguienteTrama());
+    send(descriptorCliente, datos.data(), datos.size(), MSG_NOSIGNAL);
+}
+
+// Envía un lote de comandos: cabecera y texto de cada trama como vectores de un solo sendmsg
+void ClienteChat::manejarComandos(const std::vector<std::string>& comandos) {
+    if (!conectado || comandos.empty()) {
+        return;
+    }
+    if (!usarTramas) {
+        for (const std::string& comando : comandos) {
+            manejarComando(comando);
+        }
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutexEnvio);
+    std::vector<char> cabeceras(comandos.size() * TAMANO_CABECERA_TRAMA);
+    std::vector<iovec> vectores;
+    vectores.reserve(comandos.size() * 2 + 1);
+    if (!nombreEnviado) {
+        vectores.push_back(iovec{const_cast<char*>(PREAMBULO_TRAMAS), LONGITUD_PREAMBULO});
+    }
+    for (std::size_t i = 0; i < comandos.size(); ++i) {
+        std::uint8_t tipo = tipoSiguienteTrama();
+        char* cabecera = &cabeceras[i * TAMANO_CABECERA_TRAMA];
+        escribirCabeceraTrama(cabecera, static_cast<std::uint32_t>(comandos[i].size()), tipo);
+        vectores.push_back(iovec{cabecera, TAMANO_CABECERA_TRAMA});
+        if (!comandos[i].empty()) {
+            vectores.push_back(iovec{const_cast<char*>(comandos[i].data()), comandos[i].size()});
+        }
+    }
+
+    // sendmsg acepta como mucho IOV_MAX vectores por llamada
+    for (std::size_t inicio = 0; inicio < vectores.size(); inicio += IOV_MAX) {
+        int cantidad = static_cast<int>(std::min<std::size_t>(IOV_MAX, vectores.size() - inicio));
+        if (!enviarVectores(&vectores[inicio], cantidad)) {
+            return;
+        }
+    }
+}
+
+// Tipo de la próxima trama, con mutexEnvio tomado: el primer comando es el nombre, y también
+// el siguiente a un nombre rechazado
+std::uint8_t ClienteChat::tipoSiguienteTrama() {
+    bool esNombre = !nombreEnviado || nombreRechazado.exchange(false);
+    nombreEnviado = true;
+    return esNombre ? TRAMA_NOMBRE : TRAMA_TEXTO;
+}
+
+// sendmsg hasta enviar todos los vectores, avanzando tras las escrituras parciales
+bool ClienteChat::enviarVectores(iovec* vectores, int cantidad) {
+    while (cantidad > 0) {
+        msghdr mensaje;
+        std::memset(&mensaje, 0, sizeof(mensaje));
+        mensaje.msg_iov = vectores;
+        mensaje.msg_iovlen = cantidad;
+        ssize_t enviados = sendmsg(descriptorCliente, &mensaje, MSG_NOSIGNAL);
+        if (enviados == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        while (cantidad > 0 && static_cast<std::size_t>(enviados) >= vectores->iov_len) {
+            enviados -= vectores->iov_len;
+            vectores++;
+            cantidad--;
+        }
+        if (cantidad > 0) {
+            vectores->iov_base = static_cast<char*>(vectores->iov_base) + enviados;
+            vectores->iov_len -= enviados;
+        }
     }
+    return true;
 }
 
 // Método para desconectar del servidor
@@ -64,4 +200,50 @@ void ClienteChat::recibirMensajes() {
         }
         std::cout << std::string(buffer, bytesRecibidos) << std::endl;
     }
-}
\ No newline at end of file
+}
+
+// Recibir con el protocolo de tramas: una lectura grande puede traer muchos mensajes
+void ClienteChat::recibirTramas() {
+    std::vector<char> buffer(TAMANO_LECTURA_TRAMAS);
+    std::string pendiente;  // Datos recibidos que aún no forman una trama completa
+    std::size_t solicitudPorDescartar = LONGITUD_SOLICITUD_NOMBRE;
+    while (conectado) {
+        ssize_t bytesRecibidos = recv(descriptorCliente, buffer.data(), buffer.size(), 0);
+        if (bytesRecibidos <= 0) {
+            std::cerr << "Desconectado del servidor.\n";
+            desconectar();
+            break;
+        }
+
+        // La solicitud de nombre llega en texto plano antes que las tramas
+        const char* datos = buffer.data();
+        std::size_t longitud = bytesRecibidos;
+        if (solicitudPorDescartar > 0) {
+            std::size_t descartar = std::min(solicitudPorDescartar, longitud);
+            std::cout << std::string(datos, strnlen(datos, descartar)) << std::endl;
+            solicitudPorDescartar -= descartar;
+            datos += descartar;
+            longitud -= descartar;
+        }
+
+        pendiente.append(datos, longitud);
+        std::size_t posicion = 0;
+        Trama trama;
+        std::size_t consumidos = 0;
+        ResultadoTrama resultado;
+        while ((resultado = leerTrama(pendiente.data() + posicion, pendiente.size() - posicion, trama, consumidos)) ==
+               ResultadoTrama::COMPLETA) {
+            if (trama.tipo == TRAMA_NOMBRE_RECHAZADO) {
+                nombreRechazado.store(true);
+            }
+            std::cout << std::string(trama.carga, trama.longitud) << std::endl;
+            posicion += consumidos;
+        }
+        if (resultado == ResultadoTrama::INVALIDA) {
+            std::cerr << "Trama inválida del servidor.\n";
+            desconectar();
+            break;
+        }
+        pendiente.erase(0, posicion);
+    }
+}
@@ -0,0 +1,228 @@
+#include "Conexion.h"
+#include <algorithm>
+#include <chrono>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/socket.h>
+
+// Constructor que toma posesión del socket del cliente
+Conexion::Conexion(int descriptor, Reactor* reactor, std::size_t marcaAlta)
+    : identificado(false), esPar(false), nombresRechazados(0), ordenLlegada(0),
+      ultimoMensaje(std::chrono::steady_clock::now().time_since_epoch().count()), inicioAgrupado(0),
+      descriptor(descriptor), reactor(reactor), marcaAlta(marcaAlta), umbralAgrupado(0), expulsada(false), tramas(false),
+      desplazamiento(0) {
+    contadores = Contadores();
+}
+
+// Cerrar el socket cuando se suelta la última referencia
+Conexion::~Conexion() {
+    close(descriptor);
+}
+
+// Longitud de la cabecera de una trama del tipo dado en la cola (0 = sin cabecera)
+static std::size_t longitudCabecera(std::uint8_t tipoTrama) {
+    return tipoTrama != 0 ? TAMANO_CABECERA_TRAMA : 0;
+}
+
+// Agregar una referencia al mensaje a la cola de salida, sin copiar ni hacer llamadas al sistema.
+// Con tramas solo se guarda el tipo: la cabecera se arma al enviar y el mensaje compartido no cambia.
+Conexion::Encolado Conexion::encolar(const ReferenciaMensaje& mensaje, std::uint8_t tipoTrama) {
+    return agregarElemento(mensaje, tipoTrama, nullptr);
+}
+
+// Agregar una región ya lista para el socket; solo se copia el puntero y se comparte el dueño
+Conexion::Encolado Conexion::encolarRegion(const char* datos, std::size_t longitud,
+                                           const std::shared_ptr<const void>& duenio) {
+    RegionSalida region;
+    region.datos = datos;
+    region.longitud = longitud;
+    region.duenio = duenio;
+    return agregarElemento(ReferenciaMensaje(), 0, &region);  // Tipo 0: va sin cabecera
+}
+
+Conexion::Encolado Conexion::agregarElemento(const ReferenciaMensaje& mensaje, std::uint8_t tipoTrama,
+                                             RegionSalida* region) {
+    std::lock_guard<std::mutex> lock(mutexSalida);
+    // Se mira con el candado tomado: lo encolado después de activar las tramas queda al final
+    bool conTramas = tramas.load();
+    std::size_t longitud = (conTramas ? longitudCabecera(tipoTrama) : 0) +
+                           (region != nullptr ? region->longitud : mensaje->longitud());
+    if (expulsada.load() || contadores.bytesPendientes + longitud > marcaAlta) {
+        return Encolado::DESBORDADO;
+    }
+
+    bool estabaVacia = pendientes.empty();
+    bool cruzaUmbral = umbralAgrupado > 0 && contadores.bytesPendientes < umbralAgrupado &&
+                       contadores.bytesPendientes + longitud >= umbralAgrupado;
+    pendientes.push_back(mensaje);
+    if (conTramas) {
+        tiposTrama.push_back(tipoTrama);
+    }
+    if (region != nullptr) {
+        regiones.push_back(std::move(*region));
+    }
+    contadores.bytesPendientes += longitud;
+    contadores.mensajesEncolados++;
+    contadores.profundidadMaxima = std::max(contadores.profundidadMaxima, contadores.bytesPendientes);
+    return estabaVacia || cruzaUmbral ? Encolado::DESPERTAR : Encolado::ENCOLADO;
+}
+
+void Conexion::establecerUmbralAgrupado(std::size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutexSalida);
+    umbralAgrupado = bytes;
+}
+
+bool Conexion::alcanzoUmbralAgrupado() const {
+    std::lock_guard<std::mutex> lock(mutexSalida);
+    return umbralAgrupado > 0 && contadores.bytesPendientes >= umbralAgrupado;
+}
+
+// Bytes del primer elemento de la cola, con su cabecera
+std::size_t Conexion::longitudPrimero() const {
+    const ReferenciaMensaje& mensaje = pendientes.front();
+    std::uint8_t tipo = tiposTrama.size() == pendientes.size() ? tiposTrama.front() : 0;
+    return longitudCabecera(tipo) + (mensaje ? mensaje->longitud() : regiones.front().longitud);
+}
+
+// Iovecs desde el primer byte sin enviar; la cabecera (si la hay) y el mensaje van por separado
+int Conexion::armarIovecs(iovec* iov, int maximo) {
+    int cantidad = 0;
+    int elementos = 0;
+    std::size_t inicio = desplazamiento;
+    std::size_t sinTipo = pendientes.size() - tiposTrama.size();
+    auto tipo = tiposTrama.begin();
+    auto region = regiones.begin();
+    maximo = std::min(maximo, MAX_IOVEC_SALIDA);
+    for (auto it = pendientes.begin(); it != pendientes.end() && cantidad + 2 <= maximo; ++it, ++elementos) {
+        std::uint8_t tipoTrama = static_cast<std::size_t>(elementos) < sinTipo ? 0 : *tipo++;
+        const char* carga;
+        std::size_t longitudCarga;
+        if (*it) {
+            carga = (*it)->datos();
+            longitudCarga = (*it)->longitud();
+        } else {
+            carga = region->datos;
+            longitudCarga = region->longitud;
+            ++region;
+        }
+        if (inicio < longitudCabecera(tipoTrama)) {
+            char* cabecera = cabeceras[elementos];
+            escribirCabeceraTrama(cabecera, static_cast<std::uint32_t>(longitudCarga), tipoTrama);
+            iov[cantidad].iov_base = cabecera + inicio;
+            iov[cantidad].iov_len = TAMANO_CABECERA_TRAMA - inicio;
+            cantidad++;
+            inicio = 0;
+        } else {
+            inicio -= longitudCabecera(tipoTrama);
+        }
+        iov[cantidad].iov_base = const_cast<char*>(carga) + inicio;
+        iov[cantidad].iov_len = longitudCarga - inicio;
+        inicio = 0;
+        cantidad++;
+    }
+    return cantidad;
+}
+
+// Descartar de la cola lo que ya salió
+void Conexion::descartarEnviados(std::size_t enviados) {
+    contadores.bytesEnviados += enviados;
+    contadores.bytesPendientes -= enviados;
+    std::size_t restantes = enviados;
+    while (restantes > 0) {
+        std::size_t disponibles = longitudPrimero() - desplazamiento;
+        if (restantes < disponibles) {
+            desplazamiento += restantes;
+            break;
+        }
+        restantes -= disponibles;
+        if (!pendientes.front()) {
+            regiones.pop_front();
+        }
+        if (tiposTrama.size() == pendientes.size()) {
+            tiposTrama.pop_front();
+        }
+        pendientes.pop_front();
+        desplazamiento = 0;
+    }
+}
+
+// Enviar todo lo pendiente con una llamada por lote de iovecs hasta que el socket se llene
+bool Conexion::vaciar(std::uint64_t* llamadas) {
+    std::lock_guard<std::mutex> lock(mutexSalida);
+    while (!pendientes.empty()) {
+        iovec iov[MAX_IOVEC_SALIDA];
+        int cantidad = armarIovecs(iov, MAX_IOVEC_SALIDA);
+
+        msghdr mensaje = msghdr();
+        mensaje.msg_iov = iov;
+        mensaje.msg_iovlen = cantidad;
+        ssize_t enviados = sendmsg(descriptor, &mensaje, MSG_DONTWAIT | MSG_NOSIGNAL);
+        contadores.llamadasEnvio++;
+        if (llamadas != nullptr) {
+            (*llamadas)++;
+        }
+        if (enviados == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            // Socket lleno: el reactor volverá a intentar cuando sea escribible
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        descartarEnviados(enviados);
+    }
+    return true;
+}
+
+// Los datos de la cola no se liberan hasta que salen y las cabeceras quedan en 'cabeceras' hasta
+// el próximo armado: los iovecs siguen valiendo mientras el núcleo envía, aunque otros hilos encolen
+int Conexion::prepararEnvio(iovec* iov, int maximo) {
+    std::lock_guard<std::mutex> lock(mutexSalida);
+    return armarIovecs(iov, maximo);
+}
+
+bool Conexion::completarEnvio(ssize_t enviados) {
+    std::lock_guard<std::mutex> lock(mutexSalida);
+    contadores.llamadasEnvio++;
+    if (enviados < 0) {
+        // Cancelado por una pausa o el núcleo pidió reintentar: la cola queda como estaba
+        return enviados == -ECANCELED || enviados == -EAGAIN || enviados == -EINTR;
+    }
+    descartarEnviados(static_cast<std::size_t>(enviados));
+    return true;
+}
+
+std::string Conexion::copiarPendientes() const {
+    std::lock_guard<std::mutex> lock(mutexSalida);
+    std::string datos;
+    datos.reserve(contadores.bytesPendientes + desplazamiento);
+    std::size_t sinTipo = pendientes.size() - tiposTrama.size();
+    auto tipo = tiposTrama.begin();
+    auto region = regiones.begin();
+    for (auto it = pendientes.begin(); it != pendientes.end(); ++it) {
+        std::uint8_t tipoTrama = static_cast<std::size_t>(it - pendientes.begin()) < sinTipo ? 0 : *tipo++;
+        const char* carga = *it ? (*it)->datos() : region->datos;
+        std::size_t longitudCarga = *it ? (*it)->longitud() : (region++)->longitud;
+        if (tipoTrama != 0) {
+            char cabecera[TAMANO_CABECERA_TRAMA];
+            escribirCabeceraTrama(cabecera, static_cast<std::uint32_t>(longitudCarga), tipoTrama);
+            datos.append(cabecera, sizeof(cabecera));
+        }
+        datos.append(carga, longitudCarga);
+    }
+    return datos.substr(desplazamiento);
+}
+
+// Marcar la conexión y cortarla; devuelve true solo la primera vez.
+// El descriptor se cierra con la última referencia.
+bool Conexion::expulsar() {
+    if (expulsada.exchange(true)) {
+        return false;
+    }
+    shutdown(descriptor, SHUT_RDWR);
+    return true;
+}
+
+Conexion::Contadores Conexion::obtenerContadores() const {
+    std::lock_guard<std::mutex> lock(mutexSalida);
+    return contadores;
+}
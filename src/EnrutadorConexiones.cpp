@@ -0,0 +1,167 @@
+#include "EnrutadorConexiones.h"
+#include "AgregadorTelemetria.h"
+#include "SupervisorProcesos.h"
+#include "Protocolo.h"
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <chrono>
+#include <thread>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+// Espera antes de volver a aceptar cuando se agotaron los descriptores o la memoria
+static const std::chrono::milliseconds ESPERA_SIN_RECURSOS(100);
+
+EnrutadorConexiones::EnrutadorConexiones(const AgregadorTelemetria& agregador, const SupervisorProcesos& supervisor,
+                                         const std::string& direccionIP, std::chrono::milliseconds frescura)
+    : agregador(agregador), supervisor(supervisor), direccionIP(direccionIP), frescura(frescura), descriptor(-1),
+      siguienteRotativo(0) {
+    estadisticas.redirigidas = 0;
+    estadisticas.sinTelemetria = 0;
+    estadisticas.rechazadas = 0;
+}
+
+EnrutadorConexiones::~EnrutadorConexiones() {
+    if (descriptor != -1) {
+        close(descriptor);
+    }
+}
+
+bool EnrutadorConexiones::abrir(int puerto) {
+    descriptor = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (descriptor == -1) {
+        std::cerr << "Error al crear el socket de la puerta de entrada.\n";
+        return false;
+    }
+
+    int opt = 1;
+    setsockopt(descriptor, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+
+    sockaddr_in direccion;
+    std::memset(&direccion, 0, sizeof(direccion));
+    direccion.sin_family = AF_INET;
+    direccion.sin_port = htons(puerto);
+    if (inet_pton(AF_INET, direccionIP.c_str(), &direccion.sin_addr) <= 0) {
+        std::cerr << "Error al convertir la dirección IP: " << direccionIP << std::endl;
+        return false;
+    }
+    if (bind(descriptor, (sockaddr*)&direccion, sizeof(direccion)) == -1 || listen(descriptor, SOMAXCONN) == -1) {
+        std::cerr << "Error al abrir la puerta de entrada en el puerto " << puerto << ".\n";
+        return false;
+    }
+    std::cout << "Puerta de entrada en el puerto " << puerto << ".\n";
+    return true;
+}
+
+// Aceptar, responder con la redirección y cerrar: la conexión dura una sola escritura.
+// Sin descriptores o memoria libres se espera antes de reintentar, y se avisa una sola vez por racha.
+void EnrutadorConexiones::atender() {
+    bool sinRecursos = false;
+    while (true) {
+        int cliente = accept4(descriptor, nullptr, nullptr, SOCK_CLOEXEC);
+        if (cliente == -1) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            if (errno == EMFILE || errno == ENFILE || errno == ENOBUFS || errno == ENOMEM) {
+                if (!sinRecursos) {
+                    std::cerr << "Sin recursos para aceptar en la puerta de entrada; se reintenta en "
+                              << ESPERA_SIN_RECURSOS.count() << " ms.\n";
+                    sinRecursos = true;
+                }
+                std::this_thread::sleep_for(ESPERA_SIN_RECURSOS);
+                continue;
+            }
+            std::cerr << "Error al aceptar una conexión en la puerta de entrada; se deja de atender.\n";
+            return;
+        }
+        sinRecursos = false;
+
+        bool aCiegas = false;
+        int puerto = elegirServidor(aCiegas);
+        std::string respuesta = puerto != -1
+                                    ? PREFIJO_REDIRECCION + direccionIP + " " + std::to_string(puerto) + "\n"
+                                    : std::string("No hay servidores disponibles. Intente más tarde.\n");
+        send(cliente, respuesta.data(), respuesta.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+        close(cliente);
+
+        std::lock_guard<std::mutex> lock(mutexEstadisticas);
+        if (puerto == -1) {
+            estadisticas.rechazadas++;
+            continue;
+        }
+        estadisticas.redirigidas++;
+        estadisticas.porPuerto[puerto]++;
+        if (aCiegas) {
+            estadisticas.sinTelemetria++;
+        }
+    }
+}
+
+// El servidor activo con telemetría fresca y menos carga; a igual carga, el de menos mensajes por segundo
+int EnrutadorConexiones::elegirServidor(bool& aCiegas) {
+    std::vector<int> activos = supervisor.obtenerPuertosActivos();
+    if (activos.empty()) {
+        return -1;
+    }
+
+    std::int64_t limite = (std::chrono::steady_clock::now() - frescura).time_since_epoch().count();
+    int elegido = -1;
+    std::uint64_t menorCarga = 0;
+    std::uint64_t menorTasa = 0;
+    for (std::size_t i = 0; i < agregador.numeroServidores(); ++i) {
+        const SerieServidor& serie = agregador.serie(i);
+        int puerto = serie.obtenerPuerto();
+        PaqueteTelemetria paquete;
+        std::int64_t recibido = 0;
+        if (std::find(activos.begin(), activos.end(), puerto) == activos.end() ||
+            !serie.ultimoPaquete(paquete, recibido) || recibido < limite) {
+            continue;
+        }
+
+        // Un paquete nuevo ya cuenta a los clientes redirigidos antes de él
+        CargaServidor& carga = cargas[puerto];
+        if (carga.idInstancia != paquete.idInstancia || carga.secuencia != paquete.secuencia) {
+            carga.idInstancia = paquete.idInstancia;
+            carga.secuencia = paquete.secuencia;
+            carga.asignados = 0;
+        }
+        std::uint64_t total = paquete.usuariosConectados + carga.asignados;
+        std::uint64_t tasa = paquete.tasaMensajesMilis[0];
+        if (elegido == -1 || total < menorCarga || (total == menorCarga && tasa < menorTasa)) {
+            elegido = puerto;
+            menorCarga = total;
+            menorTasa = tasa;
+        }
+    }
+
+    if (elegido != -1) {
+        cargas[elegido].asignados++;
+        aCiegas = false;
+        return elegido;
+    }
+    aCiegas = true;
+    return activos[siguienteRotativo++ % activos.size()];
+}
+
+EstadisticasEnrutador EnrutadorConexiones::obtenerEstadisticas() const {
+    std::lock_guard<std::mutex> lock(mutexEstadisticas);
+    return estadisticas;
+}
+
+// Resumen de una línea para mostrar junto a la información de los servidores
+std::string EnrutadorConexiones::obtenerResumen() const {
+    EstadisticasEnrutador datos = obtenerEstadisticas();
+    std::ostringstream resumen;
+    resumen << "Puerta de entrada: " << datos.redirigidas << " redirigidas (" << datos.sinTelemetria << " sin telemetría), "
+            << datos.rechazadas << " rechazadas; reparto:";
+    for (const auto& par : datos.porPuerto) {
+        resumen << " " << par.first << "=" << par.second;
+    }
+    return resumen.str();
+}
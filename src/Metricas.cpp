@@ -0,0 +1,146 @@
+#include "Metricas.h"
+#include <algorithm>
+#include <cstring>
+
+static std::atomic<std::size_t> siguienteFragmento(0);
+
+std::size_t fragmentoDelHilo() {
+    static thread_local std::size_t fragmento =
+        siguienteFragmento.fetch_add(1, std::memory_order_relaxed) % FRAGMENTOS_METRICAS;
+    return fragmento;
+}
+
+ContadorFragmentado::ContadorFragmentado() {
+    for (auto& fragmento : fragmentos) {
+        fragmento.valor.store(0, std::memory_order_relaxed);
+    }
+}
+
+std::uint64_t ContadorFragmentado::leer() const {
+    std::uint64_t total = 0;
+    for (const auto& fragmento : fragmentos) {
+        total += fragmento.valor.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+InstantaneaHistograma::InstantaneaHistograma() {
+    std::memset(cubetas, 0, sizeof(cubetas));
+}
+
+std::uint64_t InstantaneaHistograma::total() const {
+    std::uint64_t suma = 0;
+    for (std::size_t i = 0; i < CUBETAS_HISTOGRAMA; ++i) {
+        suma += cubetas[i];
+    }
+    return suma;
+}
+
+std::uint64_t InstantaneaHistograma::percentil(double fraccion) const {
+    std::uint64_t cuenta = total();
+    if (cuenta == 0) {
+        return 0;
+    }
+    std::uint64_t objetivo = static_cast<std::uint64_t>(fraccion * cuenta);
+    std::uint64_t acumulado = 0;
+    for (std::size_t i = 0; i < CUBETAS_HISTOGRAMA; ++i) {
+        acumulado += cubetas[i];
+        if (acumulado > objetivo) {
+            return limiteSuperior(i) - 1;
+        }
+    }
+    return limiteSuperior(CUBETAS_HISTOGRAMA - 1) - 1;
+}
+
+void InstantaneaHistograma::restar(const InstantaneaHistograma& anterior) {
+    for (std::size_t i = 0; i < CUBETAS_HISTOGRAMA; ++i) {
+        cubetas[i] -= std::min(cubetas[i], anterior.cubetas[i]);
+    }
+}
+
+// Valores menores que 8 tienen cubeta propia; desde ahí, 8 cubetas por potencia de dos
+std::size_t InstantaneaHistograma::cubetaDe(std::uint64_t valor) {
+    if (valor < SUBCUBETAS_HISTOGRAMA) {
+        return static_cast<std::size_t>(valor);
+    }
+    std::size_t exponente = 63 - __builtin_clzll(valor);
+    std::size_t sub = static_cast<std::size_t>(valor >> (exponente - 3)) - SUBCUBETAS_HISTOGRAMA;
+    std::size_t cubeta = (exponente - 2) * SUBCUBETAS_HISTOGRAMA + sub;
+    return std::min(cubeta, CUBETAS_HISTOGRAMA - 1);
+}
+
+std::uint64_t InstantaneaHistograma::limiteInferior(std::size_t cubeta) {
+    if (cubeta < SUBCUBETAS_HISTOGRAMA) {
+        return cubeta;
+    }
+    std::size_t exponente = cubeta / SUBCUBETAS_HISTOGRAMA + 2;
+    std::uint64_t sub = cubeta % SUBCUBETAS_HISTOGRAMA;
+    return (SUBCUBETAS_HISTOGRAMA + sub) << (exponente - 3);
+}
+
+std::uint64_t InstantaneaHistograma::limiteSuperior(std::size_t cubeta) {
+    if (cubeta < SUBCUBETAS_HISTOGRAMA) {
+        return cubeta + 1;
+    }
+    std::size_t exponente = cubeta / SUBCUBETAS_HISTOGRAMA + 2;
+    std::uint64_t sub = cubeta % SUBCUBETAS_HISTOGRAMA;
+    return (SUBCUBETAS_HISTOGRAMA + sub + 1) << (exponente - 3);
+}
+
+HistogramaLog::HistogramaLog() : fragmentos(new Fragmento[FRAGMENTOS_METRICAS]) {
+    for (std::size_t f = 0; f < FRAGMENTOS_METRICAS; ++f) {
+        for (auto& cubeta : fragmentos[f].cubetas) {
+            cubeta.store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+void HistogramaLog::combinar(InstantaneaHistograma& destino) const {
+    std::memset(destino.cubetas, 0, sizeof(destino.cubetas));
+    for (std::size_t f = 0; f < FRAGMENTOS_METRICAS; ++f) {
+        for (std::size_t i = 0; i < CUBETAS_HISTOGRAMA; ++i) {
+            destino.cubetas[i] += fragmentos[f].cubetas[i].load(std::memory_order_relaxed);
+        }
+    }
+}
+
+SerieTasa::SerieTasa(std::size_t capacidad) : muestras(capacidad), siguiente(0), cantidad(0) {}
+
+void SerieTasa::muestrear(double instanteSegundos, std::uint64_t valor) {
+    muestras[siguiente].instante = instanteSegundos;
+    muestras[siguiente].valor = valor;
+    siguiente = (siguiente + 1) % muestras.size();
+    cantidad = std::min(cantidad + 1, muestras.size());
+}
+
+// Comparar la última muestra con la más reciente que quede fuera de la ventana
+double SerieTasa::tasa(double ventanaSegundos) const {
+    if (cantidad < 2) {
+        return 0.0;
+    }
+    const Muestra& ultima = muestras[(siguiente + muestras.size() - 1) % muestras.size()];
+    const Muestra* inicio = nullptr;
+    for (std::size_t atras = 2; atras <= cantidad; ++atras) {
+        inicio = &muestras[(siguiente + muestras.size() - atras) % muestras.size()];
+        if (ultima.instante - inicio->instante >= ventanaSegundos) {
+            break;
+        }
+    }
+    double duracion = ultima.instante - inicio->instante;
+    return duracion > 0 ? (ultima.valor - inicio->valor) / duracion : 0.0;
+}
+
+VentanaHistograma::VentanaHistograma(std::size_t capacidad) : instantaneas(capacidad), siguiente(0), cantidad(0) {}
+
+void VentanaHistograma::muestrear(const InstantaneaHistograma& acumulado) {
+    instantaneas[siguiente] = acumulado;
+    siguiente = (siguiente + 1) % instantaneas.size();
+    cantidad = std::min(cantidad + 1, instantaneas.size());
+}
+
+void VentanaHistograma::ventana(const InstantaneaHistograma& acumulado, InstantaneaHistograma& destino) const {
+    destino = acumulado;
+    if (cantidad > 0) {
+        destino.restar(instantaneas[(siguiente + instantaneas.size() - cantidad) % instantaneas.size()]);
+    }
+}
@@ -1,4 +1,9 @@
 #include "MonitorServidores.h"
+#include "SupervisorProcesos.h"
+#include "Telemetria.h"
+#include "AgregadorTelemetria.h"
+#include "TelemetriaCompartida.h"
+#include "EnrutadorConexiones.h"
 #include <iostream>
 #include <thread>
 #include <vector>
@@ -14,208 +19,354 @@
 #include <memory>
 #include <cstring>
 #include <sstream>
-#include <queue>
-#include <mutex>
+#include <iomanip>
 
-// Cola para almacenar mensajes y mutex para sincronización
-std::queue<std::string> message_queue;
-std::mutex queue_mutex;
+// Definir los códigos de escape para diferentes colores
+#define RESET   "\033[0m"
+#define GREEN   "\033[32m"      /* Green */
 
-std::vector<std::shared_ptr<std::atomic<bool>>> server_active;
+// Ventana de los agregados que se muestran
+static const std::chrono::seconds VENTANA_AGREGADOS(60);
 
 // Especifica la dirección IP que deseas usar
 const char* ip_address = "172.18.76.218"; // Cambia esta IP según tus necesidades
 
-// Comprueba si el puerto está disponible
-bool is_port_available(int port) {
-    int sockfd = socket(AF_INET, SOCK_STREAM, 0);
-    if (sockfd < 0) {
-        std::cerr << "Error al crear un socket temporal para verificar el puerto.\n";
-        return false;
-    }
-
-    sockaddr_in address;
-    address.sin_family = AF_INET;
-    address.sin_port = htons(port);
-
-    // Reemplaza INADDR_ANY con la IP específica
-    if (inet_pton(AF_INET, ip_address, &address.sin_addr) <= 0) {
-        std::cerr << "Error al convertir la dirección IP: " << ip_address << std::endl;
-        close(sockfd);
-        return false;
-    }
-
-    bool available = (bind(sockfd, (sockaddr*)&address, sizeof(address)) == 0);
-    close(sockfd);
-    return available;
+// Formatea p50/p99/p999 con su unidad
+static std::string formatearPercentiles(const std::uint64_t* percentiles, const std::string& unidad) {
+    return "p50 " + std::to_string(percentiles[0]) + " " + unidad + ", p99 " + std::to_string(percentiles[1]) + " " + unidad +
+           ", p999 " + std::to_string(percentiles[2]) + " " + unidad;
 }
 
-// Inicia un servidor en el puerto especificado
-void start_server(int server_id, int port, std::shared_ptr<std::atomic<bool>> server_active) {
-    std::cout << "Iniciando hilo para Servidor " << server_id << " en el puerto " << port << std::endl;
-
-    std::string command = "./build/chat servidor " + std::to_string(port);
-
-    // Verificar si el archivo existe antes de ejecutar el comando
-    if (access("./build/chat", F_OK) == -1) {
-        std::cerr << "El archivo ./build/chat no existe o no es accesible." << std::endl;
-        return;
-    }
-
-    while (true) {
-        if (*server_active) {
-            if (is_port_available(port)) {
-                std::cout << "Iniciando Servidor " << server_id << " en puerto " << port << std::endl;
-                int result = std::system(command.c_str());
-                if (result != 0) {
-                    std::cerr << "Servidor " << server_id << " se ha detenido con error " << result << " (código de salida: " << WEXITSTATUS(result) << ")" << std::endl;
-                    *server_active = false;
-
-                    // Intentar de nuevo después de un breve retraso
-                    std::this_thread::sleep_for(std::chrono::seconds(5));
-                }
-            } else {
-                std::cerr << "El puerto " << port << " no está disponible. Intentando nuevamente en 5 segundos...\n";
-                std::this_thread::sleep_for(std::chrono::seconds(5));
-            }
-        } else {
-            // Esperar un poco antes de volver a verificar si se debe reiniciar
-            std::this_thread::sleep_for(std::chrono::seconds(1));
+// Convierte un paquete de telemetría en las líneas que se muestran
+std::vector<std::string> renderizarTelemetria(const PaqueteTelemetria& paquete) {
+    std::vector<std::string> lineas;
+    double actividad = paquete.tiempoActividadNs / 1e9;
+
+    lineas.push_back(GREEN "Servidor en el puerto: " + std::to_string(paquete.puerto) + RESET);
+    lineas.push_back("Número de usuarios conectados: " + std::to_string(paquete.usuariosConectados));
+    lineas.push_back("Tasa de uso: " + std::to_string(paquete.tasaMensajesMilis[0] / 1000.0) + " (1 s), " +
+                     std::to_string(paquete.tasaMensajesMilis[1] / 1000.0) + " (1 min), " +
+                     std::to_string(paquete.tasaMensajesMilis[2] / 1000.0) + " (5 min) mensajes/segundo");
+    lineas.push_back("Promedio de mensajes: " + std::to_string(actividad > 0 ? paquete.totalMensajes / actividad : 0.0) +
+                     " mensajes/segundo");
+    lineas.push_back("Tiempo promedio entre mensajes: " + std::to_string(paquete.tiempoSinMensajesUs / 1e6) + " segundos");
+    lineas.push_back("Intervalo entre mensajes (último minuto): " + formatearPercentiles(paquete.percentilesIntervaloUs, "µs"));
+    lineas.push_back("Procesamiento de mensajes (último minuto): " + formatearPercentiles(paquete.percentilesProcesamientoNs, "ns"));
+    lineas.push_back("Tiempo de actividad: " + std::to_string(actividad) + " segundos");
+
+    std::string modo = "Modo de E/S: ";
+    if (paquete.modo == MODO_TELEMETRIA_EPOLL) {
+        modo += "epoll (" + std::to_string(paquete.hilosIO) + " hilos)";
+    } else if (paquete.modo == MODO_TELEMETRIA_REUSEPORT || paquete.modo == MODO_TELEMETRIA_URING) {
+        modo += paquete.modo == MODO_TELEMETRIA_URING ? "io_uring (" : "reuseport (";
+        modo += std::to_string(paquete.hilosIO) + " reactores; conexiones:";
+        for (std::uint32_t i = 0; i < paquete.numeroReactores && i < MAX_REACTORES_TELEMETRIA; ++i) {
+            modo += " " + std::to_string(paquete.conexionesReactor[i]);
         }
+        modo += ")";
+    } else {
+        modo += "un hilo por cliente";
+    }
+    lineas.push_back(modo);
+
+    double conexionesPorGB = paquete.memoriaResidenteKB > 0
+                                 ? paquete.usuariosConectados / (paquete.memoriaResidenteKB / (1024.0 * 1024.0))
+                                 : 0.0;
+    lineas.push_back("Memoria residente: " + std::to_string(paquete.memoriaResidenteKB) + " KB (" +
+                     std::to_string(conexionesPorGB) + " conexiones/GB)");
+    lineas.push_back("Colas de salida: " + std::to_string(paquete.bytesPendientes) + " bytes pendientes, profundidad máxima " +
+                     std::to_string(paquete.profundidadMaxima) + " bytes, " + std::to_string(paquete.clientesExpulsados) +
+                     " clientes lentos expulsados");
+    double tramasPorLectura = paquete.lecturasTramas > 0 ? static_cast<double>(paquete.tramasRecibidas) / paquete.lecturasTramas : 0.0;
+    lineas.push_back("Tramas recibidas: " + std::to_string(paquete.tramasRecibidas) + " en " +
+                     std::to_string(paquete.lecturasTramas) + " lecturas (" + std::to_string(tramasPorLectura) + " por lectura)");
+
+    lineas.push_back("Canales: " + std::to_string(paquete.numeroCanales) +
+                     (paquete.numeroCanales > paquete.canalesEnviados
+                          ? " (los " + std::to_string(paquete.canalesEnviados) + " con más miembros)" : ""));
+    for (std::uint32_t i = 0; i < paquete.canalesEnviados && i < MAX_CANALES_TELEMETRIA; ++i) {
+        const CanalTelemetria& canal = paquete.canales[i];
+        std::string nombre(canal.nombre, strnlen(canal.nombre, LONGITUD_NOMBRE_CANAL_TELEMETRIA));
+        double entregasPorMensaje = canal.mensajes > 0 ? static_cast<double>(canal.entregas) / canal.mensajes : 0.0;
+        lineas.push_back("  #" + nombre + ": " + std::to_string(canal.miembros) + " miembros, " +
+                         std::to_string(canal.mensajes) + " mensajes, " + std::to_string(canal.entregas) + " entregas (" +
+                         std::to_string(entregasPorMensaje) + " por mensaje)");
     }
 
-    std::cout << "Hilo para Servidor " << server_id << " terminado" << std::endl;
-}
+    double entregasPorEnvio = paquete.llamadasEnvio > 0 ? static_cast<double>(paquete.entregasSalida) / paquete.llamadasEnvio : 0.0;
+    lineas.push_back("Envíos: " + std::to_string(paquete.entregasSalida) + " entregas en " +
+                     std::to_string(paquete.llamadasEnvio) + " llamadas (" + std::to_string(entregasPorEnvio) +
+                     " por llamada)");
+    if (paquete.ventanaAgrupadoUs > 0) {
+        lineas.push_back("Agrupado: ventana de " + std::to_string(paquete.ventanaAgrupadoUs) + " µs, umbral de " +
+                         std::to_string(paquete.umbralAgrupadoBytes) + " bytes; " +
+                         std::to_string(paquete.vaciadosVentana) + " colas al vencer la ventana, " +
+                         std::to_string(paquete.vaciadosUmbral) + " por umbral; espera añadida " +
+                         formatearPercentiles(paquete.percentilesEsperaAgrupadoUs, "µs"));
+    }
+    if (paquete.plazoSaludoS > 0 || paquete.plazoInactividadS > 0) {
+        auto plazo = [](std::uint32_t segundos) { return segundos > 0 ? std::to_string(segundos) + " s" : std::string("no"); };
+        lineas.push_back("Plazos: saludo " + plazo(paquete.plazoSaludoS) + ", inactividad " +
+                         plazo(paquete.plazoInactividadS) + "; vencidas " + std::to_string(paquete.vencidasSaludo) +
+                         " sin nombre y " + std::to_string(paquete.vencidasInactividad) + " inactivas");
+    }
 
-// Monitorea los servidores y los reinicia si es necesario
-void monitor_servers() {
-    while (true) {
-        for (size_t i = 0; i < server_active.size(); ++i) {
-            std::cout << "Monitoreando servidor " << i + 1 << std::endl;
-            if (!*server_active[i]) {
-                std::cout << "Reiniciando Servidor " << i + 1 << "...\n";
-                *server_active[i] = true;
-            }
-        }
-        std::this_thread::sleep_for(std::chrono::seconds(5)); // Monitoreo cada 5 segundos
+    if (paquete.paresFederacion > 0) {
+        double mensajesPorLote = paquete.federacionLotes > 0
+                                     ? static_cast<double>(paquete.federacionEnviados) / paquete.federacionLotes : 0.0;
+        lineas.push_back("Federación: " + std::to_string(paquete.paresConectados) + " de " +
+                         std::to_string(paquete.paresFederacion) + " pares conectados, " +
+                         std::to_string(paquete.federacionPublicados) + " publicados, " +
+                         std::to_string(paquete.federacionEnviados) + " enviados en " +
+                         std::to_string(paquete.federacionLotes) + " lotes (" + std::to_string(mensajesPorLote) +
+                         " por lote), " + std::to_string(paquete.federacionAplicados) + " recibidos, " +
+                         std::to_string(paquete.federacionDuplicados) + " duplicados, " +
+                         std::to_string(paquete.federacionHuecos) + " perdidos");
     }
+    return lineas;
 }
 
-// Recibe mensajes de los servidores y los almacena en la cola
-void recibirInformacionServidor() {
-    int descriptorMonitor = socket(AF_INET, SOCK_DGRAM, 0);
-    if (descriptorMonitor == -1) {
-        std::cerr << "Error al crear el socket para recibir.\n";
+// Recibe los paquetes de telemetría de los servidores y los agrega en sus series
+void recibirInformacionServidor(AgregadorTelemetria& agregador) {
+    if (!agregador.abrir(ip_address, PUERTO_TELEMETRIA)) {
         return;
     }
+    agregador.ingerir();
+}
 
-    sockaddr_in direccionMonitor;
-    direccionMonitor.sin_family = AF_INET;
-    direccionMonitor.sin_port = htons(55555); // Puerto para recibir los datos
+// Lee la telemetría que los servidores publican en el segmento compartido
+void leerTelemetriaCompartida(AgregadorTelemetria& agregador, const SegmentoTelemetria& segmento, long intervaloMuestrasMs) {
+    agregador.leerCompartida(segmento, std::chrono::milliseconds(intervaloMuestrasMs));
+}
 
-    // Reemplaza INADDR_ANY con la IP específica
-    if (inet_pton(AF_INET, ip_address, &direccionMonitor.sin_addr) <= 0) {
-        std::cerr << "Error al convertir la dirección IP: " << ip_address << std::endl;
-        close(descriptorMonitor);
-        return;
-    }
+// Formatea el agregado de una métrica en la ventana
+static std::string formatearResumen(const char* nombre, const ResumenMetrica& resumen, double escala, const char* unidad) {
+    std::ostringstream linea;
+    linea << std::fixed << std::setprecision(1) << "  " << nombre << ": mín " << resumen.minimo / escala << ", prom "
+          << resumen.promedio / escala << ", máx " << resumen.maximo / escala << ", p50 " << resumen.p50 / escala << ", p99 "
+          << resumen.p99 / escala << " " << unidad;
+    return linea.str();
+}
 
-    if (bind(descriptorMonitor, (sockaddr*)&direccionMonitor, sizeof(direccionMonitor)) == -1) {
-        std::cerr << "Error al hacer bind del socket del monitor.\n";
-        close(descriptorMonitor);
-        return;
+// Muestra el último paquete de cada servidor y los agregados de su último minuto; es una tarea
+// periódica del supervisor
+void mostrarInformacionServidor(const SupervisorProcesos& supervisor, const AgregadorTelemetria& agregador,
+                                const EnrutadorConexiones* enrutador) {
+    std::int64_t ahora = std::chrono::steady_clock::now().time_since_epoch().count();
+    std::int64_t desde = ahora - std::chrono::duration_cast<std::chrono::nanoseconds>(VENTANA_AGREGADOS).count();
+
+    std::ostringstream salida;
+    salida << supervisor.obtenerResumen() << "\n";
+    if (enrutador) {
+        salida << enrutador->obtenerResumen() << "\n";
     }
 
-    char buffer[1024];
-    sockaddr_in emisorDireccion;
-    socklen_t emisorTamano = sizeof(emisorDireccion);
-
-    while (true) {
-        memset(buffer, 0, sizeof(buffer));
-        ssize_t bytesRecibidos = recvfrom(descriptorMonitor, buffer, 1024, 0, (sockaddr*)&emisorDireccion, &emisorTamano);
-        if (bytesRecibidos > 0) {
-            // Null-terminar el buffer recibido
-            buffer[bytesRecibidos] = '\0';
-
-            // Convertir el buffer a std::string
-            std::string received_data(buffer);
-
-            // Separar el string en un array de strings
-            std::vector<std::string> messages;
-            std::istringstream stream(received_data);
-            std::string token;
-            while (std::getline(stream, token, '\n')) {  // Usa el delimitador '\n'
-                if (!token.empty()) {
-                    std::lock_guard<std::mutex> lock(queue_mutex);
-                    message_queue.push(token);
-                }
-            }
-        }
+    EstadisticasIngesta ingesta = agregador.obtenerEstadisticas();
+    if (ingesta.memoriaCompartida) {
+        salida << "Ingesta (memoria compartida): " << ingesta.paquetes << " paquetes nuevos, " << ingesta.reintentosLectura
+               << " relecturas por escrituras en curso, " << ingesta.sinCapacidad << " sin capacidad\n";
+    } else {
+        salida << std::fixed << std::setprecision(1) << "Ingesta: " << ingesta.paquetes << " paquetes en " << ingesta.lotes
+               << " lotes, " << ingesta.perdidos << " perdidos, " << ingesta.perdidosNucleo << " descartados por el núcleo, "
+               << ingesta.descartados << " inválidos, " << ingesta.sinCapacidad << " sin capacidad; retraso prom "
+               << ingesta.retrasoPromedioUs << " µs, máx " << ingesta.retrasoMaximoUs << " µs\n";
     }
-    close(descriptorMonitor);
-}
 
-// Muestra la información almacenada en la cola cada 7 segundos
-void mostrarInformacionServidor() {
-    while (true) {
-        std::this_thread::sleep_for(std::chrono::seconds(7));
-        std::lock_guard<std::mutex> lock(queue_mutex);
-
-        while (!message_queue.empty()) {
-            std::cout << message_queue.front() << std::endl;
-            message_queue.pop();
+    for (std::size_t i = 0; i < agregador.numeroServidores(); ++i) {
+        const SerieServidor& serie = agregador.serie(i);
+        PaqueteTelemetria paquete;
+        std::int64_t recibido;
+        if (!serie.ultimoPaquete(paquete, recibido)) {
+            continue;
+        }
+        for (const auto& linea : renderizarTelemetria(paquete)) {
+            salida << linea << "\n";
         }
+
+        double antiguedad = (ahora - recibido) / 1e9;
+        ResumenMetrica resumenes[NUMERO_METRICAS];
+        serie.resumir(desde, resumenes);
+        salida << "Último minuto (" << resumenes[METRICA_USUARIOS].muestras << " muestras, la última hace "
+               << antiguedad << " s, " << serie.obtenerPerdidos() << " perdidas):\n";
+        salida << formatearResumen("Usuarios", resumenes[METRICA_USUARIOS], 1, "") << "\n";
+        salida << formatearResumen("Tasa", resumenes[METRICA_TASA], 1, "mensajes/segundo") << "\n";
+        salida << formatearResumen("Colas de salida", resumenes[METRICA_COLAS], 1024, "KB") << "\n";
+        salida << formatearResumen("Memoria", resumenes[METRICA_MEMORIA], 1024, "MB") << "\n";
+        salida << formatearResumen("Procesamiento p99", resumenes[METRICA_PROCESAMIENTO], 1000, "µs") << "\n";
     }
+    std::cout << salida.str() << std::flush;
 }
 
 // Función principal
 int main(int argc, char* argv[]) {
-    if (argc < 3 || (argc - 1) % 2 != 0) {
-        std::cerr << "Uso: " << argv[0] << " <num_servidores> <puerto1> ... <puertoN>\n";
+    if (argc < 3) {
+        std::cerr << "Uso: " << argv[0] << " <num_servidores> <puerto1> ... <puertoN> [--retraso-inicial ms] [--retraso-maximo ms] [--tiempo-estable ms]"
+                     " [--modo hilos|epoll|reuseport|uring] [--intervalo-telemetria ms] [--muestras-por-servidor n] [--federacion 0|1]"
+                     " [--puerto-entrada puerto] [--frescura-telemetria ms] [--telemetria udp|compartida]"
+                     " [--historial-mensajes n] [--historial-segundos s]"
+                     " [--agrupado-us µs] [--agrupado-bytes bytes] [--plazo-saludo s] [--plazo-inactividad s]\n";
         return 1;
     }
 
     int num_servers = std::stoi(argv[1]);
-    if (num_servers <= 0 || argc != 2 + num_servers) {
+    if (num_servers <= 0 || argc < 2 + num_servers) {
         std::cerr << "Número de servidores inválido o número incorrecto de puertos.\n";
         return 1;
     }
 
     std::vector<int> ports;
-    for (int i = 2; i < argc; ++i) {
+    for (int i = 2; i < 2 + num_servers; ++i) {
         ports.push_back(std::stoi(argv[i]));
     }
 
-    server_active.resize(num_servers);
-
-    // Inicializar el vector de std::shared_ptr<std::atomic<bool>>
-    for (int i = 0; i < num_servers; ++i) {
-        server_active[i] = std::make_shared<std::atomic<bool>>(true);
+    // Opciones de la política de reinicio y de los servidores lanzados
+    ConfiguracionReinicio configuracion;
+    std::string modoServidores = "hilos";
+    std::string intervaloTelemetria = "5000";
+    std::size_t muestrasPorServidor = 600;
+    bool federacion = false;
+    int puertoEntrada = 0;
+    long frescuraTelemetria = 0;  // 0 = tres intervalos de telemetría
+    bool telemetriaCompartida = false;
+    std::string historialMensajes = "0";  // 0 = servidores sin bitácora ni historial
+    std::string historialSegundos = "0";
+    std::string agrupadoUs = "0";
+    std::string agrupadoBytes = "0";
+    std::string plazoSaludo = "30";
+    std::string plazoInactividad = "0";
+    for (int i = 2 + num_servers; i < argc; i += 2) {
+        std::string opcion = argv[i];
+        if (i + 1 >= argc) {
+            std::cerr << "Falta el valor de la opción " << opcion << "\n";
+            return 1;
+        }
+        std::string valor = argv[i + 1];
+        if (opcion == "--retraso-inicial") {
+            configuracion.retrasoInicial = std::chrono::milliseconds(std::stol(valor));
+        } else if (opcion == "--retraso-maximo") {
+            configuracion.retrasoMaximo = std::chrono::milliseconds(std::stol(valor));
+        } else if (opcion == "--tiempo-estable") {
+            configuracion.tiempoEstable = std::chrono::milliseconds(std::stol(valor));
+        } else if (opcion == "--modo") {
+            modoServidores = valor;
+        } else if (opcion == "--intervalo-telemetria") {
+            intervaloTelemetria = valor;
+        } else if (opcion == "--muestras-por-servidor") {
+            muestrasPorServidor = std::stoul(valor);
+        } else if (opcion == "--federacion") {
+            federacion = valor != "0";
+        } else if (opcion == "--puerto-entrada") {
+            puertoEntrada = std::stoi(valor);
+        } else if (opcion == "--frescura-telemetria") {
+            frescuraTelemetria = std::stol(valor);
+        } else if (opcion == "--telemetria") {
+            if (valor != "udp" && valor != "compartida") {
+                std::cerr << "Transporte de telemetría desconocido: " << valor << "\n";
+                return 1;
+            }
+            telemetriaCompartida = valor == "compartida";
+        } else if (opcion == "--historial-mensajes") {
+            historialMensajes = valor;
+        } else if (opcion == "--historial-segundos") {
+            historialSegundos = valor;
+        } else if (opcion == "--agrupado-us") {
+            agrupadoUs = valor;
+        } else if (opcion == "--agrupado-bytes") {
+            agrupadoBytes = valor;
+        } else if (opcion == "--plazo-saludo") {
+            plazoSaludo = valor;
+        } else if (opcion == "--plazo-inactividad") {
+            plazoInactividad = valor;
+        } else {
+            std::cerr << "Opción desconocida: " << opcion << "\n";
+            return 1;
+        }
     }
 
-    std::vector<std::thread> server_threads;
+    // Verificar si el archivo existe antes de lanzar los servidores
+    if (access("./build/chat", X_OK) == -1) {
+        std::cerr << "El archivo ./build/chat no existe o no es accesible." << std::endl;
+        return 1;
+    }
 
-    // Iniciar servidores en los puertos especificados usando lambda functions
-    for (int i = 0; i < num_servers; ++i) {
-        server_threads.emplace_back([i, &ports]() {
-            start_server(i + 1, ports[i], server_active[i]);
-        });
+    // SIGHUP reinicia en caliente los servidores: bloqueada en todos los hilos, la recibe el supervisor
+    sigset_t senales;
+    sigemptyset(&senales);
+    sigaddset(&senales, SIGHUP);
+    pthread_sigmask(SIG_BLOCK, &senales, nullptr);
+
+    // El segmento tiene que existir antes de lanzar los servidores: cada uno lo busca al arrancar.
+    // Sin él, un segmento que quedó de otro monitor haría que los servidores nuevos no usen UDP.
+    SegmentoTelemetria segmento;
+    if (telemetriaCompartida) {
+        if (!segmento.crear()) {
+            return 1;
+        }
+    } else {
+        SegmentoTelemetria::eliminar();
     }
 
-    // Iniciar monitoreo
-    std::thread monitor_thread(monitor_servers);
+    // Un solo hilo supervisa todos los servidores
+    SupervisorProcesos supervisor("./build/chat", ip_address, configuracion);
+    // Con federación cada servidor recibe todos los puertos (ignora el suyo) y forman un solo chat
+    std::string puertosFederacion;
+    for (int port : ports) {
+        puertosFederacion += (puertosFederacion.empty() ? "" : ",") + std::to_string(port);
+    }
+    // Los argumentos del servidor son posicionales: cada opción completa los anteriores
+    bool conPlazos = plazoSaludo != "30" || plazoInactividad != "0";
+    bool conHistorial = historialMensajes != "0" || historialSegundos != "0";
+    for (int port : ports) {
+        std::vector<std::string> argumentos = {"servidor", std::to_string(port), modoServidores, "0", intervaloTelemetria};
+        if (conHistorial || federacion || agrupadoUs != "0" || conPlazos) {
+            argumentos.insert(argumentos.end(), {historialMensajes, historialSegundos});
+        }
+        if (federacion || agrupadoUs != "0" || conPlazos) {
+            argumentos.push_back(federacion ? puertosFederacion : "0");
+        }
+        if (agrupadoUs != "0" || conPlazos) {
+            argumentos.insert(argumentos.end(), {agrupadoUs, agrupadoBytes});
+        }
+        if (conPlazos) {
+            argumentos.insert(argumentos.end(), {plazoSaludo, plazoInactividad});
+        }
+        supervisor.agregarServidor(port, argumentos);
+    }
 
     // Iniciar recepción de información de servidores y mostrar información
-    std::thread recibirHilo(recibirInformacionServidor);
-    std::thread mostrarHilo(mostrarInformacionServidor);
+    AgregadorTelemetria agregador(muestrasPorServidor);
+    std::thread recibirHilo = telemetriaCompartida
+                                  ? std::thread(leerTelemetriaCompartida, std::ref(agregador), std::cref(segmento),
+                                                std::stol(intervaloTelemetria))
+                                  : std::thread(recibirInformacionServidor, std::ref(agregador));
+
+    // Puerta de entrada opcional que reparte a los clientes entre los servidores
+    std::unique_ptr<EnrutadorConexiones> enrutador;
+    std::thread enrutadorHilo;
+    if (puertoEntrada > 0) {
+        // Con memoria compartida los servidores publican cada 100 ms: un segundo sin cambios ya es viejo
+        long frescuraPorDefecto = telemetriaCompartida ? 1000 : 3 * std::stol(intervaloTelemetria);
+        std::chrono::milliseconds frescura(frescuraTelemetria > 0 ? frescuraTelemetria : frescuraPorDefecto);
+        enrutador.reset(new EnrutadorConexiones(agregador, supervisor, ip_address, frescura));
+        if (!enrutador->abrir(puertoEntrada)) {
+            return 1;
+        }
+        enrutadorHilo = std::thread(&EnrutadorConexiones::atender, enrutador.get());
+    }
+
+    // La información se muestra cada 7 segundos desde el bucle del supervisor
+    const EnrutadorConexiones* puerta = enrutador.get();
+    supervisor.agregarTarea(std::chrono::seconds(7), [&supervisor, &agregador, puerta]() {
+        mostrarInformacionServidor(supervisor, agregador, puerta);
+    });
+    std::thread supervisorHilo(&SupervisorProcesos::ejecutar, &supervisor);
 
     // Esperar a que los hilos terminen
-    for (auto& t : server_threads) {
-        t.join();
-    }
-    monitor_thread.join();
+    supervisorHilo.join();
     recibirHilo.join();
-    mostrarHilo.join();
+    if (enrutadorHilo.joinable()) {
+        enrutadorHilo.join();
+    }
 
     return 0;
 }
@@ -0,0 +1,67 @@
+#include "Protocolo.h"
+#include <cstring>
+
+// Comprobar si la conexión empieza con el preámbulo del protocolo con tramas
+bool comienzaConPreambulo(const char* datos, std::size_t longitud) {
+    return longitud >= LONGITUD_PREAMBULO && std::memcmp(datos, PREAMBULO_TRAMAS, LONGITUD_PREAMBULO) == 0;
+}
+
+bool comienzaConPreambuloFederacion(const char* datos, std::size_t longitud) {
+    return longitud >= LONGITUD_PREAMBULO && std::memcmp(datos, PREAMBULO_FEDERACION, LONGITUD_PREAMBULO) == 0;
+}
+
+// Escribir los 5 bytes de cabecera (longitud big-endian y tipo)
+void escribirCabeceraTrama(char* destino, std::uint32_t longitud, std::uint8_t tipo) {
+    destino[0] = static_cast<char>((longitud >> 24) & 0xFF);
+    destino[1] = static_cast<char>((longitud >> 16) & 0xFF);
+    destino[2] = static_cast<char>((longitud >> 8) & 0xFF);
+    destino[3] = static_cast<char>(longitud & 0xFF);
+    destino[4] = static_cast<char>(tipo);
+}
+
+// Leer una trama al principio de los datos, apuntando la carga dentro del mismo buffer
+ResultadoTrama leerTrama(const char* datos, std::size_t longitud, Trama& trama, std::size_t& consumidos) {
+    if (longitud < TAMANO_CABECERA_TRAMA) {
+        return ResultadoTrama::INCOMPLETA;
+    }
+
+    const unsigned char* cabecera = reinterpret_cast<const unsigned char*>(datos);
+    std::uint32_t longitudCarga = (static_cast<std::uint32_t>(cabecera[0]) << 24) |
+                                  (static_cast<std::uint32_t>(cabecera[1]) << 16) |
+                                  (static_cast<std::uint32_t>(cabecera[2]) << 8) |
+                                  static_cast<std::uint32_t>(cabecera[3]);
+    if (longitudCarga > MAX_CARGA_TRAMA) {
+        return ResultadoTrama::INVALIDA;
+    }
+    if (longitud < TAMANO_CABECERA_TRAMA + longitudCarga) {
+        return ResultadoTrama::INCOMPLETA;
+    }
+
+    trama.tipo = cabecera[4];
+    trama.carga = datos + TAMANO_CABECERA_TRAMA;
+    trama.longitud = longitudCarga;
+    consumidos = TAMANO_CABECERA_TRAMA + longitudCarga;
+    return ResultadoTrama::COMPLETA;
+}
+
+// Construir una trama completa en un string (para el cliente)
+std::string construirTrama(const std::string& carga, std::uint8_t tipo) {
+    std::string trama(TAMANO_CABECERA_TRAMA, '\0');
+    escribirCabeceraTrama(&trama[0], static_cast<std::uint32_t>(carga.size()), tipo);
+    trama += carga;
+    return trama;
+}
+
+void escribirEntero(char* destino, std::uint64_t valor, std::size_t bytes) {
+    for (std::size_t i = 0; i < bytes; ++i) {
+        destino[i] = static_cast<char>((valor >> (8 * (bytes - 1 - i))) & 0xFF);
+    }
+}
+
+std::uint64_t leerEntero(const char* origen, std::size_t bytes) {
+    std::uint64_t valor = 0;
+    for (std::size_t i = 0; i < bytes; ++i) {
+        valor = (valor << 8) | static_cast<unsigned char>(origen[i]);
+    }
+    return valor;
+}
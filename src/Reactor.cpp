@@ -0,0 +1,959 @@
+#include "Reactor.h"
+#include "Conexion.h"
+#include "ServidorChat.h"
+#include <iostream>
+#include <algorithm>
+#include <thread>
+#include <chrono>
+#include <cerrno>
+#include <cstdint>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <sys/socket.h>
+
+// Número máximo de eventos atendidos por cada llamada a epoll_wait
+static const int MAX_EVENTOS = 256;
+
+// Conexiones aceptadas como máximo por cada aviso del socket de escucha
+static const int MAX_ACEPTADAS_POR_EVENTO = 64;
+
+// Lecturas por conexión en cada ronda, para que un cliente muy activo no acapare el reactor
+static const int MAX_LECTURAS_POR_RONDA = 32;
+
+// Difusiones del buzón tras las que se vacían las colas, para que un lote grande no las desborde
+static const int DIFUSIONES_POR_VACIADO = 32;
+
+// Marcas para distinguir en epoll el eventfd, el temporizador y el socket de escucha de las conexiones
+static char MARCA_EVENTO;
+static char MARCA_TEMPORIZADOR;
+static char MARCA_ESCUCHA;
+
+// Backend io_uring: entradas de la cola de envío y buffers provistos de cada grupo (potencias de dos).
+// En modo texto cada recepción es un mensaje: sus buffers tienen el tamaño del recv de epoll.
+static const unsigned ENTRADAS_URING = 1024;
+static const unsigned BUFFERS_TEXTO = 512;
+static const std::size_t TAMANO_BUFFER_TEXTO = 1024;
+static const unsigned BUFFERS_TRAMAS = 128;
+static const std::size_t TAMANO_BUFFER_TRAMAS = 16 * 1024;
+static const std::uint16_t GRUPO_TEXTO = 0;
+static const std::uint16_t GRUPO_TRAMAS = 1;
+
+// El dato de cada operación lleva el tipo en los 3 bits bajos y, si es de una conexión, su dirección
+static const std::uint64_t TIPO_EVENTO = 1;
+static const std::uint64_t TIPO_ACEPTAR = 2;
+static const std::uint64_t TIPO_RECIBIR = 3;
+static const std::uint64_t TIPO_ENVIAR = 4;
+static const std::uint64_t TIPO_CANCELAR = 5;
+static const std::uint64_t TIPO_TEMPORIZADOR = 6;
+static const std::uint64_t MASCARA_TIPO = 7;
+
+static thread_local Reactor* reactorActual = nullptr;
+
+// Constructor que asocia el reactor con el servidor
+Reactor::Reactor(ServidorChat& servidor, int id, bool soloEscritura)
+    : servidor(servidor), id(id), soloEscritura(soloEscritura), descriptorEpoll(-1), descriptorEvento(-1),
+      descriptorEscucha(-1), despertado(false), pausaPedida(false), pausado(false), numeroConexiones(0),
+      ventanaAgrupadoNs(0), plazoSaludoNs(0), plazoInactividadNs(0), descriptorTemporizador(-1), plazoProgramado(-1),
+      temporizadorVencido(false), conUring(false),
+      eventoArmado(false), temporizadorArmado(false), aceptacionArmada(false), drenando(false) {}
+
+void Reactor::asignarEscucha(int descriptorEscucha) {
+    this->descriptorEscucha = descriptorEscucha;
+}
+
+void Reactor::usarUring() {
+    conUring = true;
+}
+
+void Reactor::agregarTarea(std::chrono::milliseconds periodo, std::function<void()> accion) {
+    tareas.emplace_back();
+    Temporizador& tarea = tareas.back();
+    tarea.accion = std::move(accion);
+    std::int64_t ahora = std::chrono::steady_clock::now().time_since_epoch().count();
+    rueda.armarPeriodico(tarea, ahora, std::chrono::duration_cast<std::chrono::nanoseconds>(periodo).count());
+}
+
+// Crear la instancia epoll (o el anillo io_uring) y lanzar el hilo del bucle de eventos
+bool Reactor::iniciar(int nucleo) {
+    descriptorEvento = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (descriptorEvento == -1) {
+        std::cerr << "Error al crear el eventfd del reactor " << id << ".\n";
+        return false;
+    }
+    ventanaAgrupadoNs = std::chrono::duration_cast<std::chrono::nanoseconds>(servidor.ventanaAgrupado).count();
+    plazoSaludoNs = std::chrono::duration_cast<std::chrono::nanoseconds>(servidor.plazoSaludo).count();
+    plazoInactividadNs = std::chrono::duration_cast<std::chrono::nanoseconds>(servidor.plazoInactividad).count();
+    descriptorTemporizador = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (descriptorTemporizador == -1) {
+        std::cerr << "Error al crear el temporizador del reactor " << id << ".\n";
+        return false;
+    }
+    if (conUring ? !iniciarUring() : !iniciarEpoll()) {
+        return false;
+    }
+
+    std::thread hiloReactor(conUring ? &Reactor::bucleUring : &Reactor::bucleEventos, this);
+    if (nucleo >= 0) {
+        cpu_set_t nucleos;
+        CPU_ZERO(&nucleos);
+        CPU_SET(nucleo, &nucleos);
+        pthread_setaffinity_np(hiloReactor.native_handle(), sizeof(nucleos), &nucleos);
+    }
+    hiloReactor.detach();
+    return true;
+}
+
+bool Reactor::iniciarEpoll() {
+    descriptorEpoll = epoll_create1(EPOLL_CLOEXEC);
+    if (descriptorEpoll == -1) {
+        std::cerr << "Error al crear la instancia epoll del reactor " << id << ".\n";
+        return false;
+    }
+
+    epoll_event evento;
+    evento.events = EPOLLIN;
+    evento.data.ptr = &MARCA_EVENTO;
+    epoll_ctl(descriptorEpoll, EPOLL_CTL_ADD, descriptorEvento, &evento);
+    evento.events = EPOLLIN;
+    evento.data.ptr = &MARCA_TEMPORIZADOR;
+    epoll_ctl(descriptorEpoll, EPOLL_CTL_ADD, descriptorTemporizador, &evento);
+
+    // El socket de escucha va en modo nivel: se acepta por tandas sin perder avisos
+    if (descriptorEscucha != -1) {
+        evento.events = EPOLLIN;
+        evento.data.ptr = &MARCA_ESCUCHA;
+        if (epoll_ctl(descriptorEpoll, EPOLL_CTL_ADD, descriptorEscucha, &evento) == -1) {
+            std::cerr << "Error al registrar el socket de escucha en el reactor " << id << ".\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+Reactor* Reactor::delHiloActual() {
+    return reactorActual;
+}
+
+// Registrar una conexión en este reactor
+void Reactor::agregarConexion(const std::shared_ptr<Conexion>& conexion) {
+    Solicitud solicitud;
+    solicitud.tipo = TipoSolicitud::AGREGAR;
+    solicitud.conexion = conexion;
+    encolarSolicitud(solicitud);
+}
+
+// Pedir al reactor que vacíe la cola de salida de la conexión
+void Reactor::solicitarEscritura(const std::shared_ptr<Conexion>& conexion) {
+    // Desde el propio hilo basta con anotarla; se vacía al terminar la ronda de eventos
+    if (reactorActual == this) {
+        escriturasLocales.push_back(conexion);
+        return;
+    }
+    Solicitud solicitud;
+    solicitud.tipo = TipoSolicitud::ESCRIBIR;
+    solicitud.conexion = conexion;
+    encolarSolicitud(solicitud);
+}
+
+// Pedir al reactor que deje de atender la conexión
+void Reactor::quitarConexion(const std::shared_ptr<Conexion>& conexion) {
+    Solicitud solicitud;
+    solicitud.tipo = TipoSolicitud::QUITAR;
+    solicitud.conexion = conexion;
+    encolarSolicitud(solicitud);
+}
+
+// Dejar en el buzón un mensaje para las conexiones de este reactor
+void Reactor::publicarDifusion(const ReferenciaMensaje& mensaje, int descriptorRemitente) {
+    Solicitud solicitud;
+    solicitud.tipo = TipoSolicitud::DIFUNDIR;
+    solicitud.mensaje = mensaje;
+    solicitud.descriptorRemitente = descriptorRemitente;
+    encolarSolicitud(solicitud);
+}
+
+std::size_t Reactor::obtenerNumeroConexiones() const {
+    return numeroConexiones.load();
+}
+
+void Reactor::pausar() {
+    std::unique_lock<std::mutex> lock(mutexPausa);
+    pausaPedida = true;
+    Solicitud solicitud;
+    solicitud.tipo = TipoSolicitud::PAUSAR;
+    encolarSolicitud(solicitud);
+    cambioPausa.wait(lock, [this]() { return pausado; });
+}
+
+void Reactor::reanudar() {
+    std::lock_guard<std::mutex> lock(mutexPausa);
+    pausaPedida = false;
+    cambioPausa.notify_all();
+}
+
+std::vector<std::shared_ptr<Conexion>> Reactor::obtenerConexiones() {
+    // Otros reactores pudieron dejar difusiones en el buzón antes de detenerse
+    atenderSolicitudes();
+    std::vector<std::shared_ptr<Conexion>> lista;
+    lista.reserve(conexiones.size());
+    for (const auto& par : conexiones) {
+        lista.push_back(par.second);
+    }
+    return lista;
+}
+
+// Encolar el mensaje en cada conexión identificada de este reactor
+void Reactor::difundirLocal(const ReferenciaMensaje& mensaje, int descriptorRemitente) {
+    for (const auto& par : conexiones) {
+        const std::shared_ptr<Conexion>& conexion = par.second;
+        if (conexion->identificado && conexion->obtenerDescriptor() != descriptorRemitente) {
+            servidor.enviarA(conexion, mensaje);
+        }
+    }
+}
+
+// Guardar la solicitud y despertar al reactor una sola vez por ronda
+void Reactor::encolarSolicitud(Solicitud solicitud) {
+    {
+        std::lock_guard<std::mutex> lock(mutexSolicitudes);
+        solicitudes.push_back(std::move(solicitud));
+    }
+    if (!despertado.exchange(true)) {
+        std::uint64_t uno = 1;
+        ssize_t escrito = write(descriptorEvento, &uno, sizeof(uno));
+        (void)escrito;
+    }
+}
+
+// Atender las solicitudes de otros hilos (se llama solo desde el hilo del reactor)
+void Reactor::atenderSolicitudes() {
+    std::uint64_t valor;
+    ssize_t leido = read(descriptorEvento, &valor, sizeof(valor));
+    (void)leido;
+
+    std::vector<Solicitud> pendientes;
+    despertado.store(false);
+    {
+        std::lock_guard<std::mutex> lock(mutexSolicitudes);
+        pendientes.swap(solicitudes);
+    }
+
+    int difusiones = 0;
+    bool detenerse = false;
+    for (const auto& solicitud : pendientes) {
+        Conexion* conexion = solicitud.conexion.get();
+        switch (solicitud.tipo) {
+        case TipoSolicitud::AGREGAR:
+            registrarConexion(solicitud.conexion);
+            break;
+        case TipoSolicitud::ESCRIBIR:
+            if (conexiones.count(conexion)) {
+                despertarEscritura(solicitud.conexion);
+            }
+            break;
+        case TipoSolicitud::QUITAR:
+            if (conexiones.erase(conexion)) {
+                rueda.cancelar(conexion->plazo);
+                if (anillo) {
+                    cancelarOperaciones(conexion);
+                    auto operaciones = operacionesUring.find(conexion);
+                    if (operaciones != operacionesUring.end() && !operaciones->second.recibiendo &&
+                        !operaciones->second.enviando) {
+                        operacionesUring.erase(operaciones);
+                    }
+                } else {
+                    epoll_ctl(descriptorEpoll, EPOLL_CTL_DEL, conexion->obtenerDescriptor(), nullptr);
+                }
+                numeroConexiones--;
+            }
+            break;
+        case TipoSolicitud::DIFUNDIR:
+            difundirLocal(solicitud.mensaje, solicitud.descriptorRemitente);
+            if (++difusiones % DIFUSIONES_POR_VACIADO == 0) {
+                vaciarEscriturasLocales();
+            }
+            break;
+        case TipoSolicitud::PAUSAR:
+            detenerse = true;
+            break;
+        }
+    }
+
+    // Se detiene con el lote entero aplicado; lo que quede en las colas de salida lo recoge el traspaso
+    if (detenerse) {
+        vaciarEscriturasLocales();
+        if (anillo) {
+            detenerUring();
+        }
+        std::unique_lock<std::mutex> lock(mutexPausa);
+        pausado = true;
+        cambioPausa.notify_all();
+        cambioPausa.wait(lock, [this]() { return !pausaPedida; });
+        pausado = false;
+        if (anillo) {
+            reanudarUring();
+        }
+    }
+}
+
+// Dar de alta la conexión en epoll (o armar su recepción) y enviar lo que ya tenga encolado
+void Reactor::registrarConexion(const std::shared_ptr<Conexion>& conexion) {
+    if (ventanaAgrupadoNs > 0) {
+        conexion->establecerUmbralAgrupado(servidor.umbralAgrupado);
+    }
+    if (anillo) {
+        OperacionesUring& operaciones = operacionesUring[conexion.get()];
+        operaciones.conexion = conexion;
+        conexiones[conexion.get()] = conexion;
+        numeroConexiones++;
+        armarPlazo(conexion.get());
+        armarRecepcion(operaciones);
+        armarEnvio(operaciones);
+        return;
+    }
+
+    epoll_event evento;
+    evento.events = soloEscritura ? (EPOLLOUT | EPOLLET) : (EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET);
+    evento.data.ptr = conexion.get();
+    if (epoll_ctl(descriptorEpoll, EPOLL_CTL_ADD, conexion->obtenerDescriptor(), &evento) == -1) {
+        std::cerr << "Error al registrar la conexión en el reactor " << id << ".\n";
+        conexion->expulsar();
+        return;
+    }
+    conexiones[conexion.get()] = conexion;
+    numeroConexiones++;
+    armarPlazo(conexion.get());
+    escribirConexion(conexion.get());
+}
+
+// Aceptar las conexiones pendientes del socket de escucha propio
+void Reactor::aceptarConexiones() {
+    for (int i = 0; i < MAX_ACEPTADAS_POR_EVENTO; ++i) {
+        int descriptorCliente = accept4(descriptorEscucha, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (descriptorCliente == -1) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                std::cerr << "Error al aceptar la conexión de un cliente.\n";
+            }
+            return;
+        }
+
+        std::shared_ptr<Conexion> conexion = std::make_shared<Conexion>(descriptorCliente, this);
+        registrarConexion(conexion);
+        servidor.solicitarNombre(conexion);
+    }
+}
+
+// Vaciar las colas que el propio hilo despertó durante la ronda
+void Reactor::vaciarEscriturasLocales() {
+    while (!escriturasLocales.empty()) {
+        std::vector<std::shared_ptr<Conexion>> pendientes;
+        pendientes.swap(escriturasLocales);
+        for (const auto& conexion : pendientes) {
+            if (conexiones.count(conexion.get())) {
+                despertarEscritura(conexion);
+            }
+        }
+    }
+}
+
+// Un emisor despertó la cola: sin agrupado se vacía ya; con agrupado espera su ventana, salvo que
+// ya junte el umbral. Mientras espera, lo que se encole no vuelve a despertar al reactor.
+void Reactor::despertarEscritura(const std::shared_ptr<Conexion>& conexion) {
+    Conexion* destino = conexion.get();
+    if (ventanaAgrupadoNs == 0) {
+        escribirConexion(destino);
+        return;
+    }
+    std::int64_t ahora = std::chrono::steady_clock::now().time_since_epoch().count();
+    if (destino->alcanzoUmbralAgrupado()) {
+        if (destino->inicioAgrupado != 0) {
+            servidor.esperaAgrupado.registrar((ahora - destino->inicioAgrupado) / 1000);
+            destino->inicioAgrupado = 0;  // Su entrada en la lista queda sin efecto
+        }
+        servidor.vaciadosUmbral.sumar();
+        escribirConexion(destino);
+        return;
+    }
+    if (destino->inicioAgrupado != 0) {
+        return;  // Ya espera su ventana
+    }
+    destino->inicioAgrupado = ahora;
+    EnvioDiferido diferido;
+    diferido.conexion = conexion;
+    diferido.inicio = ahora;
+    diferidas.push_back(std::move(diferido));
+}
+
+// Al final de cada ronda: llevar el timerfd al plazo más cercano entre la primera diferida y la
+// rueda (steady_clock es CLOCK_MONOTONIC). Solo se toca si el plazo cambió.
+void Reactor::programarTemporizador() {
+    std::int64_t plazo = rueda.proximoVencimiento();
+    if (!diferidas.empty() && (plazo == -1 || diferidas.front().inicio + ventanaAgrupadoNs < plazo)) {
+        plazo = diferidas.front().inicio + ventanaAgrupadoNs;
+    }
+    if (plazo == plazoProgramado) {
+        return;
+    }
+    plazoProgramado = plazo;
+    itimerspec valor = itimerspec();
+    if (plazo != -1) {
+        valor.it_value.tv_sec = plazo / 1000000000;
+        valor.it_value.tv_nsec = std::max<std::int64_t>(1, plazo % 1000000000);
+    }
+    timerfd_settime(descriptorTemporizador, TFD_TIMER_ABSTIME, &valor, nullptr);
+}
+
+// Venció el temporizador: vaciar las diferidas cuyo plazo pasó y avanzar la rueda
+void Reactor::atenderTemporizador() {
+    std::uint64_t vencimientos;
+    ssize_t leido = read(descriptorTemporizador, &vencimientos, sizeof(vencimientos));
+    (void)leido;
+    plazoProgramado = -1;  // Ya pasó: se vuelve a programar al final de la ronda
+
+    std::int64_t ahora = std::chrono::steady_clock::now().time_since_epoch().count();
+    vaciarDiferidas(ahora);
+    rueda.avanzar(ahora);
+}
+
+// Vaciar las colas diferidas cuya ventana ya venció
+void Reactor::vaciarDiferidas(std::int64_t ahora) {
+    while (!diferidas.empty() && diferidas.front().inicio + ventanaAgrupadoNs <= ahora) {
+        EnvioDiferido diferido = std::move(diferidas.front());
+        diferidas.pop_front();
+        Conexion* destino = diferido.conexion.get();
+        if (destino->inicioAgrupado != diferido.inicio) {
+            continue;  // Ya salió por el umbral
+        }
+        destino->inicioAgrupado = 0;
+        servidor.esperaAgrupado.registrar((ahora - diferido.inicio) / 1000);
+        servidor.vaciadosVentana.sumar();
+        if (conexiones.count(destino)) {
+            escribirConexion(destino);
+        }
+    }
+}
+
+// Plazo que vigila la conexión: el del saludo hasta que se identifica y después el de inactividad.
+// Un enlace de la federación nunca se identifica como usuario y no tiene. 0 si no hay ninguno.
+std::int64_t Reactor::limitePlazo(const Conexion& conexion) const {
+    if (conexion.esPar) {
+        return 0;
+    }
+    if (!conexion.identificado) {
+        return plazoSaludoNs > 0 ? plazoSaludoNs : plazoInactividadNs;
+    }
+    return plazoInactividadNs;
+}
+
+// Armar el plazo de una conexión recién registrada. Se cuenta desde su último mensaje (o desde que
+// se conectó), así que recibir no toca la rueda: al vencer se mira si hubo mensajes y se rearma.
+void Reactor::armarPlazo(Conexion* conexion) {
+    std::int64_t limite = limitePlazo(*conexion);
+    conexion->plazo.accion = [this, conexion]() { vencerPlazo(conexion); };
+    if (limite > 0) {
+        rueda.armar(conexion->plazo, conexion->ultimoMensaje.load(std::memory_order_relaxed) + limite);
+    }
+}
+
+void Reactor::vencerPlazo(Conexion* conexion) {
+    std::int64_t limite = limitePlazo(*conexion);
+    if (limite == 0) {
+        return;  // Se identificó y no hay plazo de inactividad
+    }
+    std::int64_t plazo = conexion->ultimoMensaje.load(std::memory_order_relaxed) + limite;
+    if (plazo > std::chrono::steady_clock::now().time_since_epoch().count()) {
+        rueda.armar(conexion->plazo, plazo);
+        return;
+    }
+    // El lector verá el cierre y la dará de baja
+    if (conexion->expulsar()) {
+        (conexion->identificado ? servidor.vencidasInactividad : servidor.vencidasSaludo).sumar();
+    }
+}
+
+// Bucle principal: esperar eventos y atender cada conexión lista
+void Reactor::bucleEventos() {
+    reactorActual = this;
+    epoll_event eventos[MAX_EVENTOS];
+    while (true) {
+        // Si quedaron lecturas a medias no se bloquea: solo se recogen los eventos nuevos
+        int espera = lecturasPendientes.empty() ? -1 : 0;
+        int listos = epoll_wait(descriptorEpoll, eventos, MAX_EVENTOS, espera);
+        if (listos == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cerr << "Error en epoll_wait del reactor " << id << ".\n";
+            return;
+        }
+
+        // Continuar con las conexiones que agotaron su turno en la ronda anterior
+        std::vector<std::shared_ptr<Conexion>> continuar;
+        continuar.swap(lecturasPendientes);
+        for (const auto& conexion : continuar) {
+            if (conexiones.count(conexion.get()) && leerConexion(conexion)) {
+                lecturasPendientes.push_back(conexion);
+            }
+        }
+
+        bool haySolicitudes = false;
+        bool hayConexionesNuevas = false;
+        bool hayVencidas = false;
+        for (int i = 0; i < listos; ++i) {
+            void* marca = eventos[i].data.ptr;
+            if (marca == &MARCA_EVENTO) {
+                haySolicitudes = true;
+                continue;
+            }
+            if (marca == &MARCA_TEMPORIZADOR) {
+                hayVencidas = true;
+                continue;
+            }
+            if (marca == &MARCA_ESCUCHA) {
+                hayConexionesNuevas = true;
+                continue;
+            }
+
+            // Pudo cerrarse en esta misma ronda (al continuar una lectura): su evento ya no vale
+            auto it = conexiones.find(static_cast<Conexion*>(marca));
+            if (it == conexiones.end()) {
+                continue;
+            }
+            std::shared_ptr<Conexion> conexion = it->second;
+            if (!soloEscritura && (eventos[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))) {
+                if (leerConexion(conexion)) {
+                    lecturasPendientes.push_back(conexion);
+                }
+                if (!conexiones.count(conexion.get())) {
+                    continue;  // La conexión se cerró al leer
+                }
+            }
+            if (eventos[i].events & EPOLLOUT) {
+                escribirConexion(conexion.get());
+            }
+        }
+
+        // Las bajas se aplican después del lote para no invalidar punteros de eventos ya recibidos
+        if (haySolicitudes) {
+            atenderSolicitudes();
+        }
+        if (hayConexionesNuevas) {
+            aceptarConexiones();
+        }
+        if (hayVencidas) {
+            atenderTemporizador();
+        }
+        vaciarEscriturasLocales();
+        programarTemporizador();
+    }
+}
+
+// Leer hasta vaciar el socket (modo edge-triggered). En modo texto cada recv es un mensaje;
+// con tramas una sola lectura grande puede traer muchas.
+// Devuelve true si agotó su turno y pueden quedar datos: epoll no volverá a avisar por ellos.
+bool Reactor::leerConexion(const std::shared_ptr<Conexion>& conexion) {
+    for (int lecturas = 0; lecturas < MAX_LECTURAS_POR_RONDA; ++lecturas) {
+        std::size_t capacidad = conexion->usaTramas() ? sizeof(buffer) : 1024;
+        ssize_t bytesRecibidos = recv(conexion->obtenerDescriptor(), buffer, capacidad, 0);
+        if (bytesRecibidos == -1 && errno == EINTR) {
+            continue;
+        }
+        if (bytesRecibidos == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return false;  // No hay más datos por ahora
+        }
+        if (bytesRecibidos <= 0) {
+            cerrarConexion(conexion.get());
+            return false;
+        }
+
+        if (!servidor.procesarEntrada(conexion, buffer, bytesRecibidos)) {
+            cerrarConexion(conexion.get());
+            return false;
+        }
+    }
+    return true;
+}
+
+// Vaciar la cola de salida; si el socket falló se expulsa al cliente.
+// Con io_uring solo se arma el envío: sale con el resto de la ronda.
+void Reactor::escribirConexion(Conexion* conexion) {
+    if (anillo) {
+        auto operaciones = operacionesUring.find(conexion);
+        if (operaciones != operacionesUring.end()) {
+            armarEnvio(operaciones->second);
+        }
+        return;
+    }
+    std::uint64_t llamadas = 0;
+    bool vaciada = conexion->vaciar(&llamadas);
+    servidor.llamadasEnvio.sumar(llamadas);
+    if (!vaciada) {
+        conexion->expulsar();
+    }
+}
+
+// Quitar la conexión del reactor y darla de baja en el servidor
+void Reactor::cerrarConexion(Conexion* conexion) {
+    auto it = conexiones.find(conexion);
+    if (it == conexiones.end()) {
+        return;
+    }
+    std::shared_ptr<Conexion> referencia = it->second;
+    conexiones.erase(it);
+    rueda.cancelar(conexion->plazo);
+    if (anillo) {
+        cancelarOperaciones(conexion);
+    } else {
+        epoll_ctl(descriptorEpoll, EPOLL_CTL_DEL, conexion->obtenerDescriptor(), nullptr);
+    }
+    numeroConexiones--;
+    servidor.desconectarUsuario(referencia);
+}
+
+// Crear el anillo y registrar los dos grupos de buffers para las recepciones
+bool Reactor::iniciarUring() {
+    anillo.reset(new AnilloUring());
+    buffersTexto.reset(new GrupoBuffers(*anillo, GRUPO_TEXTO, BUFFERS_TEXTO, TAMANO_BUFFER_TEXTO));
+    buffersTramas.reset(new GrupoBuffers(*anillo, GRUPO_TRAMAS, BUFFERS_TRAMAS, TAMANO_BUFFER_TRAMAS));
+    if (!anillo->iniciar(ENTRADAS_URING) || !buffersTexto->registrar() || !buffersTramas->registrar()) {
+        std::cerr << "Error al crear el anillo io_uring del reactor " << id << ".\n";
+        return false;
+    }
+    return true;
+}
+
+// Bucle con io_uring: cada vuelta envía en una sola llamada todo lo armado en la anterior,
+// espera completadas y las atiende
+void Reactor::bucleUring() {
+    reactorActual = this;
+    armarEvento();
+    armarTemporizador();
+    armarAceptacion();
+    while (true) {
+        if (!anillo->esperar()) {
+            return;
+        }
+        bool haySolicitudes = false;
+        anillo->recorrerCompletadas([&](const io_uring_cqe& completada) { completarUring(completada, haySolicitudes); });
+        if (haySolicitudes) {
+            atenderSolicitudes();
+        }
+        if (temporizadorVencido) {
+            temporizadorVencido = false;
+            atenderTemporizador();
+        }
+        vaciarEscriturasLocales();
+        programarTemporizador();
+        armarPendientes();
+    }
+}
+
+void Reactor::completarUring(const io_uring_cqe& completada, bool& haySolicitudes) {
+    std::uint64_t tipo = completada.user_data & MASCARA_TIPO;
+    if (tipo == TIPO_EVENTO) {
+        haySolicitudes = true;
+        if (!(completada.flags & IORING_CQE_F_MORE)) {
+            eventoArmado = false;
+            armarEvento();
+        }
+        return;
+    }
+    if (tipo == TIPO_TEMPORIZADOR) {
+        temporizadorVencido = true;
+        if (!(completada.flags & IORING_CQE_F_MORE)) {
+            temporizadorArmado = false;
+            armarTemporizador();
+        }
+        return;
+    }
+    if (tipo == TIPO_ACEPTAR) {
+        completarAceptacion(completada);
+        return;
+    }
+    if (tipo != TIPO_RECIBIR && tipo != TIPO_ENVIAR) {
+        return;  // Cancelaciones: su efecto llega en las completadas de lo cancelado
+    }
+
+    Conexion* conexion = reinterpret_cast<Conexion*>(completada.user_data & ~MASCARA_TIPO);
+    auto it = operacionesUring.find(conexion);
+    if (it == operacionesUring.end()) {
+        return;
+    }
+    if (tipo == TIPO_RECIBIR) {
+        completarRecepcion(it->second, completada);
+    } else {
+        completarEnvio(it->second, completada);
+    }
+
+    // Dada de baja y sin nada en el núcleo: el reactor suelta su referencia
+    it = operacionesUring.find(conexion);
+    if (it != operacionesUring.end() && !conexiones.count(conexion) && !it->second.recibiendo && !it->second.enviando) {
+        operacionesUring.erase(it);
+    }
+}
+
+void Reactor::completarAceptacion(const io_uring_cqe& completada) {
+    if (!(completada.flags & IORING_CQE_F_MORE)) {
+        aceptacionArmada = false;
+        armarAceptacion();
+    }
+    if (completada.res < 0) {
+        if (completada.res != -ECANCELED && completada.res != -EAGAIN && completada.res != -EINTR) {
+            std::cerr << "Error al aceptar la conexión de un cliente.\n";
+        }
+        return;
+    }
+
+    std::shared_ptr<Conexion> conexion = std::make_shared<Conexion>(completada.res, this);
+    registrarConexion(conexion);
+    servidor.solicitarNombre(conexion);
+}
+
+// Procesar lo recibido en el buffer que eligió el núcleo y devolverlo enseguida al grupo
+void Reactor::completarRecepcion(OperacionesUring& operaciones, const io_uring_cqe& completada) {
+    Conexion* conexion = operaciones.conexion.get();
+    if (!(completada.flags & IORING_CQE_F_MORE)) {
+        operaciones.recibiendo = false;
+    }
+
+    if (completada.res > 0 && (completada.flags & IORING_CQE_F_BUFFER)) {
+        std::uint16_t indice = static_cast<std::uint16_t>(completada.flags >> IORING_CQE_BUFFER_SHIFT);
+        bool valido = !conexiones.count(conexion) ||
+                      servidor.procesarEntrada(operaciones.conexion, operaciones.grupo->buffer(indice), completada.res);
+        operaciones.grupo->devolver(indice);
+        if (!valido) {
+            cerrarConexion(conexion);
+            return;
+        }
+    } else if (completada.res != -ENOBUFS && completada.res != -ECANCELED) {
+        // El cliente cerró o el socket falló
+        cerrarConexion(conexion);
+        return;
+    }
+    if (!conexiones.count(conexion)) {
+        return;
+    }
+
+    if (operaciones.recibiendo) {
+        // Pasó al protocolo con tramas: se cancela para rearmarla con buffers grandes
+        if (conexion->usaTramas() && operaciones.grupo == buffersTexto.get() && !operaciones.cambiandoGrupo) {
+            io_uring_sqe* entrada = anillo->obtenerEntrada();
+            if (entrada != nullptr) {
+                entrada->opcode = IORING_OP_ASYNC_CANCEL;
+                entrada->addr = reinterpret_cast<std::uint64_t>(conexion) | TIPO_RECIBIR;
+                entrada->user_data = TIPO_CANCELAR;
+                operaciones.cambiandoGrupo = true;
+            }
+        }
+        return;
+    }
+    // La recepción terminó (sin buffers libres, cancelada o cortada por el núcleo): se vuelve a armar
+    operaciones.cambiandoGrupo = false;
+    armarRecepcion(operaciones);
+}
+
+void Reactor::completarEnvio(OperacionesUring& operaciones, const io_uring_cqe& completada) {
+    operaciones.enviando = false;
+    if (!operaciones.conexion->completarEnvio(completada.res)) {
+        operaciones.conexion->expulsar();
+        return;
+    }
+    // Lo que se encoló mientras tanto sale en la próxima ronda; con agrupado, cuando venza su ventana
+    if (!conexiones.count(operaciones.conexion.get())) {
+        return;
+    }
+    if (ventanaAgrupadoNs > 0 && operaciones.conexion->obtenerContadores().bytesPendientes > 0) {
+        despertarEscritura(operaciones.conexion);
+    } else {
+        armarEnvio(operaciones);
+    }
+}
+
+// Un poll multishot sobre el eventfd avisa de las solicitudes de otros hilos
+void Reactor::armarEvento() {
+    if (drenando || eventoArmado) {
+        return;
+    }
+    io_uring_sqe* entrada = anillo->obtenerEntrada();
+    if (entrada == nullptr) {
+        return;  // Se reintenta al final de la ronda
+    }
+    entrada->opcode = IORING_OP_POLL_ADD;
+    entrada->fd = descriptorEvento;
+    entrada->poll32_events = POLLIN;
+    entrada->len = IORING_POLL_ADD_MULTI;
+    entrada->user_data = TIPO_EVENTO;
+    eventoArmado = true;
+}
+
+// Otro poll multishot, sobre el timerfd de las diferidas y la rueda
+void Reactor::armarTemporizador() {
+    if (drenando || temporizadorArmado) {
+        return;
+    }
+    io_uring_sqe* entrada = anillo->obtenerEntrada();
+    if (entrada == nullptr) {
+        return;
+    }
+    entrada->opcode = IORING_OP_POLL_ADD;
+    entrada->fd = descriptorTemporizador;
+    entrada->poll32_events = POLLIN;
+    entrada->len = IORING_POLL_ADD_MULTI;
+    entrada->user_data = TIPO_TEMPORIZADOR;
+    temporizadorArmado = true;
+}
+
+// Un accept multishot entrega cada conexión nueva en su propia completada
+void Reactor::armarAceptacion() {
+    if (drenando || aceptacionArmada || descriptorEscucha == -1) {
+        return;
+    }
+    io_uring_sqe* entrada = anillo->obtenerEntrada();
+    if (entrada == nullptr) {
+        return;
+    }
+    entrada->opcode = IORING_OP_ACCEPT;
+    entrada->fd = descriptorEscucha;
+    entrada->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+    entrada->ioprio = IORING_ACCEPT_MULTISHOT;
+    entrada->user_data = TIPO_ACEPTAR;
+    aceptacionArmada = true;
+}
+
+// Recepción multishot: el núcleo toma un buffer del grupo por cada lectura
+void Reactor::armarRecepcion(OperacionesUring& operaciones) {
+    if (drenando || operaciones.recibiendo) {
+        return;
+    }
+    io_uring_sqe* entrada = anillo->obtenerEntrada();
+    if (entrada == nullptr) {
+        porArmar.push_back(operaciones.conexion);
+        return;
+    }
+    Conexion* conexion = operaciones.conexion.get();
+    operaciones.grupo = conexion->usaTramas() ? buffersTramas.get() : buffersTexto.get();
+    entrada->opcode = IORING_OP_RECV;
+    entrada->fd = conexion->obtenerDescriptor();
+    entrada->flags = IOSQE_BUFFER_SELECT;
+    entrada->buf_group = operaciones.grupo->obtenerGrupo();
+    entrada->ioprio = IORING_RECV_MULTISHOT;
+    entrada->user_data = reinterpret_cast<std::uint64_t>(conexion) | TIPO_RECIBIR;
+    operaciones.recibiendo = true;
+}
+
+// Un sendmsg por conexión a la vez con todo lo pendiente; lo que llegue después espera su completado
+void Reactor::armarEnvio(OperacionesUring& operaciones) {
+    if (drenando || operaciones.enviando) {
+        return;
+    }
+    Conexion* conexion = operaciones.conexion.get();
+    int cantidad = conexion->prepararEnvio(operaciones.iov, MAX_IOVEC_SALIDA);
+    if (cantidad == 0) {
+        return;
+    }
+    io_uring_sqe* entrada = anillo->obtenerEntrada();
+    if (entrada == nullptr) {
+        porArmar.push_back(operaciones.conexion);
+        return;
+    }
+    operaciones.mensaje = msghdr();
+    operaciones.mensaje.msg_iov = operaciones.iov;
+    operaciones.mensaje.msg_iovlen = cantidad;
+    entrada->opcode = IORING_OP_SENDMSG;
+    entrada->fd = conexion->obtenerDescriptor();
+    entrada->addr = reinterpret_cast<std::uint64_t>(&operaciones.mensaje);
+    entrada->len = 1;
+    entrada->msg_flags = MSG_NOSIGNAL;
+    entrada->user_data = reinterpret_cast<std::uint64_t>(conexion) | TIPO_ENVIAR;
+    operaciones.enviando = true;
+    servidor.llamadasEnvio.sumar();
+}
+
+// Reintentar lo que no cupo en la cola de envío durante la ronda
+void Reactor::armarPendientes() {
+    armarEvento();
+    armarTemporizador();
+    armarAceptacion();
+    std::vector<std::shared_ptr<Conexion>> pendientes;
+    pendientes.swap(porArmar);
+    for (const auto& conexion : pendientes) {
+        auto operaciones = operacionesUring.find(conexion.get());
+        if (operaciones != operacionesUring.end() && conexiones.count(conexion.get())) {
+            armarRecepcion(operaciones->second);
+            armarEnvio(operaciones->second);
+        }
+    }
+}
+
+// Cancelar todo lo que el núcleo tenga de la conexión; sus completadas la liberan
+void Reactor::cancelarOperaciones(Conexion* conexion) {
+    auto operaciones = operacionesUring.find(conexion);
+    if (operaciones == operacionesUring.end() || (!operaciones->second.recibiendo && !operaciones->second.enviando)) {
+        return;
+    }
+    io_uring_sqe* entrada = anillo->obtenerEntrada();
+    if (entrada == nullptr) {
+        return;  // El socket ya está cortado: las operaciones terminan solas
+    }
+    entrada->opcode = IORING_OP_ASYNC_CANCEL;
+    entrada->fd = conexion->obtenerDescriptor();
+    entrada->cancel_flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL;
+    entrada->user_data = TIPO_CANCELAR;
+}
+
+// Traspaso: cancelar todas las operaciones y atender sus últimas completadas. Lo que ya se recibió
+// se procesa aquí; lo que siga en los sockets lo leerá el servidor nuevo.
+void Reactor::detenerUring() {
+    drenando = true;
+    io_uring_sqe* entrada;
+    while ((entrada = anillo->obtenerEntrada()) == nullptr) {
+        anillo->recorrerCompletadas([this](const io_uring_cqe& completada) {
+            bool haySolicitudes = false;
+            completarUring(completada, haySolicitudes);
+        });
+    }
+    entrada->opcode = IORING_OP_ASYNC_CANCEL;
+    entrada->cancel_flags = IORING_ASYNC_CANCEL_ANY | IORING_ASYNC_CANCEL_ALL;
+    entrada->user_data = TIPO_CANCELAR;
+
+    auto enCurso = [this]() {
+        if (eventoArmado || temporizadorArmado || aceptacionArmada) {
+            return true;
+        }
+        for (const auto& par : operacionesUring) {
+            if (par.second.recibiendo || par.second.enviando) {
+                return true;
+            }
+        }
+        return false;
+    };
+    while (enCurso()) {
+        if (!anillo->esperar()) {
+            return;
+        }
+        anillo->recorrerCompletadas([this](const io_uring_cqe& completada) {
+            bool haySolicitudes = false;
+            completarUring(completada, haySolicitudes);
+        });
+    }
+    porArmar.clear();
+}
+
+// El traspaso falló: volver a armar todo lo que se canceló
+void Reactor::reanudarUring() {
+    drenando = false;
+    armarEvento();
+    armarTemporizador();
+    armarAceptacion();
+    for (auto& par : operacionesUring) {
+        if (conexiones.count(par.first)) {
+            armarRecepcion(par.second);
+            armarEnvio(par.second);
+        }
+    }
+}
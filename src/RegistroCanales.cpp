@@ -0,0 +1,106 @@
+#include "RegistroCanales.h"
+#include "Conexion.h"
+#include <algorithm>
+#include <cctype>
+
+std::shared_ptr<const Canal::Miembros> Canal::obtenerMiembros() const {
+    std::lock_guard<std::mutex> lock(mutexMiembros);
+    return miembros;
+}
+
+std::size_t Canal::tamano() const {
+    return obtenerMiembros()->size();
+}
+
+RegistroCanales::RegistroCanales() {
+    canales[CANAL_GENERAL] = std::make_shared<Canal>(CANAL_GENERAL);
+}
+
+// Agregar la conexión a una copia de la lista de miembros y publicarla
+std::shared_ptr<Canal> RegistroCanales::unir(const std::shared_ptr<Conexion>& conexion, const std::string& nombre) {
+    std::lock_guard<std::mutex> lock(mutexCanales);
+    std::shared_ptr<Canal>& canal = canales[nombre];
+    if (!canal) {
+        canal = std::make_shared<Canal>(nombre);
+    }
+
+    std::lock_guard<std::mutex> lockMiembros(canal->mutexMiembros);
+    std::shared_ptr<Canal::Miembros> nuevos = std::make_shared<Canal::Miembros>(*canal->miembros);
+    nuevos->push_back(conexion);
+    canal->miembros = nuevos;
+    return canal;
+}
+
+// Quitar la conexión del canal y borrar el canal si quedó vacío
+void RegistroCanales::dejar(const std::shared_ptr<Conexion>& conexion, const std::shared_ptr<Canal>& canal) {
+    std::lock_guard<std::mutex> lock(mutexCanales);
+    bool vacio = false;
+    {
+        std::lock_guard<std::mutex> lockMiembros(canal->mutexMiembros);
+        std::shared_ptr<Canal::Miembros> nuevos = std::make_shared<Canal::Miembros>(*canal->miembros);
+        auto posicion = std::find(nuevos->begin(), nuevos->end(), conexion);
+        if (posicion == nuevos->end()) {
+            return;
+        }
+        *posicion = nuevos->back();
+        nuevos->pop_back();
+        vacio = nuevos->empty();
+        canal->miembros = nuevos;
+    }
+
+    if (vacio && canal->obtenerNombre() != CANAL_GENERAL) {
+        auto it = canales.find(canal->obtenerNombre());
+        if (it != canales.end() && it->second == canal) {
+            canales.erase(it);
+        }
+    }
+}
+
+std::shared_ptr<Canal> RegistroCanales::buscar(const std::string& nombre) const {
+    std::lock_guard<std::mutex> lock(mutexCanales);
+    auto it = canales.find(nombre);
+    return it != canales.end() ? it->second : std::shared_ptr<Canal>();
+}
+
+std::vector<ResumenCanal> RegistroCanales::listar() const {
+    std::vector<ResumenCanal> resumenes;
+    {
+        std::lock_guard<std::mutex> lock(mutexCanales);
+        resumenes.reserve(canales.size());
+        for (const auto& par : canales) {
+            ResumenCanal resumen = {par.first, par.second->tamano(), par.second->obtenerMensajes(),
+                                    par.second->obtenerEntregas()};
+            resumenes.push_back(resumen);
+        }
+    }
+    std::sort(resumenes.begin(), resumenes.end(), [](const ResumenCanal& a, const ResumenCanal& b) {
+        return a.miembros != b.miembros ? a.miembros > b.miembros : a.nombre < b.nombre;
+    });
+    return resumenes;
+}
+
+std::size_t RegistroCanales::tamano() const {
+    std::lock_guard<std::mutex> lock(mutexCanales);
+    return canales.size();
+}
+
+bool RegistroCanales::normalizarNombre(const std::string& texto, std::string& nombre) {
+    std::size_t inicio = texto.find_first_not_of(" \t");
+    std::size_t fin = texto.find_last_not_of(" \n\r\t");
+    if (inicio == std::string::npos) {
+        return false;
+    }
+    nombre = texto.substr(inicio, fin - inicio + 1);
+    if (!nombre.empty() && nombre[0] == '#') {
+        nombre.erase(0, 1);
+    }
+    if (nombre.empty() || nombre.size() > MAX_NOMBRE_CANAL) {
+        return false;
+    }
+    for (char c : nombre) {
+        if (!std::isalnum(static_cast<unsigned char>(c)) && c != '-' && c != '_') {
+            return false;
+        }
+    }
+    return true;
+}
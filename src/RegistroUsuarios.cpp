@@ -0,0 +1,152 @@
+#include "RegistroUsuarios.h"
+#include "Conexion.h"
+#include <thread>
+#include <functional>
+
+// Franja de contadores asignada a cada hilo la primera vez que lee
+static std::atomic<std::size_t> siguienteFranja(0);
+
+static std::size_t franjaDelHilo(std::size_t numeroFranjas) {
+    static thread_local std::size_t franja = siguienteFranja.fetch_add(1, std::memory_order_relaxed);
+    return franja % numeroFranjas;
+}
+
+static std::size_t particionDeNombre(const std::string& nombre, std::size_t numeroParticiones) {
+    return std::hash<std::string>()(nombre) % numeroParticiones;
+}
+
+// Entrar como lector: contarse en la paridad de la época actual y confirmar que no cambió
+RegistroUsuarios::Lectura::Lectura(const RegistroUsuarios& registro)
+    : registro(registro), franja(franjaDelHilo(NUMERO_FRANJAS)) {
+    while (true) {
+        std::uint64_t epocaLeida = registro.epoca.load();
+        paridad = epocaLeida & 1;
+        registro.franjas[franja].activos[paridad].fetch_add(1);
+        if (registro.epoca.load() == epocaLeida) {
+            return;
+        }
+        // Un escritor cambió la época entre medio: reintentar con la nueva paridad
+        registro.franjas[franja].activos[paridad].fetch_sub(1);
+    }
+}
+
+RegistroUsuarios::Lectura::~Lectura() {
+    registro.franjas[franja].activos[paridad].fetch_sub(1, std::memory_order_release);
+}
+
+RegistroUsuarios::RegistroUsuarios() : epoca(0), total(0), siguienteOrden(0) {
+    for (std::size_t i = 0; i < NUMERO_PARTICIONES; ++i) {
+        descriptores[i].store(new ParticionDescriptores());
+        nombres[i].store(new ParticionNombres());
+    }
+    for (std::size_t i = 0; i < NUMERO_FRANJAS; ++i) {
+        franjas[i].activos[0].store(0);
+        franjas[i].activos[1].store(0);
+    }
+}
+
+RegistroUsuarios::~RegistroUsuarios() {
+    for (std::size_t i = 0; i < NUMERO_PARTICIONES; ++i) {
+        delete descriptores[i].load();
+        delete nombres[i].load();
+    }
+}
+
+// Cambiar de época y esperar a que salgan los lectores que pudieron ver las particiones viejas
+void RegistroUsuarios::esperarLectores() {
+    std::uint64_t paridadVieja = epoca.fetch_add(1) & 1;
+    for (std::size_t i = 0; i < NUMERO_FRANJAS; ++i) {
+        while (franjas[i].activos[paridadVieja].load() != 0) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+// Dar de alta una conexión ya identificada. El nombre se comprueba y se reserva con el mismo
+// candado que el alta, así que dos conexiones no pueden quedarse con el mismo nombre.
+bool RegistroUsuarios::agregar(const std::shared_ptr<Conexion>& conexion) {
+    std::lock_guard<std::mutex> lock(mutexEscritura);
+    std::size_t j = particionDeNombre(conexion->nombreUsuario, NUMERO_PARTICIONES);
+    const ParticionNombres* viejaNombres = nombres[j].load();
+    if (viejaNombres->conexiones.count(conexion->nombreUsuario)) {
+        return false;
+    }
+    conexion->ordenLlegada = siguienteOrden++;
+
+    std::size_t i = conexion->obtenerDescriptor() % NUMERO_PARTICIONES;
+    const ParticionDescriptores* viejaDescriptores = descriptores[i].load();
+    ParticionDescriptores* nuevaDescriptores = new ParticionDescriptores(*viejaDescriptores);
+    nuevaDescriptores->posiciones[conexion->obtenerDescriptor()] = nuevaDescriptores->conexiones.size();
+    nuevaDescriptores->conexiones.push_back(conexion);
+
+    ParticionNombres* nuevaNombres = new ParticionNombres(*viejaNombres);
+    nuevaNombres->conexiones[conexion->nombreUsuario] = conexion;
+    nombres[j].store(nuevaNombres, std::memory_order_release);
+
+    descriptores[i].store(nuevaDescriptores, std::memory_order_release);
+    total.fetch_add(1, std::memory_order_relaxed);
+
+    esperarLectores();
+    delete viejaDescriptores;
+    delete viejaNombres;
+    return true;
+}
+
+// Dar de baja la conexión del descriptor; devuelve nullptr si no estaba registrada
+std::shared_ptr<Conexion> RegistroUsuarios::quitar(int descriptor) {
+    std::lock_guard<std::mutex> lock(mutexEscritura);
+
+    std::size_t i = descriptor % NUMERO_PARTICIONES;
+    const ParticionDescriptores* viejaDescriptores = descriptores[i].load();
+    auto posicion = viejaDescriptores->posiciones.find(descriptor);
+    if (posicion == viejaDescriptores->posiciones.end()) {
+        return nullptr;
+    }
+    std::shared_ptr<Conexion> conexion = viejaDescriptores->conexiones[posicion->second];
+
+    // Quitar en O(1) moviendo el último elemento al hueco
+    ParticionDescriptores* nuevaDescriptores = new ParticionDescriptores(*viejaDescriptores);
+    std::size_t hueco = posicion->second;
+    nuevaDescriptores->conexiones[hueco] = nuevaDescriptores->conexiones.back();
+    nuevaDescriptores->posiciones[nuevaDescriptores->conexiones[hueco]->obtenerDescriptor()] = hueco;
+    nuevaDescriptores->conexiones.pop_back();
+    nuevaDescriptores->posiciones.erase(descriptor);
+
+    std::size_t j = particionDeNombre(conexion->nombreUsuario, NUMERO_PARTICIONES);
+    const ParticionNombres* viejaNombres = nullptr;
+    auto nombre = nombres[j].load()->conexiones.find(conexion->nombreUsuario);
+    if (nombre != nombres[j].load()->conexiones.end() && nombre->second == conexion) {
+        viejaNombres = nombres[j].load();
+        ParticionNombres* nuevaNombres = new ParticionNombres(*viejaNombres);
+        nuevaNombres->conexiones.erase(conexion->nombreUsuario);
+        nombres[j].store(nuevaNombres, std::memory_order_release);
+    }
+
+    descriptores[i].store(nuevaDescriptores, std::memory_order_release);
+    total.fetch_sub(1, std::memory_order_relaxed);
+
+    esperarLectores();
+    delete viejaDescriptores;
+    delete viejaNombres;
+    return conexion;
+}
+
+std::shared_ptr<Conexion> RegistroUsuarios::buscarPorDescriptor(int descriptor) const {
+    Lectura lectura(*this);
+    const ParticionDescriptores* particion = descriptores[descriptor % NUMERO_PARTICIONES].load(std::memory_order_acquire);
+    auto posicion = particion->posiciones.find(descriptor);
+    if (posicion == particion->posiciones.end()) {
+        return nullptr;
+    }
+    return particion->conexiones[posicion->second];
+}
+
+std::shared_ptr<Conexion> RegistroUsuarios::buscarPorNombre(const std::string& nombre) const {
+    Lectura lectura(*this);
+    const ParticionNombres* particion = nombres[particionDeNombre(nombre, NUMERO_PARTICIONES)].load(std::memory_order_acquire);
+    auto it = particion->conexiones.find(nombre);
+    if (it == particion->conexiones.end()) {
+        return nullptr;
+    }
+    return it->second;
+}
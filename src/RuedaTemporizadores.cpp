@@ -0,0 +1,241 @@
+#include "RuedaTemporizadores.h"
+#include <chrono>
+
+// Duración de un tick de la rueda
+static const std::int64_t NS_POR_TICK = 1000000;
+
+// Primer tick que empieza en o después de 'ns': un temporizador nunca vence antes de su plazo
+static std::uint64_t tickDe(std::int64_t ns) {
+    return ns <= 0 ? 0 : static_cast<std::uint64_t>((ns + NS_POR_TICK - 1) / NS_POR_TICK);
+}
+
+// Distancia circular desde 'desde' hasta la primera ranura ocupada del mapa, o -1 si no hay ninguna.
+// La última vuelta revisa de nuevo la primera palabra, por los bits anteriores a 'desde'.
+static int distanciaOcupada(const std::uint64_t* mapa, unsigned ranuras, unsigned desde) {
+    unsigned palabras = ranuras / 64;
+    unsigned desplazamiento = desde % 64;
+    for (unsigned k = 0; k <= palabras; ++k) {
+        unsigned palabra = (desde / 64 + k) % palabras;
+        std::uint64_t valor = mapa[palabra];
+        if (k == 0) {
+            valor &= ~static_cast<std::uint64_t>(0) << desplazamiento;
+        } else if (k == palabras) {
+            valor &= desplazamiento == 0 ? 0 : ~(~static_cast<std::uint64_t>(0) << desplazamiento);
+        }
+        if (valor != 0) {
+            unsigned posicion = palabra * 64 + static_cast<unsigned>(__builtin_ctzll(valor));
+            return static_cast<int>((posicion - desde) & (ranuras - 1));
+        }
+    }
+    return -1;
+}
+
+Temporizador::Temporizador() : plazo(0), periodo(0), rueda(nullptr), ranura(0) {
+    anterior = nullptr;
+    siguiente = nullptr;
+}
+
+Temporizador::Temporizador(const Temporizador& otro) : accion(otro.accion), plazo(0), periodo(0), rueda(nullptr), ranura(0) {
+    anterior = nullptr;
+    siguiente = nullptr;
+}
+
+Temporizador::~Temporizador() {
+    if (rueda != nullptr) {
+        rueda->cancelar(*this);
+    }
+}
+
+RuedaTemporizadores::RuedaTemporizadores() : ocupadas(), armados(0) {
+    for (unsigned i = 0; i < RANURAS; ++i) {
+        ranuras[i].anterior = &ranuras[i];
+        ranuras[i].siguiente = &ranuras[i];
+    }
+    actual = tickDe(std::chrono::steady_clock::now().time_since_epoch().count());
+}
+
+// Los temporizadores que sigan armados quedan sueltos, para que no apunten a una rueda destruida
+RuedaTemporizadores::~RuedaTemporizadores() {
+    for (unsigned i = 0; i < RANURAS; ++i) {
+        for (NodoRueda* nodo = ranuras[i].siguiente; nodo != &ranuras[i]; nodo = nodo->siguiente) {
+            static_cast<Temporizador*>(nodo)->rueda = nullptr;
+        }
+    }
+}
+
+void RuedaTemporizadores::armar(Temporizador& temporizador, std::int64_t plazo) {
+    armarPeriodico(temporizador, plazo, 0);
+}
+
+void RuedaTemporizadores::armarPeriodico(Temporizador& temporizador, std::int64_t primero, std::int64_t periodo) {
+    if (temporizador.rueda != nullptr) {
+        temporizador.rueda->desenganchar(temporizador);
+    }
+    temporizador.plazo = primero;
+    temporizador.periodo = periodo;
+    insertar(temporizador);
+    armados++;
+}
+
+void RuedaTemporizadores::cancelar(Temporizador& temporizador) {
+    if (temporizador.rueda == this) {
+        desenganchar(temporizador);
+    }
+}
+
+// Ranura según cuánto falta: la rueda de abajo si vence en sus 256 ticks, si no la primera rueda
+// alta que lo alcance. Lo que no entra en ninguna va a la última con el plazo recortado y, cuando
+// esa ranura baja, vuelve a ubicarse con el plazo verdadero.
+void RuedaTemporizadores::insertar(Temporizador& temporizador) {
+    std::uint64_t tick = tickDe(temporizador.plazo);
+    if (tick < actual) {
+        tick = actual;
+    }
+    std::uint64_t distancia = tick - actual;
+    unsigned indice;
+    if (distancia < RANURAS_NIVEL0) {
+        indice = static_cast<unsigned>(tick & (RANURAS_NIVEL0 - 1));
+    } else {
+        unsigned nivel = 1;
+        unsigned desplazamiento = BITS_NIVEL0;
+        while (nivel + 1 < NIVELES && distancia >= (static_cast<std::uint64_t>(1) << (desplazamiento + BITS_NIVEL))) {
+            nivel++;
+            desplazamiento += BITS_NIVEL;
+        }
+        std::uint64_t alcance = static_cast<std::uint64_t>(1) << (desplazamiento + BITS_NIVEL);
+        if (distancia >= alcance) {
+            tick = actual + alcance - 1;
+        }
+        indice = RANURAS_NIVEL0 + (nivel - 1) * RANURAS_NIVEL +
+                 static_cast<unsigned>((tick >> desplazamiento) & (RANURAS_NIVEL - 1));
+    }
+
+    NodoRueda& cabeza = ranuras[indice];
+    temporizador.anterior = cabeza.anterior;
+    temporizador.siguiente = &cabeza;
+    cabeza.anterior->siguiente = &temporizador;
+    cabeza.anterior = &temporizador;
+    ocupadas[indice / 64] |= static_cast<std::uint64_t>(1) << (indice % 64);
+    temporizador.ranura = static_cast<std::uint16_t>(indice);
+    temporizador.rueda = this;
+}
+
+// Sacarlo de su lista; si era el último de la ranura, la ranura queda libre en el mapa
+void RuedaTemporizadores::desenganchar(Temporizador& temporizador) {
+    temporizador.anterior->siguiente = temporizador.siguiente;
+    temporizador.siguiente->anterior = temporizador.anterior;
+    temporizador.anterior = nullptr;
+    temporizador.siguiente = nullptr;
+    NodoRueda& cabeza = ranuras[temporizador.ranura];
+    if (cabeza.siguiente == &cabeza) {
+        ocupadas[temporizador.ranura / 64] &= ~(static_cast<std::uint64_t>(1) << (temporizador.ranura % 64));
+    }
+    temporizador.rueda = nullptr;
+    armados--;
+}
+
+// Repartir una ranura de una rueda alta en las de abajo, ahora que su plazo está cerca
+void RuedaTemporizadores::bajarRanura(unsigned nivel, unsigned indice) {
+    unsigned ranura = RANURAS_NIVEL0 + (nivel - 1) * RANURAS_NIVEL + indice;
+    NodoRueda& cabeza = ranuras[ranura];
+    if (cabeza.siguiente == &cabeza) {
+        return;
+    }
+    NodoRueda* nodo = cabeza.siguiente;
+    cabeza.anterior->siguiente = nullptr;
+    cabeza.anterior = &cabeza;
+    cabeza.siguiente = &cabeza;
+    ocupadas[ranura / 64] &= ~(static_cast<std::uint64_t>(1) << (ranura % 64));
+    while (nodo != nullptr) {
+        NodoRueda* siguiente = nodo->siguiente;
+        insertar(*static_cast<Temporizador*>(nodo));
+        nodo = siguiente;
+    }
+}
+
+std::size_t RuedaTemporizadores::avanzar(std::int64_t ahora) {
+    std::uint64_t hasta = static_cast<std::uint64_t>(ahora / NS_POR_TICK);
+    std::size_t vencidos = 0;
+    while (actual <= hasta) {
+        // Los ticks sin nada que vencer ni bajar se saltean de una vez
+        std::uint64_t siguiente = armados == 0 ? hasta + 1 : proximoTick();
+        if (siguiente > hasta) {
+            actual = hasta + 1;
+            break;
+        }
+        actual = siguiente;
+
+        unsigned indice = static_cast<unsigned>(actual & (RANURAS_NIVEL0 - 1));
+        if (indice == 0) {
+            unsigned desplazamiento = BITS_NIVEL0;
+            for (unsigned nivel = 1; nivel < NIVELES; ++nivel, desplazamiento += BITS_NIVEL) {
+                unsigned alto = static_cast<unsigned>((actual >> desplazamiento) & (RANURAS_NIVEL - 1));
+                bajarRanura(nivel, alto);
+                if (alto != 0) {
+                    break;
+                }
+            }
+        }
+
+        // Los vencidos pasan a una lista propia: lo que armen sus acciones ya cae en ticks siguientes
+        NodoRueda lista;
+        NodoRueda& cabeza = ranuras[indice];
+        actual++;
+        if (cabeza.siguiente == &cabeza) {
+            continue;
+        }
+        lista.siguiente = cabeza.siguiente;
+        lista.anterior = cabeza.anterior;
+        lista.siguiente->anterior = &lista;
+        lista.anterior->siguiente = &lista;
+        cabeza.anterior = &cabeza;
+        cabeza.siguiente = &cabeza;
+        ocupadas[indice / 64] &= ~(static_cast<std::uint64_t>(1) << (indice % 64));
+
+        while (lista.siguiente != &lista) {
+            Temporizador& temporizador = *static_cast<Temporizador*>(lista.siguiente);
+            desenganchar(temporizador);
+            if (temporizador.periodo > 0) {
+                std::int64_t proximo = temporizador.plazo + temporizador.periodo;
+                armarPeriodico(temporizador, proximo > ahora ? proximo : ahora + temporizador.periodo,
+                               temporizador.periodo);
+            }
+            vencidos++;
+            if (temporizador.accion) {
+                temporizador.accion();
+            }
+        }
+    }
+    return vencidos;
+}
+
+std::int64_t RuedaTemporizadores::proximoVencimiento() const {
+    if (armados == 0) {
+        return -1;
+    }
+    return static_cast<std::int64_t>(proximoTick()) * NS_POR_TICK;
+}
+
+// Primer tick con una ranura ocupada en la rueda de abajo o en que baja una ranura ocupada de
+// una rueda alta. La ranura i de la rueda de nivel n baja en el primer múltiplo de 2^desplazamiento
+// que no esté antes de 'actual' y cuyo índice en esa rueda sea i.
+std::uint64_t RuedaTemporizadores::proximoTick() const {
+    std::uint64_t mejor = ~static_cast<std::uint64_t>(0);
+    int distancia = distanciaOcupada(ocupadas, RANURAS_NIVEL0, static_cast<unsigned>(actual & (RANURAS_NIVEL0 - 1)));
+    if (distancia >= 0) {
+        mejor = actual + static_cast<std::uint64_t>(distancia);
+    }
+    unsigned desplazamiento = BITS_NIVEL0;
+    for (unsigned nivel = 1; nivel < NIVELES; ++nivel, desplazamiento += BITS_NIVEL) {
+        const std::uint64_t* mapa = &ocupadas[(RANURAS_NIVEL0 + (nivel - 1) * RANURAS_NIVEL) / 64];
+        std::uint64_t primero = (actual + (static_cast<std::uint64_t>(1) << desplazamiento) - 1) >> desplazamiento;
+        distancia = distanciaOcupada(mapa, RANURAS_NIVEL, static_cast<unsigned>(primero & (RANURAS_NIVEL - 1)));
+        if (distancia >= 0) {
+            std::uint64_t tick = (primero + static_cast<std::uint64_t>(distancia)) << desplazamiento;
+            if (tick < mejor) {
+                mejor = tick;
+            }
+        }
+    }
+    return mejor;
+}
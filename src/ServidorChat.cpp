@@ -1,5 +1,9 @@
 #include "ServidorChat.h"
+#include "Reactor.h"
+#include "Conexion.h"
+#include "AnilloUring.h"
 #include <iostream>
+#include <fstream>
 #include <unistd.h>
 #include <arpa/inet.h>
 #include <thread>
@@ -8,37 +12,121 @@
 #include <netinet/in.h>
 #include <chrono>
 #include <map>
-// Definir los códigos de escape para diferentes colores
-#define RESET   "\033[0m"
-#define RED     "\033[31m"      /* Red */
-#define GREEN   "\033[32m"      /* Green */
-#define YELLOW  "\033[33m"      /* Yellow */
-#define BLUE    "\033[34m"      /* Blue */
-#define MAGENTA "\033[35m"      /* Magenta */
-#define CYAN    "\033[36m"      /* Cyan */
-#define WHITE   "\033[37m"      /* White */
+#include <algorithm>
+#include <random>
+#include <cstdio>
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
 
 
+// Mensaje fijo que pide el nombre; se construye una sola vez y lo comparten todas las conexiones.
+// No se destruye: al salir el bloque volvería a la caché del hilo, que puede ya no existir.
+static const ReferenciaMensaje& mensajeSolicitudNombre() {
+    static const ReferenciaMensaje* solicitud = new ReferenciaMensaje(BufferMensaje::crear("Ingrese su nombre: ", 20));
+    return *solicitud;
+}
+
+// Las ventanas de percentiles guardan una instantánea cada 5 s: 13 cubren el último minuto
+static const std::size_t SEGUNDOS_POR_MUESTRA_PERCENTILES = 5;
+static const std::size_t MUESTRAS_VENTANA_PERCENTILES = 13;
+
+// Con memoria compartida publicar no cuesta una llamada al sistema: el monitor ve datos casi al día
+static const std::chrono::milliseconds INTERVALO_TELEMETRIA_COMPARTIDA(100);
+
+// Plazo por omisión para que una conexión nueva elija nombre
+static const std::chrono::seconds PLAZO_SALUDO(30);
+
+// Espera de la confirmación del servidor nuevo antes de reanudar la atención
+static const int MILISEGUNDOS_CONFIRMACION_TRASPASO = 5000;
+
+// Cada cuánto se vuelve a señalar a los lectores que no se detuvieron: la señal pudo llegar justo
+// antes de que entraran en recv
+static const std::chrono::milliseconds INTERVALO_SENALES_LECTORES(10);
+
+// La señal solo interrumpe el recv bloqueante del lector (sin SA_RESTART)
+static void despertarLector(int) {}
+
 // Constructor que inicializa el puerto del servidor
-ServidorChat::ServidorChat(int puerto)
-    : puerto(puerto), descriptorServidor(-1), totalMensajes(0) {
+ServidorChat::ServidorChat(int puerto, ModoServidor modo, int hilosIO)
+    : puerto(puerto), descriptorServidor(-1), modo(modo), hilosIO(hilosIO), ventanaAgrupado(0), umbralAgrupado(0),
+      plazoSaludo(PLAZO_SALUDO), plazoInactividad(0), historialMensajes(0), historialVentana(0),
+      descriptorTraspasoRecibido(-1), traspasando(false), descriptorParada(-1), lectoresDetenidos(0),
+      aceptadorDetenido(false), intervaloTelemetria(5000), intervaloEnvio(0),
+      descriptorTelemetria(-1), ranuraTelemetria(-1), descriptorStatm(-1), secuenciaTelemetria(0), serieMensajes(),
+      ventanaIntervalos(MUESTRAS_VENTANA_PERCENTILES), ventanaProcesamiento(MUESTRAS_VENTANA_PERCENTILES),
+      ventanaEsperaAgrupado(MUESTRAS_VENTANA_PERCENTILES), muestrasTomadas(0) {
     tiempoInicio = std::chrono::steady_clock::now();
+
+    // Identificador por arranque, para que el monitor distinga un servidor reiniciado en el mismo puerto
+    std::random_device aleatorio;
+    idInstancia = (static_cast<std::uint64_t>(aleatorio()) << 32) | aleatorio();
+    if (this->hilosIO <= 0) {
+        this->hilosIO = std::max(1u, std::thread::hardware_concurrency());
+    }
 }
 
-void ServidorChat::iniciar() {
-    // Crear el socket del servidor
-    descriptorServidor = ::socket(AF_INET, SOCK_STREAM, 0);
-    if (descriptorServidor == -1) {
+ServidorChat::~ServidorChat() {
+    if (descriptorTelemetria != -1) {
+        close(descriptorTelemetria);
+    }
+    if (descriptorStatm != -1) {
+        close(descriptorStatm);
+    }
+    if (descriptorParada != -1) {
+        close(descriptorParada);
+    }
+    if (ranuraTelemetria != -1) {
+        telemetriaCompartida.liberarRanura(ranuraTelemetria);
+    }
+}
+
+void ServidorChat::establecerIntervaloTelemetria(std::chrono::milliseconds intervalo) {
+    intervaloTelemetria = intervalo;
+}
+
+void ServidorChat::establecerHistorial(std::size_t mensajes, std::chrono::seconds ventana) {
+    historialMensajes = mensajes;
+    historialVentana = ventana;
+}
+
+void ServidorChat::establecerFederacion(const std::vector<int>& puertos) {
+    puertosPares.clear();
+    for (int puertoPar : puertos) {
+        if (puertoPar != puerto && std::find(puertosPares.begin(), puertosPares.end(), puertoPar) == puertosPares.end()) {
+            puertosPares.push_back(puertoPar);
+        }
+    }
+}
+
+void ServidorChat::establecerAgrupado(std::chrono::microseconds ventana, std::size_t bytes) {
+    ventanaAgrupado = std::max(ventana, std::chrono::microseconds(0));
+    // Por encima de la marca alta el umbral nunca se alcanzaría: el cliente se expulsa antes
+    umbralAgrupado = std::min(bytes, MARCA_ALTA_SALIDA / 2);
+}
+
+void ServidorChat::establecerPlazos(std::chrono::seconds saludo, std::chrono::seconds inactividad) {
+    plazoSaludo = std::max(saludo, std::chrono::seconds(0));
+    plazoInactividad = std::max(inactividad, std::chrono::seconds(0));
+}
+
+// Crear un socket de escucha en el puerto del servidor; devuelve -1 si falla
+int ServidorChat::crearSocketEscucha(bool noBloqueante) {
+    int descriptorEscucha = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC | (noBloqueante ? SOCK_NONBLOCK : 0), 0);
+    if (descriptorEscucha == -1) {
         std::cerr << "Error al crear el socket del servidor.\n";
-        return;
+        return -1;
     }
 
-    // Configurar SO_REUSEADDR y SO_REUSEPORT
+    // Configurar SO_REUSEADDR y SO_REUSEPORT (son opciones distintas: no se pueden combinar con |)
     int opt = 1;
-    if (setsockopt(descriptorServidor, SOL_SOCKET, SO_REUSEADDR | SO_REUSEPORT, &opt, sizeof(opt)) == -1) {
+    if (setsockopt(descriptorEscucha, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) == -1 ||
+        setsockopt(descriptorEscucha, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) == -1) {
         std::cerr << "Error al configurar el socket con SO_REUSEADDR | SO_REUSEPORT.\n";
-        close(descriptorServidor);
-        return;
+        close(descriptorEscucha);
+        return -1;
     }
 
     sockaddr_in direccionServidor;
@@ -48,259 +136,1145 @@ void ServidorChat::iniciar() {
     // Cambia esta IP a la que deseas usar, asegúrate de que sea la IP correcta
     if (inet_pton(AF_INET, "172.18.76.218", &direccionServidor.sin_addr) <= 0) {
         std::cerr << "Error al convertir la dirección IP." << std::endl;
-        close(descriptorServidor);
-        return;
+        close(descriptorEscucha);
+        return -1;
     }
 
     // Asociar el socket a la dirección y puerto
-    if (bind(descriptorServidor, (sockaddr*)&direccionServidor, sizeof(direccionServidor)) == -1) {
+    if (bind(descriptorEscucha, (sockaddr*)&direccionServidor, sizeof(direccionServidor)) == -1) {
         std::cerr << "Error al hacer bind del socket del servidor.\n";
-        close(descriptorServidor);  // Añadir close aquí para liberar el recurso
-        return;
+        close(descriptorEscucha);  // Añadir close aquí para liberar el recurso
+        return -1;
     }
 
-    // Poner el servidor en modo escucha
-    if (listen(descriptorServidor, 10) == -1) {
+    // Poner el servidor en modo escucha con la cola de conexiones más grande que permita el sistema
+    if (listen(descriptorEscucha, SOMAXCONN) == -1) {
         std::cerr << "Error al poner el servidor en modo escucha.\n";
-        close(descriptorServidor);  // Añadir close aquí para liberar el recurso
+        close(descriptorEscucha);  // Añadir close aquí para liberar el recurso
+        return -1;
+    }
+    return descriptorEscucha;
+}
+
+void ServidorChat::iniciar() {
+    // Si otro servidor ya atiende este puerto, se heredan sus sockets en lugar de abrir otros
+    descriptorTraspasoRecibido = solicitarTraspaso(puerto);
+    if (descriptorTraspasoRecibido != -1) {
+        if (!recibirTraspaso(descriptorTraspasoRecibido, traspasoRecibido) || traspasoRecibido.escuchas.empty()) {
+            std::cerr << "No se pudo recibir el traspaso del servidor anterior; sigue atendiendo él.\n";
+            close(descriptorTraspasoRecibido);
+            return;
+        }
+        std::cout << "Traspaso recibido: " << traspasoRecibido.escuchas.size() << " sockets de escucha y "
+                  << traspasoRecibido.conexiones.size() << " conexiones.\n";
+    }
+
+    descriptorParada = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (descriptorParada == -1) {
+        std::cerr << "Error al crear el eventfd de parada del servidor.\n";
         return;
     }
 
+    // Sin io_uring utilizable se atiende igual, con los mismos reactores sobre epoll
+    if (modo == ModoServidor::URING && !AnilloUring::disponible()) {
+        std::cerr << "io_uring no está disponible en este núcleo; se usa el modo reuseport.\n";
+        modo = ModoServidor::REUSEPORT;
+    }
+
+    // En modo REUSEPORT o URING cada reactor abre su propio socket de escucha (o hereda uno)
+    if (!reactoresPropios()) {
+        if (!traspasoRecibido.escuchas.empty()) {
+            // Un solo hilo acepta: sobran los demás sockets de un anterior en modo REUSEPORT
+            descriptorServidor = traspasoRecibido.escuchas[0];
+            fcntl(descriptorServidor, F_SETFL, fcntl(descriptorServidor, F_GETFL) | O_NONBLOCK);
+            for (std::size_t i = 1; i < traspasoRecibido.escuchas.size(); ++i) {
+                close(traspasoRecibido.escuchas[i]);
+            }
+            traspasoRecibido.escuchas.clear();
+        } else {
+            // No bloqueante: tras el poll, una conexión que se canceló no deja al hilo dormido en accept
+            descriptorServidor = crearSocketEscucha(true);
+        }
+        if (descriptorServidor == -1) {
+            return;
+        }
+    }
+
+    // La bitácora es por puerto: sobrevive a los reinicios del servidor
+    if (historialMensajes > 0) {
+        ConfiguracionBitacora configuracion;
+        configuracion.directorio = "bitacora_" + std::to_string(puerto);
+        bitacora.reset(new BitacoraMensajes(configuracion));
+        if (!bitacora->abrir()) {
+            std::cerr << "No se pudo abrir la bitácora; el servidor sigue sin historial.\n";
+            bitacora.reset();
+        }
+    }
+
     std::cout << "Servidor iniciado en el puerto " << puerto << ". Esperando conexiones...\n";
+    if (ventanaAgrupado.count() > 0) {
+        std::cout << "Agrupado de envíos: ventana de " << ventanaAgrupado.count() << " µs"
+                  << (umbralAgrupado > 0 ? ", umbral de " + std::to_string(umbralAgrupado) + " bytes" : "") << ".\n";
+    }
+    if (plazoInactividad.count() > 0) {
+        std::cout << "Se expulsa a quien pase " << plazoInactividad.count() << " s sin mandar mensajes.\n";
+    }
+
+    // Los emisores hacia los pares reintentan hasta que cada par esté escuchando
+    if (!puertosPares.empty()) {
+        bus.reset(new BusFederacion(idInstancia, "172.18.76.218", puertosPares));
+        bus->iniciar();
+    }
+
+    // Con el monitor en memoria compartida se publica ahí, mucho más seguido; si no, por UDP
+    if (telemetriaCompartida.abrir()) {
+        ranuraTelemetria = telemetriaCompartida.reservarRanura();
+    }
+    descriptorStatm = open("/proc/self/statm", O_RDONLY | O_CLOEXEC);
+    if (ranuraTelemetria != -1) {
+        intervaloEnvio = INTERVALO_TELEMETRIA_COMPARTIDA;
+    } else if (abrirSocketTelemetria()) {
+        intervaloEnvio = intervaloTelemetria;
+    }
+
+    if (modo == ModoServidor::EPOLL) {
+        aceptarConReactores();
+    } else if (reactoresPropios()) {
+        iniciarReactoresReuseport();
+    } else {
+        aceptarConHilos();
+    }
+}
+
+// Aceptar conexiones entrantes y crear un hilo por cliente
+void ServidorChat::aceptarConHilos() {
+    // Un reactor de solo escritura vacía las colas de salida de todos los clientes
+    std::unique_ptr<Reactor> escritor(new Reactor(*this, 0, true));
+    programarTareas(*escritor);
+    if (!escritor->iniciar()) {
+        return;
+    }
+    reactores.push_back(std::move(escritor));
+
+    // Sin SA_RESTART: la señal de un traspaso corta el recv bloqueante de cada lector
+    struct sigaction accion;
+    std::memset(&accion, 0, sizeof(accion));
+    accion.sa_handler = despertarLector;
+    sigemptyset(&accion.sa_mask);
+    sigaction(SIGUSR2, &accion, nullptr);
+    activarTraspaso();
+
+    while (true) {
+        if (!esperarConexionEntrante()) {
+            continue;
+        }
+        sockaddr_in direccionCliente;
+        socklen_t tamanoDireccionCliente = sizeof(direccionCliente);
+        int descriptorCliente = accept4(descriptorServidor, (sockaddr*)&direccionCliente, &tamanoDireccionCliente,
+                                        SOCK_CLOEXEC);
+
+        if (descriptorCliente == -1) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                std::cerr << "Error al aceptar la conexión de un cliente.\n";
+            }
+            continue;
+        }
+
+        // El hilo solo lee; las escrituras pasan por la cola de la conexión
+        std::shared_ptr<Conexion> conexion = std::make_shared<Conexion>(descriptorCliente, reactores[0].get());
+        reactores[0]->agregarConexion(conexion);
+        solicitarNombre(conexion);
+        lanzarLector(conexion);
+    }
+}
 
-    // Crear hilo para enviar información al monitor
-    std::thread([this]() {
-        while (true) {
-            enviarInformacionMonitor();
-            std::this_thread::sleep_for(std::chrono::seconds(5));
+// Aceptar conexiones entrantes y repartirlas entre los reactores epoll
+void ServidorChat::aceptarConReactores() {
+    for (int i = 0; i < hilosIO; ++i) {
+        std::unique_ptr<Reactor> reactor(new Reactor(*this, i));
+        if (i == 0) {
+            programarTareas(*reactor);
+        }
+        if (!reactor->iniciar()) {
+            return;
         }
-    }).detach();    
+        reactores.push_back(std::move(reactor));
+    }
+    std::cout << "Modo epoll con " << hilosIO << " hilos de E/S.\n";
+    activarTraspaso();
 
-    // Aceptar conexiones entrantes
+    std::size_t siguiente = 0;
     while (true) {
+        if (!esperarConexionEntrante()) {
+            continue;
+        }
         sockaddr_in direccionCliente;
         socklen_t tamanoDireccionCliente = sizeof(direccionCliente);
-        int descriptorCliente = accept(descriptorServidor, (sockaddr*)&direccionCliente, &tamanoDireccionCliente);
+        int descriptorCliente = accept4(descriptorServidor, (sockaddr*)&direccionCliente, &tamanoDireccionCliente,
+                                        SOCK_NONBLOCK | SOCK_CLOEXEC);
 
         if (descriptorCliente == -1) {
-            std::cerr << "Error al aceptar la conexión de un cliente.\n";
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                std::cerr << "Error al aceptar la conexión de un cliente.\n";
+            }
             continue;
         }
 
-        // Crear un hilo para manejar el cliente
-        std::thread hiloCliente(&ServidorChat::manejarCliente, this, descriptorCliente);
-        hiloCliente.detach();
+        // Repartir las conexiones en turno rotativo
+        Reactor* reactor = reactores[siguiente].get();
+        siguiente = (siguiente + 1) % reactores.size();
+
+        std::shared_ptr<Conexion> conexion = std::make_shared<Conexion>(descriptorCliente, reactor);
+        reactor->agregarConexion(conexion);
+        solicitarNombre(conexion);
     }
 }
 
+// Un reactor por núcleo, cada uno con su socket de escucha en el mismo puerto.
+// El núcleo reparte las conexiones entrantes entre ellos; este hilo solo espera.
+void ServidorChat::iniciarReactoresReuseport() {
+    unsigned int nucleos = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<int>& heredados = traspasoRecibido.escuchas;
+    for (int i = 0; i < hilosIO; ++i) {
+        int descriptorEscucha = -1;
+        if (static_cast<std::size_t>(i) < heredados.size()) {
+            descriptorEscucha = heredados[i];
+            fcntl(descriptorEscucha, F_SETFL, fcntl(descriptorEscucha, F_GETFL) | O_NONBLOCK);
+        } else {
+            descriptorEscucha = crearSocketEscucha(true);
+        }
+        if (descriptorEscucha == -1) {
+            return;
+        }
+        std::unique_ptr<Reactor> reactor(new Reactor(*this, i));
+        reactor->asignarEscucha(descriptorEscucha);
+        if (modo == ModoServidor::URING) {
+            reactor->usarUring();
+        }
+        if (i == 0) {
+            programarTareas(*reactor);
+        }
+        if (!reactor->iniciar(static_cast<int>(i % nucleos))) {
+            return;
+        }
+        reactores.push_back(std::move(reactor));
+    }
+    for (std::size_t i = hilosIO; i < heredados.size(); ++i) {
+        close(heredados[i]);
+    }
+    heredados.clear();
+    std::cout << "Modo " << (modo == ModoServidor::URING ? "uring" : "reuseport") << " con " << hilosIO << " reactores.\n";
+    activarTraspaso();
 
-// Manejar la comunicación con un cliente
-void ServidorChat::manejarCliente(int descriptorCliente) {
-    char buffer[1024];
-    std::string nombreUsuario;
-
-    // Solicitar el nombre del usuario
-    send(descriptorCliente, "Ingrese su nombre: ", 20, 0);
-    ssize_t bytesRecibidos = recv(descriptorCliente, buffer, 1024, 0);
-    if (bytesRecibidos <= 0) {
-        close(descriptorCliente);
-        return;
+    while (true) {
+        pause();
     }
+}
 
-    nombreUsuario = std::string(buffer, bytesRecibidos);
+// Esperar a que haya una conexión para aceptar; false si en cambio hubo que detenerse por un
+// traspaso que no prosperó (el hilo ya se reanudó al volver)
+bool ServidorChat::esperarConexionEntrante() {
+    pollfd esperas[2] = {{descriptorServidor, POLLIN, 0}, {descriptorParada, POLLIN, 0}};
+    if (poll(esperas, 2, -1) == -1) {
+        return false;
+    }
+    if (esperas[1].revents & POLLIN) {
+        detenerAceptador();
+        return false;
+    }
+    return true;
+}
+
+// Solicitar el nombre del usuario a una conexión recién aceptada
+void ServidorChat::solicitarNombre(const std::shared_ptr<Conexion>& conexion) {
+    enviarA(conexion, mensajeSolicitudNombre());
+}
+
+// Quitar los espacios en blanco finales del nombre recibido
+std::string ServidorChat::limpiarNombre(const char* datos, std::size_t longitud) {
+    std::string nombreUsuario(datos, longitud);
     nombreUsuario.erase(nombreUsuario.find_last_not_of(" \n\r\t") + 1); // Eliminar espacios en blanco
+    return nombreUsuario;
+}
+
+// Crear el hilo lector del cliente. Queda registrado antes de leer nada, para que un traspaso
+// que empiece justo después lo espere.
+void ServidorChat::lanzarLector(const std::shared_ptr<Conexion>& conexion) {
+    std::lock_guard<std::mutex> lock(mutexTraspaso);
+    std::thread hiloCliente(&ServidorChat::manejarCliente, this, conexion);
+    lectores[conexion.get()] = hiloCliente.native_handle();
+    hiloCliente.detach();
+}
+
+// Manejar la comunicación con un cliente
+void ServidorChat::manejarCliente(std::shared_ptr<Conexion> conexion) {
+    std::vector<char> buffer(TAMANO_LECTURA_TRAMAS);
+    int descriptorCliente = conexion->obtenerDescriptor();
+
+    while (true) {
+        if (traspasando.load(std::memory_order_relaxed)) {
+            detenerLector();
+        }
+        // En modo texto cada recv es un mensaje de hasta 1024 bytes, como en el protocolo original
+        std::size_t capacidad = conexion->usaTramas() ? buffer.size() : 1024;
+        ssize_t bytesRecibidos = recv(descriptorCliente, buffer.data(), capacidad, 0);
+        if (bytesRecibidos == -1 && errno == EINTR) {
+            continue;  // Señal de un traspaso
+        }
+        if (bytesRecibidos <= 0) {
+            break;  // El cliente se ha desconectado
+        }
+        if (!procesarEntrada(conexion, buffer.data(), bytesRecibidos)) {
+            break;
+        }
+    }
+    desconectarUsuario(conexion);
 
-    {
-        std::lock_guard<std::mutex> lock(mutexUsuarios);
-        usuarios.emplace_back(nombreUsuario, descriptorCliente);
+    std::lock_guard<std::mutex> lock(mutexTraspaso);
+    lectores.erase(conexion.get());
+    cambioTraspaso.notify_all();
+}
+
+// Agregar el usuario a la lista y avisar a los demás; false si el nombre está vacío o en uso
+bool ServidorChat::registrarUsuario(const std::shared_ptr<Conexion>& conexion) {
+    if (conexion->nombreUsuario.empty() || !registro.agregar(conexion)) {
+        return false;
     }
+    int descriptorCliente = conexion->obtenerDescriptor();
+    conexion->ultimoMensaje.store(std::chrono::steady_clock::now().time_since_epoch().count());
+    enviarHistorial(conexion);
+    conexion->canal = canales.unir(conexion, CANAL_GENERAL);
 
     // Notificar a todos los usuarios que un nuevo usuario se ha conectado
-    std::string mensajeBienvenida = nombreUsuario + " se ha conectado al chat.\n";
-    enviarMensajeATodos(mensajeBienvenida, descriptorCliente);
+    enviarMensajeATodos(BufferMensaje::crear({conexion->nombreUsuario, " se ha conectado al chat.\n"}), descriptorCliente);
+    return true;
+}
 
-    // Actualizar tiempos
-    tiemposUltimosMensajes[descriptorCliente] = std::chrono::steady_clock::now();
+// Pedir otro nombre; devuelve false si ya rechazó demasiados y hay que cerrar la conexión
+bool ServidorChat::rechazarNombre(const std::shared_ptr<Conexion>& conexion) {
+    static const std::uint32_t MAX_NOMBRES_RECHAZADOS = 5;
+    if (++conexion->nombresRechazados > MAX_NOMBRES_RECHAZADOS) {
+        return false;
+    }
+    std::string aviso = conexion->nombreUsuario.empty()
+                            ? std::string("El nombre no puede estar vacío. Ingrese otro nombre: ")
+                            : "El nombre " + conexion->nombreUsuario + " ya está en uso. Ingrese otro nombre: ";
+    conexion->nombreUsuario.clear();
+    enviarA(conexion, aviso, TRAMA_NOMBRE_RECHAZADO);
+    return true;
+}
 
-    // Manejar los mensajes del cliente
-    while (true) {
-        memset(buffer, 0, sizeof(buffer));
-        bytesRecibidos = recv(descriptorCliente, buffer, 1024, 0);
+// Encolar los últimos mensajes de la bitácora antes de dar de alta al usuario, para que queden
+// antes que cualquier difusión. Salen directo de los segmentos mapeados; un mensaje que se
+// difunde justo mientras tanto puede no llegar al historial ni al usuario nuevo.
+void ServidorChat::enviarHistorial(const std::shared_ptr<Conexion>& conexion) {
+    if (!bitacora) {
+        return;
+    }
+    // Dejar lugar en la cola de salida para lo que llegue después del historial
+    std::vector<RegistroHistorial> registros;
+    bitacora->historial(historialMensajes, historialVentana, MARCA_ALTA_SALIDA / 2, registros);
 
-        if (bytesRecibidos <= 0) {
-            // El cliente se ha desconectado
-            {
-                std::lock_guard<std::mutex> lock(mutexUsuarios);
-                for (auto it = usuarios.begin(); it != usuarios.end(); ++it) {
-                    if (it->obtenerDescriptorSocket() == descriptorCliente) {
-                        std::string mensajeDespedida = it->obtenerNombreUsuario() + " se ha desconectado del chat.\n";
-                        enviarMensajeATodos(mensajeDespedida, descriptorCliente);
-                        usuarios.erase(it);
-                        break;
-                    }
-                }
+    // En modo texto los registros salen juntos en un envío: cada uno lleva después un salto de
+    // línea, que es siempre la misma región sin dueño
+    static const char SALTO_LINEA[] = "\n";
+
+    bool tramas = conexion->usaTramas();
+    for (const RegistroHistorial& registroHistorial : registros) {
+        // Con tramas se envía la trama guardada; en modo texto, solo el texto
+        std::size_t omitir = tramas ? 0 : TAMANO_CABECERA_TRAMA;
+        const char* datos = registroHistorial.trama + omitir;
+        std::size_t longitud = registroHistorial.longitudTrama - omitir;
+        Conexion::Encolado resultado = conexion->encolarRegion(datos, longitud, registroHistorial.segmento);
+        if (resultado != Conexion::Encolado::DESBORDADO && !tramas && (longitud == 0 || datos[longitud - 1] != '\n')) {
+            Conexion::Encolado salto = conexion->encolarRegion(SALTO_LINEA, 1, nullptr);
+            if (salto != Conexion::Encolado::ENCOLADO) {
+                resultado = salto;
             }
-            close(descriptorCliente);
+        }
+        if (resultado == Conexion::Encolado::DESBORDADO) {
             break;
         }
+        entregasSalida.sumar();
+        if (resultado == Conexion::Encolado::DESPERTAR) {
+            conexion->obtenerReactor()->solicitarEscritura(conexion);
+        }
+    }
+}
 
-        // Actualizar métricas
-        {
-            std::lock_guard<std::mutex> lock(mutexUsuarios);
-            totalMensajes++;
-            auto ahora = std::chrono::steady_clock::now();
-            auto it = tiemposUltimosMensajes.find(descriptorCliente);
-            if (it != tiemposUltimosMensajes.end()) {
-                auto tiempoUltimoMensaje = it->second;
-                std::chrono::duration<double> tiempoEntreMensajes = ahora - tiempoUltimoMensaje;
-                // Guardar tiempo entre mensajes
-                it->second = ahora;
-            }
+// Procesar lo que devolvió un recv; devuelve false si hay que cerrar la conexión.
+// Los primeros bytes deciden el protocolo: el preámbulo activa las tramas, si no es el modo texto.
+// Un servidor par se presenta con su propio preámbulo y también habla con tramas.
+bool ServidorChat::procesarEntrada(const std::shared_ptr<Conexion>& conexion, const char* datos, std::size_t longitud) {
+    if (!conexion->identificado && !conexion->usaTramas()) {
+        if (comienzaConPreambuloFederacion(datos, longitud)) {
+            conexion->esPar = true;
+        } else if (!comienzaConPreambulo(datos, longitud)) {
+            conexion->nombreUsuario = limpiarNombre(datos, longitud);
+            conexion->identificado = registrarUsuario(conexion);
+            return conexion->identificado || rechazarNombre(conexion);
         }
+        conexion->activarTramas();
+        datos += LONGITUD_PREAMBULO;
+        longitud -= LONGITUD_PREAMBULO;
+    }
 
-        std::string mensaje = std::string(buffer, bytesRecibidos);
+    if (conexion->usaTramas()) {
+        return procesarTramas(conexion, datos, longitud);
+    }
+    return procesarMensaje(conexion, VistaTexto(datos, longitud));
+}
 
-        // Procesar comandos del protocolo
-        if (mensaje.substr(0, 9) == "@usuarios") {
-            enviarListaUsuarios(descriptorCliente);
-        } else if (mensaje.substr(0, 9) == "@conexion") {
-            enviarDetallesConexion(descriptorCliente);
-        } else if (mensaje.substr(0, 6) == "@salir") {
-            close(descriptorCliente);
+// Procesar todas las tramas completas de una lectura directamente sobre el buffer.
+// Solo se copia la trama incompleta del final, que se completa con la lectura siguiente.
+bool ServidorChat::procesarTramas(const std::shared_ptr<Conexion>& conexion, const char* datos, std::size_t longitud) {
+    std::string& resto = conexion->restoEntrada;
+    if (!resto.empty()) {
+        resto.append(datos, longitud);
+        datos = resto.data();
+        longitud = resto.size();
+    }
+    lecturasTramas.sumar();
+
+    std::size_t posicion = 0;
+    std::uint64_t tramas = 0;
+    bool continuar = true;
+    while (continuar) {
+        Trama trama;
+        std::size_t consumidos = 0;
+        ResultadoTrama resultado = leerTrama(datos + posicion, longitud - posicion, trama, consumidos);
+        if (resultado == ResultadoTrama::INCOMPLETA) {
             break;
-        } else if (mensaje.substr(0, 2) == "@h") {
-            std::string ayuda = "Comandos disponibles:\n"
-                                "@usuarios - Lista de usuarios conectados\n"
-                                "@conexion - Muestra la conexión y el número de usuarios\n"
-                                "@salir - Desconectar del chat\n";
-            send(descriptorCliente, ayuda.c_str(), ayuda.size(), 0);
-        } else {
-            // Enviar el mensaje a todos los usuarios
-            mensaje = nombreUsuario + ": " + mensaje;
-            enviarMensajeATodos(mensaje, descriptorCliente);
         }
+        if (resultado == ResultadoTrama::INVALIDA) {
+            continuar = false;
+            break;
+        }
+        posicion += consumidos;
+        tramas++;
+
+        if (conexion->esPar) {
+            continuar = procesarTramaFederacion(conexion, trama);
+        } else if (!conexion->identificado) {
+            // La primera trama tiene que ser el nombre; después de un rechazo se ignora lo demás
+            if (trama.tipo != TRAMA_NOMBRE) {
+                if (conexion->nombresRechazados > 0) {
+                    continue;
+                }
+                continuar = false;
+                break;
+            }
+            conexion->nombreUsuario = limpiarNombre(trama.carga, trama.longitud);
+            conexion->identificado = registrarUsuario(conexion);
+            if (!conexion->identificado && !rechazarNombre(conexion)) {
+                continuar = false;
+                break;
+            }
+        } else if (trama.tipo == TRAMA_TEXTO) {
+            continuar = procesarMensaje(conexion, VistaTexto(trama.carga, trama.longitud));
+        }
+        // Los tipos desconocidos se ignoran para poder ampliar el protocolo
     }
+    tramasRecibidas.sumar(tramas);
+
+    if (!continuar) {
+        return false;
+    }
+    if (datos == resto.data()) {
+        resto.erase(0, posicion);
+    } else {
+        resto.assign(datos + posicion, longitud - posicion);
+    }
+    return true;
 }
 
-// Enviar un mensaje a todos los usuarios conectados, excepto al remitente
-void ServidorChat::enviarMensajeATodos(const std::string& mensaje, int descriptorRemitente) {
-    std::lock_guard<std::mutex> lock(mutexUsuarios);
-    for (const auto& usuario : usuarios) {
-        if (usuario.obtenerDescriptorSocket() != descriptorRemitente) {
-            send(usuario.obtenerDescriptorSocket(), mensaje.c_str(), mensaje.size(), 0);
+// Comandos en el orden en que se prueban, que es también el de la ayuda
+constexpr DefinicionComando<ServidorChat::ManejadorComando> ServidorChat::COMANDOS[] = {
+    {"@usuarios", "@usuarios - Lista de usuarios conectados", &ServidorChat::comandoUsuarios},
+    {"@conexion", "@conexion - Muestra la conexión y el número de usuarios", &ServidorChat::comandoConexion},
+    {"@privado", "@privado <usuario> <texto> - Mensaje solo para ese usuario", &ServidorChat::comandoPrivado},
+    {"@unirse", "@unirse <canal> - Cambiar de canal (se crea si no existe)", &ServidorChat::comandoUnirse},
+    {"@dejar", "@dejar - Volver al canal general", &ServidorChat::comandoDejar},
+    {"@canales", "@canales - Lista de canales con sus miembros", &ServidorChat::comandoCanales},
+    {"@salir", "@salir - Desconectar del chat", &ServidorChat::comandoSalir},
+    {"@h", "", &ServidorChat::comandoAyuda},
+};
+
+// Procesar un mensaje recibido, directamente sobre el buffer de recepción; devuelve false si el
+// cliente pidió salir. Una línea de chat llega a la difusión sin reservar memoria: la única
+// copia es la del mensaje compartido.
+bool ServidorChat::procesarMensaje(const std::shared_ptr<Conexion>& conexion, VistaTexto mensaje) {
+    int descriptorCliente = conexion->obtenerDescriptor();
+
+    // Actualizar métricas sin tocar el registro de usuarios: cada hilo escribe en su fragmento
+    totalMensajes.sumar();
+    std::chrono::steady_clock::time_point inicio = std::chrono::steady_clock::now();
+    std::int64_t anterior = conexion->ultimoMensaje.exchange(inicio.time_since_epoch().count(), std::memory_order_relaxed);
+    intervalosMensajes.registrar(std::chrono::duration_cast<std::chrono::microseconds>(
+        inicio - std::chrono::steady_clock::time_point(std::chrono::steady_clock::duration(anterior))).count());
+    MedicionTiempo medicion(procesamientoMensajes, inicio);
+
+    VistaTexto argumentos;
+    const DefinicionComando<ManejadorComando>* comando = buscarComando(COMANDOS, mensaje, argumentos);
+    if (comando != nullptr) {
+        return (this->*comando->manejador)(conexion, argumentos);
+    }
+    if (conexion->canal) {
+        // Enviar el mensaje a los miembros del canal; la bitácora guarda solo el canal general
+        ReferenciaMensaje difusion = BufferMensaje::crear({conexion->nombreUsuario, ": ", mensaje});
+        if (bitacora && conexion->canal->obtenerNombre() == CANAL_GENERAL) {
+            bitacora->agregar(difusion->datos(), difusion->longitud());
+        }
+        enviarMensajeACanal(*conexion->canal, difusion, descriptorCliente);
+        if (bus) {
+            bus->publicar(conexion->canal->obtenerNombre(), difusion);
         }
     }
+    return true;
+}
+
+bool ServidorChat::comandoUsuarios(const std::shared_ptr<Conexion>& conexion, VistaTexto) {
+    enviarListaUsuarios(conexion);
+    return true;
+}
+
+bool ServidorChat::comandoConexion(const std::shared_ptr<Conexion>& conexion, VistaTexto) {
+    enviarDetallesConexion(conexion);
+    return true;
+}
+
+bool ServidorChat::comandoPrivado(const std::shared_ptr<Conexion>& conexion, VistaTexto argumentos) {
+    enviarPrivado(conexion, argumentos.copiar());
+    return true;
+}
+
+bool ServidorChat::comandoUnirse(const std::shared_ptr<Conexion>& conexion, VistaTexto argumentos) {
+    cambiarCanal(conexion, argumentos.copiar());
+    return true;
+}
+
+bool ServidorChat::comandoDejar(const std::shared_ptr<Conexion>& conexion, VistaTexto) {
+    cambiarCanal(conexion, CANAL_GENERAL);
+    return true;
+}
+
+bool ServidorChat::comandoCanales(const std::shared_ptr<Conexion>& conexion, VistaTexto) {
+    enviarListaCanales(conexion);
+    return true;
+}
+
+bool ServidorChat::comandoSalir(const std::shared_ptr<Conexion>&, VistaTexto) {
+    return false;
+}
+
+// La ayuda se arma con la tabla la primera vez y después todos comparten el mismo mensaje
+// (sin destruirse, como la solicitud de nombre)
+bool ServidorChat::comandoAyuda(const std::shared_ptr<Conexion>& conexion, VistaTexto) {
+    static const ReferenciaMensaje* ayuda = new ReferenciaMensaje(BufferMensaje::crear(construirAyuda(COMANDOS)));
+    enviarA(conexion, *ayuda);
+    return true;
+}
+
+// Procesar una trama de un servidor par; devuelve false si hay que cortar el enlace.
+// Los mensajes de un LOTE se difunden al canal del mismo nombre, si existe aquí.
+bool ServidorChat::procesarTramaFederacion(const std::shared_ptr<Conexion>& conexion, const Trama& trama) {
+    if (!bus) {
+        return false;  // Este servidor no está federado
+    }
+    if (trama.tipo == TRAMA_FEDERACION_HOLA) {
+        if (trama.longitud != 16) {
+            return false;
+        }
+        char estado[8];
+        escribirEntero(estado, bus->registrarOrigen(leerEntero(trama.carga, 8), leerEntero(trama.carga + 8, 8)), 8);
+        enviarA(conexion, BufferMensaje::crear(estado, sizeof(estado)), TRAMA_FEDERACION_ESTADO);
+        return true;
+    }
+    if (trama.tipo != TRAMA_FEDERACION_LOTE) {
+        return true;
+    }
+    if (trama.longitud < 20) {
+        return false;
+    }
+
+    std::uint64_t origen = leerEntero(trama.carga, 8);
+    std::uint64_t primera = leerEntero(trama.carga + 8, 8);
+    std::uint32_t cantidad = static_cast<std::uint32_t>(leerEntero(trama.carga + 16, 4));
+    std::size_t posicion = 20;
+    std::string nombreCanal;
+    std::shared_ptr<Canal> canal;
+    for (std::uint32_t i = 0; i < cantidad; ++i) {
+        if (posicion + 1 > trama.longitud) {
+            return false;
+        }
+        std::size_t longitudCanal = static_cast<unsigned char>(trama.carga[posicion]);
+        if (posicion + 1 + longitudCanal + 4 > trama.longitud) {
+            return false;
+        }
+        const char* nombre = trama.carga + posicion + 1;
+        std::size_t longitudTexto = leerEntero(nombre + longitudCanal, 4);
+        const char* texto = nombre + longitudCanal + 4;
+        posicion += 1 + longitudCanal + 4 + longitudTexto;
+        if (posicion > trama.longitud) {
+            return false;
+        }
+        if (!bus->aceptar(origen, primera + i)) {
+            continue;
+        }
+
+        // Los mensajes de un lote suelen ir al mismo canal: se busca solo cuando cambia
+        if (nombreCanal.compare(0, std::string::npos, nombre, longitudCanal) != 0) {
+            nombreCanal.assign(nombre, longitudCanal);
+            canal = canales.buscar(nombreCanal);
+        }
+        if (!canal) {
+            continue;  // Nadie está en ese canal en este servidor
+        }
+        ReferenciaMensaje mensaje = BufferMensaje::crear(texto, longitudTexto);
+        if (bitacora && nombreCanal == CANAL_GENERAL) {
+            bitacora->agregar(mensaje->datos(), mensaje->longitud());
+        }
+        enviarMensajeACanal(*canal, mensaje, -1);
+    }
+    return true;
+}
+
+// Quitar al usuario de la lista, avisar a los demás y cortar su socket
+void ServidorChat::desconectarUsuario(const std::shared_ptr<Conexion>& conexion) {
+    int descriptorCliente = conexion->obtenerDescriptor();
+    if (conexion->canal) {
+        canales.dejar(conexion, conexion->canal);
+        conexion->canal.reset();
+    }
+    if (registro.quitar(descriptorCliente)) {
+        ReferenciaMensaje mensajeDespedida = BufferMensaje::crear({conexion->nombreUsuario, " se ha desconectado del chat.\n"});
+        enviarMensajeATodos(mensajeDespedida, descriptorCliente);
+    }
+
+    // El socket se cierra cuando se suelta la última referencia a la conexión
+    conexion->expulsar();
+    conexion->obtenerReactor()->quitarConexion(conexion);
+}
+
+// Encolar datos para un cliente y despertar a su escritor si hace falta
+void ServidorChat::enviarA(const std::shared_ptr<Conexion>& conexion, const ReferenciaMensaje& mensaje,
+                           std::uint8_t tipoTrama) {
+    switch (conexion->encolar(mensaje, tipoTrama)) {
+    case Conexion::Encolado::DESPERTAR:
+        entregasSalida.sumar();
+        conexion->obtenerReactor()->solicitarEscritura(conexion);
+        break;
+    case Conexion::Encolado::DESBORDADO:
+        // Cliente lento: cortar la conexión en lugar de frenar a los demás
+        if (conexion->expulsar()) {
+            clientesExpulsados.sumar();
+        }
+        break;
+    case Conexion::Encolado::ENCOLADO:
+        entregasSalida.sumar();
+        break;
+    }
+}
+
+void ServidorChat::enviarA(const std::shared_ptr<Conexion>& conexion, const std::string& mensaje,
+                           std::uint8_t tipoTrama) {
+    enviarA(conexion, BufferMensaje::crear(mensaje), tipoTrama);
+}
+
+// Enviar un mensaje a todos los usuarios conectados, excepto al remitente.
+// Todos los destinatarios comparten el mismo buffer: cada uno solo suma una referencia.
+void ServidorChat::enviarMensajeATodos(const ReferenciaMensaje& mensaje, int descriptorRemitente) {
+    if (reactoresPropios()) {
+        // Cada reactor reparte a sus propias conexiones; a los demás se les deja en el buzón
+        Reactor* actual = Reactor::delHiloActual();
+        for (const auto& reactor : reactores) {
+            if (reactor.get() == actual) {
+                reactor->difundirLocal(mensaje, descriptorRemitente);
+            } else {
+                reactor->publicarDifusion(mensaje, descriptorRemitente);
+            }
+        }
+        return;
+    }
+
+    registro.paraCada([&](const std::shared_ptr<Conexion>& destinatario) {
+        if (destinatario->obtenerDescriptor() != descriptorRemitente) {
+            enviarA(destinatario, mensaje);
+        }
+    });
+}
+
+// Enviar un mensaje a los miembros del canal, excepto al remitente: O(miembros), no O(usuarios).
+// Los miembros pueden ser de cualquier reactor; encolar y despertar a otro reactor es seguro.
+void ServidorChat::enviarMensajeACanal(Canal& canal, const ReferenciaMensaje& mensaje, int descriptorRemitente) {
+    std::shared_ptr<const Canal::Miembros> miembros = canal.obtenerMiembros();
+    std::uint64_t entregas = 0;
+    for (const auto& destinatario : *miembros) {
+        if (destinatario->obtenerDescriptor() != descriptorRemitente) {
+            enviarA(destinatario, mensaje);
+            entregas++;
+        }
+    }
+    canal.contarMensaje(entregas);
+}
+
+// Pasar al usuario a otro canal y avisar a los miembros de ambos
+void ServidorChat::cambiarCanal(const std::shared_ptr<Conexion>& conexion, const std::string& nombreCanal) {
+    std::string nombre;
+    if (!RegistroCanales::normalizarNombre(nombreCanal, nombre)) {
+        enviarA(conexion, "Nombre de canal inválido: use hasta " + std::to_string(MAX_NOMBRE_CANAL) +
+                              " letras, dígitos, '-' o '_'.\n");
+        return;
+    }
+    if (conexion->canal && conexion->canal->obtenerNombre() == nombre) {
+        enviarA(conexion, "Ya estás en el canal #" + nombre + ".\n");
+        return;
+    }
+
+    int descriptorCliente = conexion->obtenerDescriptor();
+    if (conexion->canal) {
+        std::shared_ptr<Canal> anterior = conexion->canal;
+        canales.dejar(conexion, anterior);
+        enviarMensajeACanal(*anterior, BufferMensaje::crear({conexion->nombreUsuario, " dejó el canal #", anterior->obtenerNombre(), ".\n"}),
+                            descriptorCliente);
+    }
+    conexion->canal = canales.unir(conexion, nombre);
+    enviarMensajeACanal(*conexion->canal, BufferMensaje::crear({conexion->nombreUsuario, " se unió al canal #", nombre, ".\n"}),
+                        descriptorCliente);
+    enviarA(conexion, "Ahora estás en el canal #" + nombre + " (" + std::to_string(conexion->canal->tamano()) + " miembros).\n");
+}
+
+// Enviar un mensaje directo: una búsqueda en el índice por nombre y un solo encolado,
+// sin pasar por la difusión
+void ServidorChat::enviarPrivado(const std::shared_ptr<Conexion>& conexion, const std::string& argumentos) {
+    std::size_t inicioNombre = argumentos.find_first_not_of(" \t");
+    std::size_t finNombre = inicioNombre == std::string::npos ? std::string::npos : argumentos.find_first_of(" \t\r\n", inicioNombre);
+    std::size_t inicioTexto = finNombre == std::string::npos ? std::string::npos : argumentos.find_first_not_of(" \t", finNombre);
+    if (inicioTexto == std::string::npos || argumentos.find_first_not_of(" \t\r\n", inicioTexto) == std::string::npos) {
+        enviarA(conexion, "Uso: @privado <usuario> <texto>\n");
+        return;
+    }
+
+    std::string nombre = argumentos.substr(inicioNombre, finNombre - inicioNombre);
+    std::shared_ptr<Conexion> destinatario = registro.buscarPorNombre(nombre);
+    if (!destinatario) {
+        enviarA(conexion, "El usuario " + nombre + " no está conectado.\n");
+        return;
+    }
+    enviarA(destinatario, BufferMensaje::crear({"[privado] ", conexion->nombreUsuario, ": ", argumentos.substr(inicioTexto)}));
+}
+
+// Enviar la lista de canales con sus miembros
+void ServidorChat::enviarListaCanales(const std::shared_ptr<Conexion>& conexion) {
+    std::string lista = "Canales:\n";
+    for (const ResumenCanal& resumen : canales.listar()) {
+        lista += "#" + resumen.nombre + " (" + std::to_string(resumen.miembros) + " miembros)\n";
+    }
+    enviarA(conexion, lista);
 }
 
 // Enviar la lista de usuarios conectados al cliente especificado
-void ServidorChat::enviarListaUsuarios(int descriptorCliente) {
-    std::lock_guard<std::mutex> lock(mutexUsuarios);
+void ServidorChat::enviarListaUsuarios(const std::shared_ptr<Conexion>& conexion) {
+    // Ordenar por llegada, como se muestran desde siempre
+    std::vector<std::pair<std::uint64_t, std::string>> nombres;
+    registro.paraCada([&](const std::shared_ptr<Conexion>& usuario) {
+        nombres.emplace_back(usuario->ordenLlegada, usuario->nombreUsuario);
+    });
+    std::sort(nombres.begin(), nombres.end());
+
     std::string listaUsuarios = "Usuarios conectados:\n";
-    for (const auto& usuario : usuarios) {
-        listaUsuarios += usuario.obtenerNombreUsuario() + "\n";
+    for (const auto& nombre : nombres) {
+        listaUsuarios += nombre.second + "\n";
     }
-    send(descriptorCliente, listaUsuarios.c_str(), listaUsuarios.size(), 0);
+    enviarA(conexion, listaUsuarios);
 }
 
 // Enviar los detalles de la conexión y el número de usuarios conectados
-void ServidorChat::enviarDetallesConexion(int descriptorCliente) {
-    std::lock_guard<std::mutex> lock(mutexUsuarios);
-    std::string detalles = "Número de usuarios conectados: " + std::to_string(usuarios.size()) + "\n";
-    send(descriptorCliente, detalles.c_str(), detalles.size(), 0);
+void ServidorChat::enviarDetallesConexion(const std::shared_ptr<Conexion>& conexion) {
+    std::string detalles = "Número de usuarios conectados: " + std::to_string(registro.tamano()) + "\n";
+    enviarA(conexion, detalles);
 }
 
-// Enviar el promedio de mensajes al monitor
-std::string ServidorChat::enviarPromedioMensajes() {
-    std::chrono::duration<double> duracion = std::chrono::steady_clock::now() - tiempoInicio;
-    double promedioMensajes = totalMensajes / duracion.count();
-    std::string mensaje = "Promedio de mensajes: " + std::to_string(promedioMensajes) + " mensajes/segundo\n";
-    return mensaje;
+// Memoria residente del proceso en KB, leída del descriptor de /proc/self/statm que se deja abierto
+std::uint64_t ServidorChat::leerMemoriaResidenteKB() {
+    char buffer[128];
+    ssize_t leidos = descriptorStatm != -1 ? pread(descriptorStatm, buffer, sizeof(buffer) - 1, 0) : -1;
+    if (leidos <= 0) {
+        return 0;
+    }
+    buffer[leidos] = '\0';
+    unsigned long paginasTotales = 0;
+    unsigned long paginasResidentes = 0;
+    if (std::sscanf(buffer, "%lu %lu", &paginasTotales, &paginasResidentes) != 2) {
+        return 0;
+    }
+    return paginasResidentes * (sysconf(_SC_PAGESIZE) / 1024);
 }
 
-// Enviar la tasa de uso al monitor
-std::string ServidorChat::enviarTasaUso() {
-    std::chrono::duration<double> duracion = std::chrono::steady_clock::now() - tiempoInicio;
-    double tasaUso = totalMensajes / duracion.count();
-    std::string mensaje = "Tasa de uso: " + std::to_string(tasaUso) + " mensajes/segundo\n";
-    return mensaje;
-}
+// Llenar el paquete de telemetría; el texto legible lo arma el monitor
+void ServidorChat::llenarTelemetria(PaqueteTelemetria& paquete) {
+    std::memset(&paquete, 0, sizeof(paquete));
+    paquete.magia = MAGIA_TELEMETRIA;
+    paquete.version = VERSION_TELEMETRIA;
+    paquete.longitud = sizeof(PaqueteTelemetria);
+    paquete.idInstancia = idInstancia;
+    paquete.secuencia = secuenciaTelemetria++;
+    paquete.pid = static_cast<std::uint32_t>(getpid());
+    paquete.puerto = static_cast<std::uint16_t>(puerto);
+    paquete.hilosIO = static_cast<std::uint8_t>(std::min(hilosIO, 255));
+    if (modo == ModoServidor::EPOLL) {
+        paquete.modo = MODO_TELEMETRIA_EPOLL;
+    } else if (modo == ModoServidor::REUSEPORT) {
+        paquete.modo = MODO_TELEMETRIA_REUSEPORT;
+    } else if (modo == ModoServidor::URING) {
+        paquete.modo = MODO_TELEMETRIA_URING;
+    } else {
+        paquete.modo = MODO_TELEMETRIA_HILOS;
+    }
 
-// Enviar el tiempo promedio entre mensajes al monitor
-std::string ServidorChat::enviarTiempoEntreMensajes() {
-    double tiempoTotal = 0.0;
-    int contador = 0;
     auto ahora = std::chrono::steady_clock::now();
+    paquete.tiempoActividadNs = std::chrono::duration_cast<std::chrono::nanoseconds>(ahora - tiempoInicio).count();
 
-    std::lock_guard<std::mutex> lock(mutexUsuarios);
-    for (const auto& it : tiemposUltimosMensajes) {
-        auto tiempoUltimoMensaje = it.second;
-        if (tiempoUltimoMensaje != ahora) {
-            std::chrono::duration<double> tiempoEntreMensajes = ahora - tiempoUltimoMensaje;
-            tiempoTotal += tiempoEntreMensajes.count();
-            contador++;
+    paquete.totalMensajes = totalMensajes.leer();
+    paquete.clientesExpulsados = clientesExpulsados.leer();
+    paquete.lecturasTramas = lecturasTramas.leer();
+    paquete.tramasRecibidas = tramasRecibidas.leer();
+
+    // Un solo recorrido del registro para las colas y el tiempo sin mensajes
+    std::uint64_t usuarios = 0;
+    std::uint64_t sinMensajesUs = 0;
+    std::int64_t ahoraNs = ahora.time_since_epoch().count();
+    registro.paraCada([&](const std::shared_ptr<Conexion>& conexion) {
+        Conexion::Contadores contadores = conexion->obtenerContadores();
+        paquete.bytesPendientes += contadores.bytesPendientes;
+        paquete.profundidadMaxima = std::max<std::uint64_t>(paquete.profundidadMaxima, contadores.profundidadMaxima);
+        std::int64_t ultimo = conexion->ultimoMensaje.load(std::memory_order_relaxed);
+        sinMensajesUs += std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::duration(ahoraNs - ultimo)).count();
+        usuarios++;
+    });
+    paquete.usuariosConectados = static_cast<std::uint32_t>(usuarios);
+    paquete.tiempoSinMensajesUs = usuarios > 0 ? sinMensajesUs / usuarios : 0;
+    paquete.memoriaResidenteKB = leerMemoriaResidenteKB();
+
+    // En modo HILOS el único reactor solo escribe; el reparto importa con reactores que leen
+    if (modo != ModoServidor::HILOS) {
+        paquete.numeroReactores = static_cast<std::uint32_t>(std::min(reactores.size(), MAX_REACTORES_TELEMETRIA));
+        for (std::size_t i = 0; i < paquete.numeroReactores; ++i) {
+            paquete.conexionesReactor[i] = static_cast<std::uint32_t>(reactores[i]->obtenerNumeroConexiones());
         }
     }
-    double tiempoPromedio = (contador > 0) ? (tiempoTotal / contador) : 0.0;
-    std::string mensaje = "Tiempo promedio entre mensajes: " + std::to_string(tiempoPromedio) + " segundos\n";
-    return mensaje;
-}
 
-// Enviar el tiempo de actividad al monitor
-std::string ServidorChat::enviarTiempoActividad() {
-    std::chrono::duration<double> duracion = std::chrono::steady_clock::now() - tiempoInicio;
-    std::string mensaje = "Tiempo de actividad: " + std::to_string(duracion.count()) + " segundos\n";
-    return mensaje;
-}
+    // Los canales con más miembros; el resto solo cuenta en numeroCanales
+    std::vector<ResumenCanal> resumenes = canales.listar();
+    paquete.numeroCanales = static_cast<std::uint32_t>(resumenes.size());
+    paquete.canalesEnviados = static_cast<std::uint32_t>(std::min(resumenes.size(), MAX_CANALES_TELEMETRIA));
+    for (std::size_t i = 0; i < paquete.canalesEnviados; ++i) {
+        CanalTelemetria& canal = paquete.canales[i];
+        std::strncpy(canal.nombre, resumenes[i].nombre.c_str(), LONGITUD_NOMBRE_CANAL_TELEMETRIA - 1);
+        canal.miembros = static_cast<std::uint32_t>(resumenes[i].miembros);
+        canal.mensajes = resumenes[i].mensajes;
+        canal.entregas = resumenes[i].entregas;
+    }
 
+    paquete.entregasSalida = entregasSalida.leer();
+    paquete.llamadasEnvio = llamadasEnvio.leer();
+    paquete.ventanaAgrupadoUs = static_cast<std::uint32_t>(ventanaAgrupado.count());
+    paquete.umbralAgrupadoBytes = static_cast<std::uint32_t>(umbralAgrupado);
+    paquete.vaciadosVentana = vaciadosVentana.leer();
+    paquete.vaciadosUmbral = vaciadosUmbral.leer();
+    paquete.plazoSaludoS = static_cast<std::uint32_t>(plazoSaludo.count());
+    paquete.plazoInactividadS = static_cast<std::uint32_t>(plazoInactividad.count());
+    paquete.vencidasSaludo = vencidasSaludo.leer();
+    paquete.vencidasInactividad = vencidasInactividad.leer();
 
-// Enviar el número de usuarios conectados al monitor
-std::string ServidorChat::enviarNumeroUsuarios() {
-    std::lock_guard<std::mutex> lock(mutexUsuarios);
-    std::string mensaje = "Número de usuarios conectados: " + std::to_string(usuarios.size()) + "\n";
-    return mensaje;
+    if (bus) {
+        EstadisticasFederacion federacion = bus->obtenerEstadisticas();
+        paquete.paresFederacion = federacion.pares;
+        paquete.paresConectados = federacion.paresConectados;
+        paquete.federacionPublicados = federacion.publicados;
+        paquete.federacionLotes = federacion.lotesEnviados;
+        paquete.federacionEnviados = federacion.mensajesEnviados;
+        paquete.federacionAplicados = federacion.aplicados;
+        paquete.federacionDuplicados = federacion.duplicados;
+        paquete.federacionHuecos = federacion.huecos;
+    }
+
+    // Tasas por ventana a partir de las muestras de cada segundo
+    static const double VENTANAS_SEGUNDOS[VENTANAS_TELEMETRIA] = {1.0, 60.0, 300.0};
+    for (std::size_t i = 0; i < VENTANAS_TELEMETRIA; ++i) {
+        paquete.tasaMensajesMilis[i] = static_cast<std::uint64_t>(serieMensajes.tasa(VENTANAS_SEGUNDOS[i]) * 1000.0);
+    }
+
+    // Los fragmentos de los histogramas solo se suman aquí, fuera del camino de los mensajes
+    static const double PERCENTILES[PERCENTILES_TELEMETRIA] = {0.50, 0.99, 0.999};
+    InstantaneaHistograma acumulado;
+    InstantaneaHistograma ventana;
+    intervalosMensajes.combinar(acumulado);
+    for (std::size_t i = 0; i < CUBETAS_HISTOGRAMA; ++i) {
+        paquete.cubetasIntervalo[cubetaTelemetria(InstantaneaHistograma::limiteInferior(i))] += acumulado.cubetas[i];
+    }
+    ventanaIntervalos.ventana(acumulado, ventana);
+    for (std::size_t i = 0; i < PERCENTILES_TELEMETRIA; ++i) {
+        paquete.percentilesIntervaloUs[i] = ventana.percentil(PERCENTILES[i]);
+    }
+    procesamientoMensajes.combinar(acumulado);
+    ventanaProcesamiento.ventana(acumulado, ventana);
+    for (std::size_t i = 0; i < PERCENTILES_TELEMETRIA; ++i) {
+        paquete.percentilesProcesamientoNs[i] = ventana.percentil(PERCENTILES[i]);
+    }
+    esperaAgrupado.combinar(acumulado);
+    ventanaEsperaAgrupado.ventana(acumulado, ventana);
+    for (std::size_t i = 0; i < PERCENTILES_TELEMETRIA; ++i) {
+        paquete.percentilesEsperaAgrupadoUs[i] = ventana.percentil(PERCENTILES[i]);
+    }
 }
 
+// Tomar las muestras de cada segundo para las ventanas de tasas y percentiles
+void ServidorChat::muestrearMetricas() {
+    std::chrono::duration<double> actividad = std::chrono::steady_clock::now() - tiempoInicio;
+    serieMensajes.muestrear(actividad.count(), totalMensajes.leer());
 
-// Función para concatenar múltiples strings con un delimitador
-std::string ServidorChat::concatenarMensajes(const std::vector<std::string>& mensajes, const std::string& delimiter) {
-    std::string mensajesConcatenados;
-    
-    for (const auto& msg : mensajes) {
-        mensajesConcatenados += msg + delimiter;
+    if (muestrasTomadas++ % SEGUNDOS_POR_MUESTRA_PERCENTILES == 0) {
+        InstantaneaHistograma acumulado;
+        intervalosMensajes.combinar(acumulado);
+        ventanaIntervalos.muestrear(acumulado);
+        procesamientoMensajes.combinar(acumulado);
+        ventanaProcesamiento.muestrear(acumulado);
+        esperaAgrupado.combinar(acumulado);
+        ventanaEsperaAgrupado.muestrear(acumulado);
     }
-    
-    return mensajesConcatenados;
 }
 
-// Enviar toda la información al monitor
-void ServidorChat::enviarInformacionMonitor() {
-    int socketDescriptor = ::socket(AF_INET, SOCK_DGRAM, 0);
-    if (socketDescriptor == -1) {
+// Abrir el socket UDP hacia el monitor una sola vez; connect fija el destino para usar send
+bool ServidorChat::abrirSocketTelemetria() {
+    descriptorTelemetria = ::socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (descriptorTelemetria == -1) {
         std::cerr << "Error al crear el socket UDP.\n";
-        return;
+        return false;
     }
 
     sockaddr_in direccionMonitor;
+    std::memset(&direccionMonitor, 0, sizeof(direccionMonitor));
     direccionMonitor.sin_family = AF_INET;
-    direccionMonitor.sin_port = htons(55555); // Puerto para el monitor
+    direccionMonitor.sin_port = htons(PUERTO_TELEMETRIA); // Puerto para el monitor
     direccionMonitor.sin_addr.s_addr = inet_addr("172.18.76.218"); // Dirección IP del monitor
+    if (connect(descriptorTelemetria, (sockaddr*)&direccionMonitor, sizeof(direccionMonitor)) == -1) {
+        std::cerr << "Error al conectar el socket UDP con el monitor.\n";
+        close(descriptorTelemetria);
+        descriptorTelemetria = -1;
+        return false;
+    }
+    return true;
+}
 
-    std::string mensaje = GREEN "Servidor en el puerto: " + std::to_string(puerto) + RESET + "\n";
-    std::string numeroDeUsuarios = enviarNumeroUsuarios();
-    std::string tasaDeUso = enviarTasaUso();
-    std::string promedioMensajes = enviarPromedioMensajes(); 
-    std::string tiempoEntreMensajes = enviarTiempoEntreMensajes();
-    std::string tiempoDeActividad = enviarTiempoActividad();
-    
-    std::vector<std::string> messages = {mensaje, numeroDeUsuarios, tasaDeUso, promedioMensajes, tiempoEntreMensajes, tiempoDeActividad};
-    std::string mensajeFinal = concatenarMensajes(messages);
-    sendto(socketDescriptor, mensajeFinal.c_str(), mensajeFinal.size(), 0, (struct sockaddr*)&direccionMonitor, sizeof(direccionMonitor));
-
-    //enviarPromedioMensajes(socketDescriptor, direccionMonitor);
-    //enviarTasaUso(socketDescriptor, direccionMonitor);
-    //enviarTiempoEntreMensajes(socketDescriptor, direccionMonitor);
-    //enviarTiempoActividad(socketDescriptor, direccionMonitor);
-    //enviarNumeroUsuarios(socketDescriptor, direccionMonitor);  // Enviar número de usuarios conectados
-
-    close(socketDescriptor);
-}
\ No newline at end of file
+// Enviar toda la información al monitor en un paquete binario
+void ServidorChat::enviarInformacionMonitor() {
+    PaqueteTelemetria paquete;
+    llenarTelemetria(paquete);
+    if (ranuraTelemetria != -1) {
+        telemetriaCompartida.publicar(ranuraTelemetria, paquete);
+        return;
+    }
+    // Si el monitor no escucha, send puede fallar con ECONNREFUSED: se ignora y se reintenta en el siguiente ciclo
+    send(descriptorTelemetria, &paquete, sizeof(paquete), MSG_DONTWAIT);
+}
+
+// Tareas periódicas del servidor, en la rueda del primer reactor: cada segundo las muestras de
+// métricas y el mantenimiento de la bitácora, y el envío de telemetría si hay a dónde enviarla
+void ServidorChat::programarTareas(Reactor& reactor) {
+    reactor.agregarTarea(std::chrono::seconds(1), [this]() {
+        muestrearMetricas();
+        if (bitacora && !traspasando.load()) {
+            bitacora->mantener();
+        }
+    });
+    if (intervaloEnvio.count() > 0) {
+        reactor.agregarTarea(intervaloEnvio, [this]() { enviarInformacionMonitor(); });
+    }
+}
+
+// Con los reactores ya creados: adoptar las conexiones del servidor anterior, confirmarle que
+// puede terminar y empezar a escuchar los pedidos del siguiente
+void ServidorChat::activarTraspaso() {
+    if (descriptorTraspasoRecibido != -1) {
+        bool confirmado = confirmarTraspaso(descriptorTraspasoRecibido);
+        close(descriptorTraspasoRecibido);
+        descriptorTraspasoRecibido = -1;
+        if (!confirmado) {
+            // El anterior dejó de esperar y volvió a atender esas mismas conexiones
+            std::cerr << "El servidor anterior no aceptó la confirmación del traspaso.\n";
+            _exit(1);
+        }
+        restaurarConexiones();
+    }
+    std::thread(&ServidorChat::atenderTraspasos, this).detach();
+}
+
+// Dar de alta las conexiones recibidas tal como estaban: sin avisos de conexión ni historial,
+// con su canal y con lo que quedaba por enviarles al frente de la cola
+void ServidorChat::restaurarConexiones() {
+    std::size_t siguiente = 0;
+    for (ConexionTraspasada& traspasada : traspasoRecibido.conexiones) {
+        Reactor* reactor = reactores[siguiente].get();
+        siguiente = (siguiente + 1) % reactores.size();
+
+        // El modo HILOS lee con recv bloqueante; los reactores, sin bloquear
+        int banderas = fcntl(traspasada.descriptor, F_GETFL);
+        fcntl(traspasada.descriptor, F_SETFL, modo == ModoServidor::HILOS ? (banderas & ~O_NONBLOCK) : (banderas | O_NONBLOCK));
+
+        std::shared_ptr<Conexion> conexion = std::make_shared<Conexion>(traspasada.descriptor, reactor);
+        if (traspasada.tramas) {
+            conexion->activarTramas();
+        }
+        conexion->nombreUsuario = traspasada.nombreUsuario;
+        conexion->restoEntrada = traspasada.restoEntrada;
+        conexion->ultimoMensaje.store(traspasada.ultimoMensaje);
+        if (traspasada.identificado && registro.agregar(conexion)) {
+            conexion->identificado = true;
+            conexion->canal = canales.unir(conexion, traspasada.canal.empty() ? std::string(CANAL_GENERAL) : traspasada.canal);
+        }
+        if (!traspasada.salidaPendiente.empty()) {
+            std::shared_ptr<std::string> pendiente = std::make_shared<std::string>(std::move(traspasada.salidaPendiente));
+            conexion->encolarRegion(pendiente->data(), pendiente->size(), pendiente);
+        }
+
+        // Al registrarla, el reactor envía lo pendiente y epoll avisa de lo que ya espera en el socket
+        reactor->agregarConexion(conexion);
+        if (modo == ModoServidor::HILOS) {
+            lanzarLector(conexion);
+        }
+    }
+    std::cout << "Restauradas " << traspasoRecibido.conexiones.size() << " conexiones del servidor anterior.\n";
+    traspasoRecibido = EstadoTraspaso();
+}
+
+// Atender los pedidos de traspaso de un servidor nuevo en el mismo puerto
+void ServidorChat::atenderTraspasos() {
+    // El nombre queda libre cuando termina el servidor anterior, si lo hubo
+    int descriptorEscucha;
+    while ((descriptorEscucha = abrirEscuchaTraspaso(puerto)) == -1) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+
+    while (true) {
+        int descriptorTraspaso = aceptarSolicitudTraspaso(descriptorEscucha);
+        if (descriptorTraspaso == -1) {
+            continue;
+        }
+        if (traspasar(descriptorTraspaso)) {
+            std::cout << "Traspaso completo; el servidor nuevo atiende el puerto " << puerto << "." << std::endl;
+            if (ranuraTelemetria != -1) {
+                telemetriaCompartida.liberarRanura(ranuraTelemetria);
+            }
+            _exit(0);  // Sin destructores: cerrar las conexiones aquí no debe afectar al nuevo
+        }
+        std::cerr << "El traspaso falló; el servidor sigue atendiendo.\n";
+        close(descriptorTraspaso);
+    }
+}
+
+// Detener la atención, enviar el estado y esperar la confirmación; si algo falla se reanuda
+bool ServidorChat::traspasar(int descriptorTraspaso) {
+    detenerAtencion();
+    EstadoTraspaso estado;
+    recogerEstado(estado);
+    if (enviarTraspaso(descriptorTraspaso, estado) &&
+        esperarConfirmacionTraspaso(descriptorTraspaso, MILISEGUNDOS_CONFIRMACION_TRASPASO)) {
+        return true;
+    }
+    reanudarAtencion();
+    return false;
+}
+
+// Detener en orden a quien crea conexiones, a quien procesa lo que llega y a quien escribe
+void ServidorChat::detenerAtencion() {
+    std::unique_lock<std::mutex> lock(mutexTraspaso);
+    traspasando.store(true);
+    if (!reactoresPropios()) {
+        std::uint64_t uno = 1;
+        ssize_t escrito = write(descriptorParada, &uno, sizeof(uno));
+        (void)escrito;
+        cambioTraspaso.wait(lock, [this]() { return aceptadorDetenido; });
+    }
+    while (lectoresDetenidos < lectores.size()) {
+        for (const auto& lector : lectores) {
+            pthread_kill(lector.second, SIGUSR2);
+        }
+        cambioTraspaso.wait_for(lock, INTERVALO_SENALES_LECTORES);
+    }
+    lock.unlock();
+
+    for (const auto& reactor : reactores) {
+        reactor->pausar();
+    }
+}
+
+void ServidorChat::reanudarAtencion() {
+    for (const auto& reactor : reactores) {
+        reactor->reanudar();
+    }
+    std::lock_guard<std::mutex> lock(mutexTraspaso);
+    traspasando.store(false);
+    cambioTraspaso.notify_all();
+}
+
+// Sockets de escucha y conexiones de clientes en orden de llegada. Los enlaces de otros servidores
+// no pasan: se cierran con este proceso y el par se vuelve a conectar al nuevo.
+void ServidorChat::recogerEstado(EstadoTraspaso& estado) {
+    if (reactoresPropios()) {
+        for (const auto& reactor : reactores) {
+            estado.escuchas.push_back(reactor->obtenerEscucha());
+        }
+    } else {
+        estado.escuchas.push_back(descriptorServidor);
+    }
+
+    std::vector<std::shared_ptr<Conexion>> conexiones;
+    for (const auto& reactor : reactores) {
+        std::vector<std::shared_ptr<Conexion>> propias = reactor->obtenerConexiones();
+        conexiones.insert(conexiones.end(), propias.begin(), propias.end());
+    }
+    std::sort(conexiones.begin(), conexiones.end(),
+              [](const std::shared_ptr<Conexion>& a, const std::shared_ptr<Conexion>& b) {
+                  return a->ordenLlegada < b->ordenLlegada;
+              });
+
+    for (const auto& conexion : conexiones) {
+        if (conexion->esPar || conexion->estaExpulsada()) {
+            continue;
+        }
+        ConexionTraspasada traspasada;
+        traspasada.descriptor = conexion->obtenerDescriptor();
+        traspasada.tramas = conexion->usaTramas();
+        traspasada.identificado = conexion->identificado;
+        traspasada.ultimoMensaje = conexion->ultimoMensaje.load();
+        traspasada.nombreUsuario = conexion->nombreUsuario;
+        traspasada.canal = conexion->canal ? conexion->canal->obtenerNombre() : std::string();
+        traspasada.restoEntrada = conexion->restoEntrada;
+        traspasada.salidaPendiente = conexion->copiarPendientes();
+        estado.conexiones.push_back(std::move(traspasada));
+    }
+}
+
+// El hilo que acepta se queda aquí durante un traspaso; si falla, sigue aceptando
+void ServidorChat::detenerAceptador() {
+    std::unique_lock<std::mutex> lock(mutexTraspaso);
+    aceptadorDetenido = true;
+    cambioTraspaso.notify_all();
+    cambioTraspaso.wait(lock, [this]() { return !traspasando.load(); });
+    aceptadorDetenido = false;
+
+    std::uint64_t valor;
+    ssize_t leido = read(descriptorParada, &valor, sizeof(valor));
+    (void)leido;
+}
+
+// Lo mismo para cada lector del modo HILOS, entre un recv y el siguiente
+void ServidorChat::detenerLector() {
+    std::unique_lock<std::mutex> lock(mutexTraspaso);
+    lectoresDetenidos++;
+    cambioTraspaso.notify_all();
+    cambioTraspaso.wait(lock, [this]() { return !traspasando.load(); });
+    lectoresDetenidos--;
+}
@@ -0,0 +1,437 @@
+#include "SupervisorProcesos.h"
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <cmath>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <spawn.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <sys/signalfd.h>
+#include <sys/syscall.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+extern char** environ;
+
+// Número máximo de eventos atendidos por cada llamada a epoll_wait
+static const int MAX_EVENTOS = 64;
+
+// Marca del timerfd en epoll; las demás entradas llevan el índice de la instancia
+static const std::uint64_t MARCA_TEMPORIZADOR = ~static_cast<std::uint64_t>(0);
+static const std::uint64_t MARCA_SENALES = MARCA_TEMPORIZADOR - 1;
+// Bit que distingue el pidfd de la instancia anterior durante un reinicio en caliente
+static const std::uint64_t MARCA_ANTERIOR = static_cast<std::uint64_t>(1) << 62;
+
+// Cada cuánto se comprueba si un servidor recién lanzado ya acepta conexiones, y hasta cuándo
+static const std::chrono::milliseconds INTERVALO_SONDEO(2);
+static const std::chrono::seconds LIMITE_SONDEO(10);
+
+static int abrirPidfd(pid_t pid) {
+    return static_cast<int>(syscall(SYS_pidfd_open, pid, 0));
+}
+
+static double milisegundos(std::chrono::steady_clock::duration duracion) {
+    return std::chrono::duration<double, std::milli>(duracion).count();
+}
+
+ConfiguracionReinicio::ConfiguracionReinicio()
+    : retrasoInicial(50), retrasoMaximo(5000), factor(2.0), tiempoEstable(1000) {}
+
+SupervisorProcesos::SupervisorProcesos(const std::string& ejecutable, const std::string& direccionIP,
+                                       const ConfiguracionReinicio& configuracion)
+    : ejecutable(ejecutable), direccionIP(direccionIP), configuracion(configuracion), descriptorEpoll(-1),
+      descriptorTemporizador(-1), descriptorSenales(-1), estadisticas(), latenciaTotalMs(0) {}
+
+SupervisorProcesos::~SupervisorProcesos() {
+    for (const auto& instancia : instancias) {
+        if (instancia.descriptorPid != -1) {
+            close(instancia.descriptorPid);
+        }
+        if (instancia.descriptorPidAnterior != -1) {
+            close(instancia.descriptorPidAnterior);
+        }
+    }
+    if (descriptorSenales != -1) {
+        close(descriptorSenales);
+    }
+    if (descriptorTemporizador != -1) {
+        close(descriptorTemporizador);
+    }
+    if (descriptorEpoll != -1) {
+        close(descriptorEpoll);
+    }
+}
+
+void SupervisorProcesos::agregarServidor(int puerto, const std::vector<std::string>& argumentos) {
+    Instancia instancia;
+    instancia.id = static_cast<int>(instancias.size()) + 1;
+    instancia.puerto = puerto;
+    instancia.argumentos = argumentos;
+    instancia.pid = -1;
+    instancia.descriptorPid = -1;
+    instancia.pidAnterior = -1;
+    instancia.descriptorPidAnterior = -1;
+    instancia.estado = Estado::ESPERANDO;
+    instancia.caidasSeguidas = 0;
+    instancia.midiendoRecuperacion = false;
+    instancias.push_back(instancia);
+
+    std::lock_guard<std::mutex> lock(mutexEstadisticas);
+    estadisticas.instancias = instancias.size();
+}
+
+void SupervisorProcesos::agregarTarea(std::chrono::milliseconds periodo, std::function<void()> accion) {
+    tareas.emplace_back();
+    Temporizador& tarea = tareas.back();
+    tarea.accion = std::move(accion);
+    std::chrono::nanoseconds ns = std::chrono::duration_cast<std::chrono::nanoseconds>(periodo);
+    rueda.armarPeriodico(tarea, (Reloj::now() + ns).time_since_epoch().count(), ns.count());
+}
+
+// Bucle de eventos: salidas de los hijos (pidfd), reinicios/sondas programados (timerfd) y
+// pedidos de reinicio en caliente (signalfd)
+void SupervisorProcesos::ejecutar() {
+    descriptorEpoll = epoll_create1(EPOLL_CLOEXEC);
+    descriptorTemporizador = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (descriptorEpoll == -1 || descriptorTemporizador == -1) {
+        std::cerr << "Error al crear el epoll o el timerfd del supervisor.\n";
+        return;
+    }
+
+    epoll_event evento;
+    evento.events = EPOLLIN;
+    evento.data.u64 = MARCA_TEMPORIZADOR;
+    epoll_ctl(descriptorEpoll, EPOLL_CTL_ADD, descriptorTemporizador, &evento);
+
+    sigset_t senales;
+    sigemptyset(&senales);
+    sigaddset(&senales, SIGHUP);
+    descriptorSenales = signalfd(-1, &senales, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (descriptorSenales != -1) {
+        evento.data.u64 = MARCA_SENALES;
+        epoll_ctl(descriptorEpoll, EPOLL_CTL_ADD, descriptorSenales, &evento);
+    }
+
+    // Las instancias ya no cambian de lugar: cada temporizador puede guardar su índice
+    for (std::size_t indice = 0; indice < instancias.size(); ++indice) {
+        instancias[indice].temporizador.accion = [this, indice]() { vencerTemporizador(instancias[indice]); };
+    }
+    for (auto& instancia : instancias) {
+        std::cout << "Iniciando Servidor " << instancia.id << " en puerto " << instancia.puerto << std::endl;
+        if (!lanzar(instancia)) {
+            programarReinicio(instancia);
+        }
+    }
+    rearmarTemporizador();
+
+    epoll_event eventos[MAX_EVENTOS];
+    while (true) {
+        int listos = epoll_wait(descriptorEpoll, eventos, MAX_EVENTOS, -1);
+        if (listos == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cerr << "Error en epoll_wait del supervisor.\n";
+            return;
+        }
+
+        for (int i = 0; i < listos; ++i) {
+            std::uint64_t marca = eventos[i].data.u64;
+            if (marca == MARCA_TEMPORIZADOR) {
+                atenderTemporizador();
+            } else if (marca == MARCA_SENALES) {
+                reiniciarEnCaliente();
+            } else if (marca & MARCA_ANTERIOR) {
+                atenderSalidaAnterior(instancias[marca & ~MARCA_ANTERIOR]);
+            } else {
+                atenderSalida(instancias[marca]);
+            }
+        }
+        rearmarTemporizador();
+    }
+}
+
+// Lanzar el servidor sin shell y vigilar su salida con un pidfd
+bool SupervisorProcesos::lanzar(Instancia& instancia) {
+    std::vector<char*> argumentos;
+    argumentos.push_back(const_cast<char*>(ejecutable.c_str()));
+    for (const auto& argumento : instancia.argumentos) {
+        argumentos.push_back(const_cast<char*>(argumento.c_str()));
+    }
+    argumentos.push_back(nullptr);
+
+    // El hijo no hereda las señales que el monitor bloquea (SIGHUP)
+    posix_spawnattr_t atributos;
+    posix_spawnattr_init(&atributos);
+    sigset_t ninguna;
+    sigemptyset(&ninguna);
+    posix_spawnattr_setsigmask(&atributos, &ninguna);
+    posix_spawnattr_setflags(&atributos, POSIX_SPAWN_SETSIGMASK);
+
+    pid_t pid;
+    int error = posix_spawn(&pid, ejecutable.c_str(), nullptr, &atributos, argumentos.data(), environ);
+    posix_spawnattr_destroy(&atributos);
+    if (error != 0) {
+        std::cerr << "Error al lanzar el Servidor " << instancia.id << ": " << std::strerror(error) << std::endl;
+        return false;
+    }
+
+    // El hijo no se recoge hasta que el pidfd avisa, así que el pid sigue siendo válido aunque ya haya salido
+    int descriptorPid = abrirPidfd(pid);
+    if (descriptorPid == -1) {
+        std::cerr << "Error al abrir el pidfd del Servidor " << instancia.id << ".\n";
+        kill(pid, SIGKILL);
+        waitpid(pid, nullptr, 0);
+        return false;
+    }
+
+    epoll_event evento;
+    evento.events = EPOLLIN;
+    evento.data.u64 = static_cast<std::uint64_t>(&instancia - &instancias[0]);
+    epoll_ctl(descriptorEpoll, EPOLL_CTL_ADD, descriptorPid, &evento);
+
+    instancia.pid = pid;
+    instancia.descriptorPid = descriptorPid;
+    instancia.lanzamiento = Reloj::now();
+    cambiarEstado(instancia, Estado::ARRANCANDO);
+    programar(instancia, instancia.lanzamiento + INTERVALO_SONDEO);
+    return true;
+}
+
+// El pidfd avisó: recoger al hijo y programar su reinicio
+void SupervisorProcesos::atenderSalida(Instancia& instancia) {
+    int estadoSalida = 0;
+    if (waitpid(instancia.pid, &estadoSalida, WNOHANG) <= 0) {
+        return;
+    }
+    Reloj::time_point ahora = Reloj::now();
+
+    epoll_ctl(descriptorEpoll, EPOLL_CTL_DEL, instancia.descriptorPid, nullptr);
+    close(instancia.descriptorPid);
+    instancia.descriptorPid = -1;
+    instancia.pid = -1;
+
+    if (WIFSIGNALED(estadoSalida)) {
+        std::cerr << "Servidor " << instancia.id << " terminado por la señal " << WTERMSIG(estadoSalida) << std::endl;
+    } else {
+        std::cerr << "Servidor " << instancia.id << " se ha detenido (código de salida: " << WEXITSTATUS(estadoSalida) << ")" << std::endl;
+    }
+
+    // La recuperación se mide desde la primera caída, aunque fallen también los reintentos
+    if (!instancia.midiendoRecuperacion) {
+        instancia.caida = ahora;
+        instancia.midiendoRecuperacion = true;
+    }
+    if (ahora - instancia.lanzamiento >= configuracion.tiempoEstable) {
+        instancia.caidasSeguidas = 0;
+    }
+    programarReinicio(instancia);
+}
+
+// El anterior terminó después de traspasar sus conexiones: solo hay que recogerlo
+void SupervisorProcesos::atenderSalidaAnterior(Instancia& instancia) {
+    int estadoSalida = 0;
+    if (waitpid(instancia.pidAnterior, &estadoSalida, WNOHANG) <= 0) {
+        return;
+    }
+    epoll_ctl(descriptorEpoll, EPOLL_CTL_DEL, instancia.descriptorPidAnterior, nullptr);
+    close(instancia.descriptorPidAnterior);
+    instancia.descriptorPidAnterior = -1;
+    instancia.pidAnterior = -1;
+    std::cout << "Servidor " << instancia.id << ": la instancia anterior terminó tras el traspaso (código de salida: "
+              << (WIFEXITED(estadoSalida) ? WEXITSTATUS(estadoSalida) : -1) << ")" << std::endl;
+}
+
+// SIGHUP: lanzar un servidor nuevo junto a cada uno activo. El nuevo pide el traspaso al arrancar;
+// si falla, termina y se reinicia como tras cualquier caída mientras el anterior sigue atendiendo.
+void SupervisorProcesos::reiniciarEnCaliente() {
+    signalfd_siginfo informacion;
+    while (read(descriptorSenales, &informacion, sizeof(informacion)) == sizeof(informacion)) {
+    }
+
+    for (std::size_t indice = 0; indice < instancias.size(); ++indice) {
+        Instancia& instancia = instancias[indice];
+        if (instancia.estado != Estado::ACTIVO || instancia.pidAnterior != -1) {
+            continue;  // Caído, arrancando o con un traspaso todavía en curso
+        }
+
+        epoll_event evento;
+        evento.events = EPOLLIN;
+        evento.data.u64 = indice | MARCA_ANTERIOR;
+        epoll_ctl(descriptorEpoll, EPOLL_CTL_MOD, instancia.descriptorPid, &evento);
+        instancia.pidAnterior = instancia.pid;
+        instancia.descriptorPidAnterior = instancia.descriptorPid;
+        instancia.pid = -1;
+        instancia.descriptorPid = -1;
+
+        std::cout << "Reiniciando en caliente el Servidor " << instancia.id << "...\n";
+        if (!lanzar(instancia)) {
+            // Sin servidor nuevo, el anterior sigue siendo el actual
+            evento.data.u64 = indice;
+            epoll_ctl(descriptorEpoll, EPOLL_CTL_MOD, instancia.descriptorPidAnterior, &evento);
+            instancia.pid = instancia.pidAnterior;
+            instancia.descriptorPid = instancia.descriptorPidAnterior;
+            instancia.pidAnterior = -1;
+            instancia.descriptorPidAnterior = -1;
+            continue;
+        }
+        std::lock_guard<std::mutex> lock(mutexEstadisticas);
+        estadisticas.reiniciosEnCaliente++;
+    }
+}
+
+// Reiniciar en el acto tras una caída aislada; esperar cada vez más si se repiten seguidas
+void SupervisorProcesos::programarReinicio(Instancia& instancia) {
+    cambiarEstado(instancia, Estado::ESPERANDO);
+    int caidas = instancia.caidasSeguidas++;
+    if (caidas == 0) {
+        std::cout << "Reiniciando Servidor " << instancia.id << "...\n";
+        if (lanzar(instancia)) {
+            return;
+        }
+        caidas = instancia.caidasSeguidas++;
+    }
+
+    double retrasoMs = configuracion.retrasoInicial.count() * std::pow(configuracion.factor, caidas - 1);
+    retrasoMs = std::min(retrasoMs, static_cast<double>(configuracion.retrasoMaximo.count()));
+    std::cout << "Reiniciando Servidor " << instancia.id << " en " << static_cast<long>(retrasoMs) << " ms (caída "
+              << caidas + 1 << " seguida)...\n";
+
+    programar(instancia, Reloj::now() + std::chrono::duration_cast<Reloj::duration>(std::chrono::duration<double, std::milli>(retrasoMs)));
+}
+
+// Comprobar si el servidor ya acepta conexiones; si no, volver a probar en unos milisegundos
+void SupervisorProcesos::sondear(Instancia& instancia) {
+    sockaddr_in direccion;
+    std::memset(&direccion, 0, sizeof(direccion));
+    direccion.sin_family = AF_INET;
+    direccion.sin_port = htons(instancia.puerto);
+    inet_pton(AF_INET, direccionIP.c_str(), &direccion.sin_addr);
+
+    bool listo = false;
+    int descriptorSonda = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (descriptorSonda != -1) {
+        listo = connect(descriptorSonda, (sockaddr*)&direccion, sizeof(direccion)) == 0;
+        close(descriptorSonda);
+    }
+
+    Reloj::time_point ahora = Reloj::now();
+    if (listo) {
+        cambiarEstado(instancia, Estado::ACTIVO);
+        if (instancia.midiendoRecuperacion) {
+            double latenciaMs = milisegundos(ahora - instancia.caida);
+            registrarRecuperacion(latenciaMs);
+            std::cout << "Servidor " << instancia.id << " recuperado en " << std::fixed << std::setprecision(1)
+                      << latenciaMs << " ms" << std::endl;
+            instancia.midiendoRecuperacion = false;
+        }
+        return;
+    }
+
+    if (ahora - instancia.lanzamiento > LIMITE_SONDEO) {
+        std::cerr << "El Servidor " << instancia.id << " no acepta conexiones en el puerto " << instancia.puerto << ".\n";
+        cambiarEstado(instancia, Estado::ACTIVO);
+        instancia.midiendoRecuperacion = false;
+        return;
+    }
+    programar(instancia, ahora + INTERVALO_SONDEO);
+}
+
+// Cada instancia tiene un solo evento pendiente: programar otro reemplaza al anterior, así que
+// la sonda de un lanzamiento que ya cayó no llega a ejecutarse
+void SupervisorProcesos::programar(Instancia& instancia, Reloj::time_point cuando) {
+    rueda.armar(instancia.temporizador, cuando.time_since_epoch().count());
+}
+
+// Venció el evento de la instancia: qué hacer lo dice su estado
+void SupervisorProcesos::vencerTemporizador(Instancia& instancia) {
+    if (instancia.estado == Estado::ESPERANDO) {
+        if (!lanzar(instancia)) {
+            programarReinicio(instancia);
+        }
+    } else if (instancia.estado == Estado::ARRANCANDO) {
+        sondear(instancia);
+    }
+}
+
+void SupervisorProcesos::atenderTemporizador() {
+    std::uint64_t expiraciones;
+    ssize_t leido = read(descriptorTemporizador, &expiraciones, sizeof(expiraciones));
+    (void)leido;
+    rueda.avanzar(Reloj::now().time_since_epoch().count());
+}
+
+// Programar el timerfd para el próximo vencimiento de la rueda (o desarmarlo si no hay ninguno)
+void SupervisorProcesos::rearmarTemporizador() {
+    itimerspec valor;
+    std::memset(&valor, 0, sizeof(valor));
+    std::int64_t cuando = rueda.proximoVencimiento();
+    if (cuando != -1) {
+        // steady_clock usa CLOCK_MONOTONIC, el mismo reloj del timerfd
+        valor.it_value.tv_sec = cuando / 1000000000;
+        valor.it_value.tv_nsec = std::max<long>(1, cuando % 1000000000);
+    }
+    timerfd_settime(descriptorTemporizador, TFD_TIMER_ABSTIME, &valor, nullptr);
+}
+
+void SupervisorProcesos::cambiarEstado(Instancia& instancia, Estado estado) {
+    if (instancia.estado == estado) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutexEstadisticas);
+    if (instancia.estado == Estado::ACTIVO) {
+        estadisticas.activas--;
+    } else if (estado == Estado::ACTIVO) {
+        estadisticas.activas++;
+    }
+    if (estado == Estado::ESPERANDO) {
+        estadisticas.reinicios++;  // Solo se vuelve a esperar tras una caída
+    }
+    instancia.estado = estado;
+}
+
+void SupervisorProcesos::registrarRecuperacion(double latenciaMs) {
+    std::lock_guard<std::mutex> lock(mutexEstadisticas);
+    estadisticas.recuperacionesMedidas++;
+    estadisticas.latenciaUltimaMs = latenciaMs;
+    estadisticas.latenciaMaximaMs = std::max(estadisticas.latenciaMaximaMs, latenciaMs);
+    latenciaTotalMs += latenciaMs;
+    estadisticas.latenciaMediaMs = latenciaTotalMs / estadisticas.recuperacionesMedidas;
+}
+
+EstadisticasSupervisor SupervisorProcesos::obtenerEstadisticas() const {
+    std::lock_guard<std::mutex> lock(mutexEstadisticas);
+    return estadisticas;
+}
+
+// El estado de las instancias cambia con mutexEstadisticas tomado: se puede leer desde otro hilo
+std::vector<int> SupervisorProcesos::obtenerPuertosActivos() const {
+    std::lock_guard<std::mutex> lock(mutexEstadisticas);
+    std::vector<int> puertos;
+    for (const Instancia& instancia : instancias) {
+        if (instancia.estado == Estado::ACTIVO) {
+            puertos.push_back(instancia.puerto);
+        }
+    }
+    return puertos;
+}
+
+// Resumen de una línea para mostrar junto a la información de los servidores
+std::string SupervisorProcesos::obtenerResumen() const {
+    EstadisticasSupervisor datos = obtenerEstadisticas();
+    std::ostringstream resumen;
+    resumen << std::fixed << std::setprecision(1) << "Supervisor: " << datos.activas << "/" << datos.instancias
+            << " servidores activos, " << datos.reinicios << " reinicios, " << datos.reiniciosEnCaliente << " en caliente";
+    if (datos.recuperacionesMedidas > 0) {
+        resumen << ", recuperación última " << datos.latenciaUltimaMs << " ms, media " << datos.latenciaMediaMs
+                << " ms, máxima " << datos.latenciaMaximaMs << " ms";
+    }
+    return resumen.str();
+}
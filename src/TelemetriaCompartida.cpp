@@ -0,0 +1,151 @@
+#include "TelemetriaCompartida.h"
+#include <iostream>
+#include <new>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2,
+              "Los atómicos del segmento deben funcionar entre procesos sin candados");
+
+// Lecturas seguidas de una ranura que se está escribiendo antes de darla por no disponible
+static const int MAX_INTENTOS_LECTURA = 64;
+
+SegmentoTelemetria::SegmentoTelemetria() : segmento(nullptr) {}
+
+SegmentoTelemetria::~SegmentoTelemetria() {
+    if (segmento != nullptr) {
+        munmap(segmento, sizeof(SegmentoCompartido));
+    }
+}
+
+bool SegmentoTelemetria::crear() {
+    shm_unlink(NOMBRE_SEGMENTO_TELEMETRIA);
+    int descriptor = shm_open(NOMBRE_SEGMENTO_TELEMETRIA, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+    if (descriptor == -1 || ftruncate(descriptor, sizeof(SegmentoCompartido)) == -1) {
+        std::cerr << "Error al crear el segmento de telemetría compartida: " << std::strerror(errno) << std::endl;
+        if (descriptor != -1) {
+            close(descriptor);
+        }
+        return false;
+    }
+    void* memoria = mmap(nullptr, sizeof(SegmentoCompartido), PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+    close(descriptor);
+    if (memoria == MAP_FAILED) {
+        std::cerr << "Error al mapear el segmento de telemetría compartida.\n";
+        return false;
+    }
+
+    // Las ranuras se construyen en su lugar; la cabecera va al final para que un servidor que abre
+    // el segmento a la vez no lo dé por válido antes de tiempo
+    segmento = static_cast<SegmentoCompartido*>(memoria);
+    for (std::size_t i = 0; i < MAX_RANURAS_TELEMETRIA; ++i) {
+        RanuraTelemetria* ranura = new (&segmento->ranura[i]) RanuraTelemetria;
+        ranura->pid.store(0, std::memory_order_relaxed);
+        ranura->version.store(0, std::memory_order_relaxed);
+    }
+    segmento->version = VERSION_TELEMETRIA;
+    segmento->ranuras = static_cast<std::uint32_t>(MAX_RANURAS_TELEMETRIA);
+    segmento->tamanoRanura = static_cast<std::uint32_t>(sizeof(RanuraTelemetria));
+    std::atomic_thread_fence(std::memory_order_release);
+    segmento->magia = MAGIA_SEGMENTO_TELEMETRIA;
+    return true;
+}
+
+bool SegmentoTelemetria::abrir() {
+    int descriptor = shm_open(NOMBRE_SEGMENTO_TELEMETRIA, O_RDWR | O_CLOEXEC, 0);
+    if (descriptor == -1) {
+        return false;
+    }
+    struct stat estado;
+    if (fstat(descriptor, &estado) == -1 || static_cast<std::size_t>(estado.st_size) != sizeof(SegmentoCompartido)) {
+        close(descriptor);
+        return false;
+    }
+    void* memoria = mmap(nullptr, sizeof(SegmentoCompartido), PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+    close(descriptor);
+    if (memoria == MAP_FAILED) {
+        return false;
+    }
+
+    // Un segmento de otra versión del formato se ignora: el servidor sigue con UDP
+    segmento = static_cast<SegmentoCompartido*>(memoria);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (segmento->magia != MAGIA_SEGMENTO_TELEMETRIA || segmento->version != VERSION_TELEMETRIA ||
+        segmento->ranuras != MAX_RANURAS_TELEMETRIA || segmento->tamanoRanura != sizeof(RanuraTelemetria)) {
+        munmap(segmento, sizeof(SegmentoCompartido));
+        segmento = nullptr;
+        return false;
+    }
+    return true;
+}
+
+void SegmentoTelemetria::eliminar() {
+    shm_unlink(NOMBRE_SEGMENTO_TELEMETRIA);
+}
+
+// Tomar una ranura libre o la de un proceso que terminó sin liberarla
+int SegmentoTelemetria::reservarRanura() {
+    std::uint32_t propio = static_cast<std::uint32_t>(getpid());
+    for (std::size_t i = 0; i < MAX_RANURAS_TELEMETRIA; ++i) {
+        RanuraTelemetria& ranura = segmento->ranura[i];
+        std::uint32_t duenio = ranura.pid.load(std::memory_order_acquire);
+        bool libre = duenio == 0 || (kill(static_cast<pid_t>(duenio), 0) == -1 && errno == ESRCH);
+        if (!libre || !ranura.pid.compare_exchange_strong(duenio, propio, std::memory_order_acq_rel)) {
+            continue;
+        }
+        // Si el dueño anterior murió a mitad de una escritura, la versión quedó impar
+        std::uint64_t version = ranura.version.load(std::memory_order_relaxed);
+        if (version & 1) {
+            ranura.version.store(version + 1, std::memory_order_release);
+        }
+        return static_cast<int>(i);
+    }
+    return -1;
+}
+
+void SegmentoTelemetria::liberarRanura(int ranura) {
+    segmento->ranura[ranura].pid.store(0, std::memory_order_release);
+}
+
+void SegmentoTelemetria::publicar(int indice, const PaqueteTelemetria& paquete) {
+    std::uint64_t palabras[PALABRAS_PAQUETE_TELEMETRIA];
+    std::memcpy(palabras, &paquete, sizeof(paquete));
+
+    RanuraTelemetria& ranura = segmento->ranura[indice];
+    std::uint64_t version = ranura.version.load(std::memory_order_relaxed);
+    ranura.version.store(version + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (std::size_t i = 0; i < PALABRAS_PAQUETE_TELEMETRIA; ++i) {
+        ranura.palabras[i].store(palabras[i], std::memory_order_relaxed);
+    }
+    ranura.version.store(version + 2, std::memory_order_release);
+}
+
+bool SegmentoTelemetria::leer(std::size_t indice, PaqueteTelemetria& paquete, std::uint64_t& reintentos) const {
+    const RanuraTelemetria& ranura = segmento->ranura[indice];
+    std::uint64_t palabras[PALABRAS_PAQUETE_TELEMETRIA];
+    for (int intento = 0; intento < MAX_INTENTOS_LECTURA; ++intento) {
+        std::uint64_t antes = ranura.version.load(std::memory_order_acquire);
+        if (antes == 0) {
+            return false;  // Nadie publicó todavía en esta ranura
+        }
+        if ((antes & 1) == 0) {
+            for (std::size_t i = 0; i < PALABRAS_PAQUETE_TELEMETRIA; ++i) {
+                palabras[i] = ranura.palabras[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (ranura.version.load(std::memory_order_relaxed) == antes) {
+                std::memcpy(&paquete, palabras, sizeof(paquete));
+                return paquete.magia == MAGIA_TELEMETRIA && paquete.version == VERSION_TELEMETRIA &&
+                       paquete.longitud == sizeof(PaqueteTelemetria);
+            }
+        }
+        reintentos++;
+    }
+    return false;
+}
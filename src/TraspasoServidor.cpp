@@ -0,0 +1,278 @@
+#include "TraspasoServidor.h"
+#include "Protocolo.h"
+#include <iostream>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+static const std::uint32_t MAGIA_TRASPASO = 0x50535254;  // "TRSP"
+static const std::uint32_t VERSION_TRASPASO = 1;
+static const std::size_t TAMANO_CABECERA_TRASPASO = 4 + 4 + 4 + 4 + 8;
+
+// SCM_RIGHTS admite como mucho 253 descriptores por mensaje
+static const std::size_t DESCRIPTORES_POR_MENSAJE = 250;
+static const std::size_t BYTES_POR_MENSAJE = 32 * 1024;
+
+// Un servidor anterior que no responde no debe dejar colgado el arranque del nuevo
+static const int SEGUNDOS_ESPERA_TRASPASO = 5;
+
+static const char PEDIDO_TRASPASO = 'T';
+static const char CONFIRMACION_TRASPASO = 'L';
+
+// Nombre en el espacio abstracto: no deja archivos y desaparece con el proceso
+static socklen_t direccionTraspaso(int puerto, sockaddr_un& direccion) {
+    std::memset(&direccion, 0, sizeof(direccion));
+    direccion.sun_family = AF_UNIX;
+    std::string nombre = "chat_traspaso_" + std::to_string(puerto);
+    std::memcpy(direccion.sun_path + 1, nombre.data(), nombre.size());
+    return static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + 1 + nombre.size());
+}
+
+int abrirEscuchaTraspaso(int puerto) {
+    int descriptor = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (descriptor == -1) {
+        return -1;
+    }
+    sockaddr_un direccion;
+    socklen_t longitud = direccionTraspaso(puerto, direccion);
+    if (bind(descriptor, (sockaddr*)&direccion, longitud) == -1 || listen(descriptor, 1) == -1) {
+        close(descriptor);
+        return -1;
+    }
+    return descriptor;
+}
+
+int aceptarSolicitudTraspaso(int descriptorEscucha) {
+    int descriptor = accept4(descriptorEscucha, nullptr, nullptr, SOCK_CLOEXEC);
+    if (descriptor == -1) {
+        return -1;
+    }
+
+    // El nombre abstracto no tiene permisos de archivo: se comprueba quién pide los sockets
+    ucred credenciales;
+    socklen_t longitud = sizeof(credenciales);
+    timeval espera = {SEGUNDOS_ESPERA_TRASPASO, 0};
+    char pedido = 0;
+    if (getsockopt(descriptor, SOL_SOCKET, SO_PEERCRED, &credenciales, &longitud) == -1 ||
+        credenciales.uid != geteuid() ||
+        setsockopt(descriptor, SOL_SOCKET, SO_RCVTIMEO, &espera, sizeof(espera)) == -1 ||
+        setsockopt(descriptor, SOL_SOCKET, SO_SNDTIMEO, &espera, sizeof(espera)) == -1 ||
+        recv(descriptor, &pedido, 1, 0) != 1 || pedido != PEDIDO_TRASPASO) {
+        close(descriptor);
+        return -1;
+    }
+    return descriptor;
+}
+
+int solicitarTraspaso(int puerto) {
+    int descriptor = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (descriptor == -1) {
+        return -1;
+    }
+    sockaddr_un direccion;
+    socklen_t longitud = direccionTraspaso(puerto, direccion);
+    timeval espera = {SEGUNDOS_ESPERA_TRASPASO, 0};
+    if (connect(descriptor, (sockaddr*)&direccion, longitud) == -1 ||
+        setsockopt(descriptor, SOL_SOCKET, SO_RCVTIMEO, &espera, sizeof(espera)) == -1 ||
+        send(descriptor, &PEDIDO_TRASPASO, 1, MSG_NOSIGNAL) != 1) {
+        close(descriptor);
+        return -1;
+    }
+    return descriptor;
+}
+
+// Un mensaje con los bytes indicados y, si hay, los descriptores adjuntos
+static bool enviarMensaje(int descriptor, const char* datos, std::size_t longitud, const int* descriptores, std::size_t cantidad) {
+    iovec vector = {const_cast<char*>(datos), longitud};
+    msghdr mensaje;
+    std::memset(&mensaje, 0, sizeof(mensaje));
+    mensaje.msg_iov = &vector;
+    mensaje.msg_iovlen = 1;
+
+    std::vector<char> control;
+    if (cantidad > 0) {
+        control.assign(CMSG_SPACE(cantidad * sizeof(int)), 0);
+        mensaje.msg_control = control.data();
+        mensaje.msg_controllen = control.size();
+        cmsghdr* cabecera = CMSG_FIRSTHDR(&mensaje);
+        cabecera->cmsg_level = SOL_SOCKET;
+        cabecera->cmsg_type = SCM_RIGHTS;
+        cabecera->cmsg_len = CMSG_LEN(cantidad * sizeof(int));
+        std::memcpy(CMSG_DATA(cabecera), descriptores, cantidad * sizeof(int));
+    }
+
+    ssize_t enviados;
+    do {
+        enviados = sendmsg(descriptor, &mensaje, MSG_NOSIGNAL);
+    } while (enviados == -1 && errno == EINTR);
+    return enviados == static_cast<ssize_t>(longitud);
+}
+
+// Recibir un mensaje; los descriptores adjuntos se agregan al final de 'descriptores'
+static ssize_t recibirMensaje(int descriptor, char* datos, std::size_t capacidad, std::vector<int>& descriptores) {
+    iovec vector = {datos, capacidad};
+    std::vector<char> control(CMSG_SPACE(DESCRIPTORES_POR_MENSAJE * sizeof(int)));
+    msghdr mensaje;
+    std::memset(&mensaje, 0, sizeof(mensaje));
+    mensaje.msg_iov = &vector;
+    mensaje.msg_iovlen = 1;
+    mensaje.msg_control = control.data();
+    mensaje.msg_controllen = control.size();
+
+    ssize_t recibidos;
+    do {
+        recibidos = recvmsg(descriptor, &mensaje, MSG_CMSG_CLOEXEC);
+    } while (recibidos == -1 && errno == EINTR);
+    for (cmsghdr* cabecera = CMSG_FIRSTHDR(&mensaje); cabecera != nullptr; cabecera = CMSG_NXTHDR(&mensaje, cabecera)) {
+        if (cabecera->cmsg_level == SOL_SOCKET && cabecera->cmsg_type == SCM_RIGHTS) {
+            std::size_t cantidad = (cabecera->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            const int* recibidosDescriptores = reinterpret_cast<const int*>(CMSG_DATA(cabecera));
+            descriptores.insert(descriptores.end(), recibidosDescriptores, recibidosDescriptores + cantidad);
+        }
+    }
+    if (recibidos >= 0 && (mensaje.msg_flags & (MSG_TRUNC | MSG_CTRUNC))) {
+        return -1;
+    }
+    return recibidos;
+}
+
+static void agregarEntero(std::string& destino, std::uint64_t valor, std::size_t bytes) {
+    char buffer[8];
+    escribirEntero(buffer, valor, bytes);
+    destino.append(buffer, bytes);
+}
+
+static void agregarTexto(std::string& destino, const std::string& texto, std::size_t bytesLongitud) {
+    agregarEntero(destino, texto.size(), bytesLongitud);
+    destino += texto;
+}
+
+// Lector secuencial del estado serializado; cualquier lectura fuera de rango lo marca inválido
+struct LectorEstado {
+    const std::string& datos;
+    std::size_t posicion;
+    bool valido;
+
+    std::uint64_t entero(std::size_t bytes) {
+        if (!valido || posicion + bytes > datos.size()) {
+            valido = false;
+            return 0;
+        }
+        std::uint64_t valor = leerEntero(datos.data() + posicion, bytes);
+        posicion += bytes;
+        return valor;
+    }
+
+    std::string texto(std::size_t bytesLongitud) {
+        std::size_t longitud = entero(bytesLongitud);
+        if (!valido || posicion + longitud > datos.size()) {
+            valido = false;
+            return std::string();
+        }
+        std::string resultado(datos, posicion, longitud);
+        posicion += longitud;
+        return resultado;
+    }
+};
+
+bool enviarTraspaso(int descriptor, const EstadoTraspaso& estado) {
+    std::string datos;
+    std::vector<int> descriptores = estado.escuchas;
+    for (const ConexionTraspasada& conexion : estado.conexiones) {
+        descriptores.push_back(conexion.descriptor);
+        agregarEntero(datos, (conexion.tramas ? 1 : 0) | (conexion.identificado ? 2 : 0), 1);
+        agregarEntero(datos, static_cast<std::uint64_t>(conexion.ultimoMensaje), 8);
+        agregarTexto(datos, conexion.nombreUsuario, 2);
+        agregarTexto(datos, conexion.canal, 1);
+        agregarTexto(datos, conexion.restoEntrada, 4);
+        agregarTexto(datos, conexion.salidaPendiente, 4);
+    }
+
+    char cabecera[TAMANO_CABECERA_TRASPASO];
+    escribirEntero(cabecera, MAGIA_TRASPASO, 4);
+    escribirEntero(cabecera + 4, VERSION_TRASPASO, 4);
+    escribirEntero(cabecera + 8, estado.escuchas.size(), 4);
+    escribirEntero(cabecera + 12, estado.conexiones.size(), 4);
+    escribirEntero(cabecera + 16, datos.size(), 8);
+    if (!enviarMensaje(descriptor, cabecera, sizeof(cabecera), nullptr, 0)) {
+        return false;
+    }
+
+    // Cada grupo de descriptores viaja con un byte: SOCK_SEQPACKET no admite mensajes vacíos con datos de control
+    for (std::size_t inicio = 0; inicio < descriptores.size(); inicio += DESCRIPTORES_POR_MENSAJE) {
+        std::size_t cantidad = std::min(DESCRIPTORES_POR_MENSAJE, descriptores.size() - inicio);
+        char relleno = 0;
+        if (!enviarMensaje(descriptor, &relleno, 1, &descriptores[inicio], cantidad)) {
+            return false;
+        }
+    }
+    for (std::size_t inicio = 0; inicio < datos.size(); inicio += BYTES_POR_MENSAJE) {
+        std::size_t longitud = std::min(BYTES_POR_MENSAJE, datos.size() - inicio);
+        if (!enviarMensaje(descriptor, datos.data() + inicio, longitud, nullptr, 0)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool recibirTraspaso(int descriptor, EstadoTraspaso& estado) {
+    std::vector<int> descriptores;
+    char cabecera[TAMANO_CABECERA_TRASPASO];
+    if (recibirMensaje(descriptor, cabecera, sizeof(cabecera), descriptores) != static_cast<ssize_t>(sizeof(cabecera)) ||
+        leerEntero(cabecera, 4) != MAGIA_TRASPASO || leerEntero(cabecera + 4, 4) != VERSION_TRASPASO) {
+        return false;
+    }
+    std::size_t escuchas = leerEntero(cabecera + 8, 4);
+    std::size_t conexiones = leerEntero(cabecera + 12, 4);
+    std::size_t bytesEstado = leerEntero(cabecera + 16, 8);
+
+    bool completo = true;
+    while (completo && descriptores.size() < escuchas + conexiones) {
+        char relleno;
+        completo = recibirMensaje(descriptor, &relleno, 1, descriptores) == 1;
+    }
+    std::string datos(bytesEstado, '\0');
+    for (std::size_t posicion = 0; completo && posicion < bytesEstado;) {
+        ssize_t recibidos = recibirMensaje(descriptor, &datos[posicion], bytesEstado - posicion, descriptores);
+        completo = recibidos > 0;
+        posicion += completo ? recibidos : 0;
+    }
+
+    LectorEstado lector = {datos, 0, completo && descriptores.size() == escuchas + conexiones};
+    std::vector<ConexionTraspasada> traspasadas(lector.valido ? conexiones : 0);
+    for (std::size_t i = 0; i < traspasadas.size() && lector.valido; ++i) {
+        ConexionTraspasada& conexion = traspasadas[i];
+        std::uint64_t banderas = lector.entero(1);
+        conexion.descriptor = descriptores[escuchas + i];
+        conexion.tramas = (banderas & 1) != 0;
+        conexion.identificado = (banderas & 2) != 0;
+        conexion.ultimoMensaje = static_cast<std::int64_t>(lector.entero(8));
+        conexion.nombreUsuario = lector.texto(2);
+        conexion.canal = lector.texto(1);
+        conexion.restoEntrada = lector.texto(4);
+        conexion.salidaPendiente = lector.texto(4);
+    }
+    if (!lector.valido) {
+        for (int recibido : descriptores) {
+            close(recibido);
+        }
+        return false;
+    }
+    estado.escuchas.assign(descriptores.begin(), descriptores.begin() + escuchas);
+    estado.conexiones.swap(traspasadas);
+    return true;
+}
+
+bool confirmarTraspaso(int descriptor) {
+    return send(descriptor, &CONFIRMACION_TRASPASO, 1, MSG_NOSIGNAL) == 1;
+}
+
+bool esperarConfirmacionTraspaso(int descriptor, int milisegundos) {
+    pollfd espera = {descriptor, POLLIN, 0};
+    char respuesta = 0;
+    return poll(&espera, 1, milisegundos) == 1 && recv(descriptor, &respuesta, 1, 0) == 1 && respuesta == CONFIRMACION_TRASPASO;
+}